@@ -0,0 +1,39 @@
+# Reading the metadata of 300 NSRunningApplication wrappers, ten times
+#
+#   rake bench:app_metadata
+#
+# The 300 wrappers cycle through whatever is running. The first pass
+# converts every property, the later passes get them from the wrapper;
+# fresh wrappers for the same apps are read once more for comparison.
+
+require 'bench/helper'
+
+APPS   = 300
+PASSES = 10
+FIELDS = [:localizedName, :bundleIdentifier, :bundleURL, :executableURL, :launchDate]
+
+pids = NSWorkspace.sharedWorkspace.runningApplications.map(&:processIdentifier)
+wrap = lambda {
+  Array.new(APPS) { |i| NSRunningApplication.runningApplicationWithProcessIdentifier pids[i % pids.size] }.compact
+}
+read = lambda { |apps| apps.each { |app| FIELDS.each { |field| app.send field } } }
+
+def allocations
+  before = GC.stat(:total_allocated_objects)
+  yield
+  GC.stat(:total_allocated_objects) - before
+end
+
+apps = wrap.call
+puts "app_metadata: #{apps.size} wrappers over #{pids.size} running apps"
+Benchmark.bm(16) do |x|
+  objects = nil
+  x.report('first read')      { objects = allocations { read.call apps } }
+  puts "#{' ' * 17}#{objects} objects allocated"
+  x.report("#{PASSES} more reads") { objects = allocations { PASSES.times { read.call apps } } }
+  puts "#{' ' * 17}#{objects} objects allocated"
+
+  fresh = wrap.call
+  x.report('fresh wrappers')  { objects = allocations { read.call fresh } }
+  puts "#{' ' * 17}#{objects} objects allocated"
+end
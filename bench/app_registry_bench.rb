@@ -0,0 +1,50 @@
+# AppRegistry#poll against a simulated table of 300 running apps
+#
+#   rake bench:app_registry
+#
+# Each poll replaces one app, which is about as much as changes between
+# two polls of a test harness. Wrapping the whole list on every poll,
+# as NSWorkspace#runningApplications does, is shown for comparison,
+# along with polls of the real process table.
+
+require 'bench/helper'
+
+APPS  = 300
+POLLS = 1_000
+
+FakeApp = Struct.new(:processIdentifier, :bundleIdentifier, :localizedName, :launchDate)
+
+procs = Array.new(APPS) { |i|
+  FakeApp.new(1_000 + i, "com.example.app#{i}", "App #{i}", Time.at(i))
+}
+next_pid = 1_000 + APPS
+churn    = lambda {
+  procs.delete_at rand(procs.size)
+  procs << FakeApp.new(next_pid, "com.example.app#{next_pid}", "App #{next_pid}", Time.now)
+  next_pid += 1
+}
+
+registry = Accessibility::AppRegistry.new(-> { procs })
+registry.poll
+
+puts "app_registry: #{POLLS} polls of #{APPS} simulated apps"
+Benchmark.bm(18) do |x|
+  x.report('registry') {
+    POLLS.times { churn.call; registry.poll }
+  }
+  x.report('wrap every app') {
+    POLLS.times {
+      churn.call
+      procs.map { |app| FakeApp.new(*app.to_a) }
+    }
+  }
+
+  system = Accessibility::AppRegistry.new
+  system.poll
+  x.report("registry, #{system.size} real") {
+    POLLS.times { system.poll }
+  }
+  x.report("runningApplications") {
+    POLLS.times { NSWorkspace.sharedWorkspace.runningApplications }
+  }
+end
@@ -0,0 +1,17 @@
+# Element#application over 10k elements from the same application
+#
+#   rake bench:application [PID=1234]
+#
+# The first pass looks up the shared handle for each element, the
+# second pass gets it from the element.
+
+require 'bench/helper'
+
+pid = (ENV['PID'] || NSWorkspace.sharedWorkspace.frontmostApplication.processIdentifier).to_i
+app = Accessibility::Element.application_for pid
+elements = collect_elements app, 10_000
+
+Benchmark.bm(8) do |x|
+  x.report('first')  { elements.each(&:application) }
+  x.report('cached') { elements.each(&:application) }
+end
@@ -0,0 +1,57 @@
+# Reading three Info.plist keys from 500 generated bundles
+#
+#   rake bench:bundle_info
+#
+# NSBundle keeps every bundle it has opened, so each way of reading gets
+# its own directory of bundles to start cold, then reads them once more
+# warm. Reading one bundle at a time is bundleWithURL followed by
+# objectForInfoDictionaryKey for each key.
+
+require 'bench/helper'
+require 'tmpdir'
+require 'fileutils'
+
+COUNT = 500
+KEYS  = ['CFBundleName', 'CFBundleVersion', 'CFBundleIdentifier']
+
+def make_bundles dir, count
+  Array.new(count) do |n|
+    path = File.join dir, "Bench#{n}.app", 'Contents'
+    FileUtils.mkdir_p path
+    File.write File.join(path, 'Info.plist'), <<-PLIST
+<?xml version="1.0" encoding="UTF-8"?>
+<!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd">
+<plist version="1.0">
+<dict>
+  <key>CFBundleIdentifier</key><string>com.example.bench#{n}</string>
+  <key>CFBundleName</key><string>Bench #{n}</string>
+  <key>CFBundleVersion</key><string>1.#{n}</string>
+  <key>CFBundlePackageType</key><string>APPL</string>
+</dict>
+</plist>
+    PLIST
+    Accessibility::URL.new "file://#{File.dirname path}/"
+  end
+end
+
+READERS = {
+  'one at a time' => lambda { |urls|
+    urls.map { |url|
+      bundle = NSBundle.bundleWithURL url
+      KEYS.map { |key| bundle.objectForInfoDictionaryKey key }
+    }
+  },
+  'info_for'      => lambda { |urls| NSBundle.info_for urls, KEYS },
+  'info_for, parallel' => lambda { |urls| NSBundle.info_for urls, KEYS, parallel: true }
+}
+
+Dir.mktmpdir do |root|
+  puts "bundle_info: #{COUNT} bundles, #{KEYS.size} keys"
+  Benchmark.bm(26) do |x|
+    READERS.each do |name, reader|
+      urls = make_bundles File.join(root, name.delete(' ,')), COUNT
+      x.report("#{name}, cold") { reader.call urls }
+      x.report("#{name}, warm") { reader.call urls }
+    end
+  end
+end
@@ -0,0 +1,45 @@
+# Looking apps up by bundle identifier, from an index and by scanning
+#
+#   rake bench:bundle_lookup
+#
+# The simulated table has 300 apps, a few of which share an identifier.
+# The real rows compare runningApplicationsWithBundleIdentifier, which
+# is answered from a registry, with filtering runningApplications.
+
+require 'bench/helper'
+
+APPS    = 300
+LOOKUPS = 100_000
+
+FakeApp = Struct.new(:processIdentifier, :bundleIdentifier, :localizedName)
+
+procs = Array.new(APPS) { |i|
+  FakeApp.new(1_000 + i, "com.example.app#{i % 250}", "App #{i}")
+}
+ids      = procs.map(&:bundleIdentifier).uniq
+registry = Accessibility::AppRegistry.new(-> { procs })
+registry.poll
+
+real     = NSWorkspace.sharedWorkspace.runningApplications.map(&:bundleIdentifier).compact.uniq
+real_ids = Array.new(1_000) { |i| real[i % real.size] }
+
+puts "bundle_lookup: #{LOOKUPS} lookups in #{APPS} simulated apps, 1000 in #{real.size} real ones"
+Benchmark.bm(22) do |x|
+  x.report('index') {
+    LOOKUPS.times { |i| registry.with_bundle_identifier ids[i % ids.size] }
+  }
+  x.report('scan') {
+    LOOKUPS.times { |i|
+      id = ids[i % ids.size]
+      procs.select { |app| app.bundleIdentifier == id }
+    }
+  }
+  x.report('real, cached') {
+    real_ids.each { |id| NSRunningApplication.runningApplicationsWithBundleIdentifier id }
+  }
+  x.report('real, uncached') {
+    real_ids.each { |id|
+      NSWorkspace.sharedWorkspace.runningApplications.select { |app| app.bundleIdentifier == id }
+    }
+  }
+end
@@ -0,0 +1,49 @@
+# Capturing and comparing two frames in memory and through files
+#
+#   rake bench:capture_compare
+#
+# The frames come from the synthetic capture source, so no screen
+# recording permission is needed and every run sees the same pixels.
+# The file round trip is what comparing shots took before capture:
+# save two PNGs, read them back, and compare the bytes.
+
+require 'bench/helper'
+require 'tmpdir'
+require 'accessibility/screen_shooter'
+
+RUNS = 20
+RECT = CGRect.new(CGPoint.new(0, 0), CGSize.new(1920, 1080))
+OPTS = { source: :synthetic }
+
+Dir.mktmpdir do |dir|
+  a = File.join dir, 'a.png'
+  b = File.join dir, 'b.png'
+
+  puts "capture_compare: #{RECT.size.width.to_i}x#{RECT.size.height.to_i}, #{RUNS} comparisons"
+  Benchmark.bm(22) do |x|
+    x.report('screenshot, read, ==') {
+      RUNS.times {
+        ScreenShooter.screenshot RECT, a, OPTS
+        ScreenShooter.screenshot RECT, b, OPTS
+        File.binread(a) == File.binread(b)
+      }
+    }
+    x.report('capture png, ==') {
+      RUNS.times {
+        ScreenShooter.capture(RECT, OPTS.merge(format: :png)).bytes ==
+          ScreenShooter.capture(RECT, OPTS.merge(format: :png)).bytes
+      }
+    }
+    x.report('capture, diff') {
+      RUNS.times {
+        ScreenShooter.diff ScreenShooter.capture(RECT, OPTS), ScreenShooter.capture(RECT, OPTS)
+      }
+    }
+    x.report('capture raw, diff') {
+      RUNS.times {
+        ScreenShooter.diff ScreenShooter.capture(RECT, OPTS.merge(format: :raw)),
+                           ScreenShooter.capture(RECT, OPTS.merge(format: :raw))
+      }
+    }
+  end
+end
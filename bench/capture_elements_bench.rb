@@ -0,0 +1,47 @@
+# Capturing 50 controls with capture_elements and with 50 captures
+#
+#   rake bench:capture_elements
+#
+# The controls come in a tight grid, where everything ends up in one
+# capture, and spread over the screen in small groups, where each group
+# gets a capture of its own. The synthetic source stands in for the
+# screen, so no screen recording permission is needed.
+
+require 'bench/helper'
+require 'accessibility/screen_shooter'
+
+RUNS = 10
+OPTS = { source: :synthetic }
+
+Control = Struct.new(:to_rect)
+
+def control x, y, w, h
+  Control.new CGRect.new(CGPoint.new(x, y), CGSize.new(w, h))
+end
+
+LAYOUTS = {
+  'grid'   => Array.new(50) { |i| control 20 + (i % 10) * 35, 40 + (i / 10) * 25, 40, 22 },
+  'spread' => Array.new(50) { |i|
+    group = i / 5
+    control 40 + (group % 5) * 360 + (i % 5) * 45, 60 + (group / 5) * 500, 40, 22
+  }
+}
+
+def captures
+  before = ScreenShooter.pool_stats
+  yield
+  after  = ScreenShooter.pool_stats
+  (after[:allocations] + after[:reuses]) - (before[:allocations] + before[:reuses])
+end
+
+LAYOUTS.each do |name, controls|
+  puts "capture_elements: 50 controls, #{name}, best of #{RUNS}"
+  grouped  = nil
+  separate = nil
+  elements = best_of(RUNS) { grouped = captures { ScreenShooter.capture_elements controls, OPTS } }
+  each     = best_of(RUNS) {
+    separate = captures { controls.each { |c| ScreenShooter.capture c.to_rect, OPTS } }
+  }
+  puts format('  %-18s %8.1f ms  %3d capture(s)', 'capture_elements', elements, grouped)
+  puts format('  %-18s %8.1f ms  %3d capture(s)', '50 x capture', each, separate)
+end
@@ -0,0 +1,32 @@
+# Scanning 10k elements for an attribute that none of them support
+#
+#   rake bench:errors
+#
+# Element#size_of raises an AttributeUnsupportedError for every element;
+# the rows show the cost of rescuing it, of also building its message,
+# and of asking with Element#try_attribute so that nothing is raised.
+
+require 'bench/helper'
+
+pid      = launch_fixtures(1).first
+elements = collect_elements Accessibility::Element.application_for(pid), 10_000
+name     = 'AXNotAnAttribute'
+
+puts "errors: #{elements.size} elements"
+Benchmark.bm(16) do |x|
+  x.report('rescue') {
+    elements.each { |e| e.size_of(name) rescue nil }
+  }
+  x.report('rescue, message') {
+    elements.each { |e|
+      begin
+        e.size_of name
+      rescue Accessibility::Error => error
+        error.message
+      end
+    }
+  }
+  x.report('try_attribute') {
+    elements.each { |e| e.try_attribute name }
+  }
+end
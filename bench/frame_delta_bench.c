@@ -0,0 +1,56 @@
+/*
+ * ss_sequence_append over sixty 1920x1080 frames, for a few change rates
+ *
+ *   rake bench:native
+ *
+ * Each frame redraws the given share of the rows before it is added.
+ * The stored size is compared with keeping every frame raw.
+ */
+
+#include "synthetic.h"
+#include "frame_delta.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WIDTH    1920
+#define HEIGHT   1080
+#define FRAMES   60
+#define TILE     32
+#define KEYFRAME 30
+#define LEVEL    6
+
+int
+main(void)
+{
+    static const double changes[] = { 0, 1, 10, 50 };
+    const double raw = (double)WIDTH * HEIGHT * 4 * FRAMES;
+
+    printf("frame_delta: %d frames of %dx%d, %.0f MB raw\n",
+           FRAMES, WIDTH, HEIGHT, raw / 1e6);
+    for (size_t c = 0; c < sizeof(changes) / sizeof(changes[0]); c++) {
+        bench_frame_t frame;
+        ss_sequence_t sequence;
+        if (bench_frame_init(&frame, WIDTH, HEIGHT))
+            return 1;
+        if (ss_sequence_init(&sequence, WIDTH, HEIGHT, TILE, KEYFRAME, LEVEL))
+            return 1;
+
+        double appending = 0;
+        for (int i = 0; i < FRAMES; i++) {
+            bench_frame_step(&frame, changes[c]);
+            const double start = bench_now();
+            if (ss_sequence_append(&sequence, frame.pixels, frame.stride))
+                return 1;
+            appending += bench_now() - start;
+        }
+
+        const double stored = (double)ss_sequence_bytes(&sequence);
+        printf("  %3.0f%% changed  %7.1f ms/frame  %8.2f MB stored  %6.1fx smaller\n",
+               changes[c], appending * 1000 / FRAMES, stored / 1e6, raw / stored);
+
+        ss_sequence_free(&sequence);
+        bench_frame_free(&frame);
+    }
+    return 0;
+}
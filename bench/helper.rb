@@ -0,0 +1,57 @@
+# Shared setup for the Ruby benchmarks
+#
+# These need a window server and the built extensions, so they only
+# run on OS X:
+#
+#   rake bench:<name>
+
+$LOAD_PATH << 'lib'
+require 'benchmark'
+require 'accessibility/core'
+require 'accessibility/extras'
+
+FIXTURE_PATH = File.expand_path 'test/fixture/Release/AXElementsTester.app'
+FIXTURE_ID   = 'com.marketcircle.AXElementsTester'
+
+def fixture_pids
+  NSWorkspace.sharedWorkspace.runningApplications.select { |app|
+    app.bundleIdentifier == FIXTURE_ID
+  }.map(&:processIdentifier)
+end
+
+# Open `count` new copies of the fixture app and return their pids;
+# they are killed when the benchmark exits
+def launch_fixtures count
+  before = fixture_pids
+  count.times { `open -n #{FIXTURE_PATH}` }
+
+  deadline = Time.now + 30
+  sleep 0.1 until (fixture_pids - before).size >= count || Time.now > deadline
+  pids = fixture_pids - before
+  abort "only #{pids.size} of #{count} fixture apps started" if pids.size < count
+
+  at_exit { pids.each { |pid| Process.kill(:KILL, pid) rescue nil } }
+  sleep 2 # as in test/accessibility/core/fixture.rb
+  pids
+end
+
+# Walk the tree under `app` breadth first until there are `count`
+# elements; fetching the same attribute again gives new element
+# objects, so this goes round the tree as often as it has to
+def collect_elements app, count
+  elements = []
+  queue    = [app]
+  until elements.size >= count
+    queue = [app] if queue.empty?
+    element = queue.shift
+    elements << element
+    children = element.attribute('AXChildren') rescue nil
+    queue.concat children if children
+  end
+  elements
+end
+
+# Best wall clock time of `runs` calls to the block, in milliseconds
+def best_of runs
+  Array.new(runs) { Benchmark.realtime { yield } }.min * 1000
+end
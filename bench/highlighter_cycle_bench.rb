@@ -0,0 +1,49 @@
+# 10k headless highlight cycles, with and without the window pool
+#
+#   rake bench:highlighter_cycle
+#
+# Each cycle makes a headless highlighter and stops it, which is what
+# flashing a highlight over element after element comes down to. A pool
+# limit of 0 closes every window on stop, the way every highlighter used
+# to make and throw away its own. Ruby allocations and windows created
+# are counted for the whole run; latency is per cycle.
+
+require 'bench/helper'
+require 'accessibility/highlighter'
+require 'accessibility/extras'
+
+CYCLES = 10_000
+BOUNDS = [100, 100, 100, 100].to_rect
+
+def percentile sorted, p
+  sorted[((sorted.size - 1) * p).round] * 1_000_000 # in microseconds
+end
+
+def cycles limit
+  Accessibility::Highlighter.drain
+  Accessibility::Highlighter.pool_limit = limit
+  GC.start
+
+  latencies = Array.new(CYCLES)
+  before    = Accessibility::Highlighter.pool_stats
+  objects   = GC.stat(:total_allocated_objects)
+  CYCLES.times do |i|
+    start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    Accessibility::Highlighter.new(BOUNDS, headless: true).stop
+    latencies[i] = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+  end
+  objects = GC.stat(:total_allocated_objects) - objects
+  after   = Accessibility::Highlighter.pool_stats
+
+  sorted = latencies.sort
+  puts format('  pool limit %-3d %7.1f us p50  %7.1f us p99  %7.1f us max  ' \
+              '%5.1f objects/cycle  %5d windows created',
+              limit, percentile(sorted, 0.5), percentile(sorted, 0.99), sorted.last * 1_000_000,
+              objects.fdiv(CYCLES), after[:created] - before[:created])
+end
+
+limit = Accessibility::Highlighter.pool_limit
+puts "highlighter_cycle: #{CYCLES} headless cycles"
+cycles limit
+cycles 0
+Accessibility::Highlighter.pool_limit = limit
@@ -0,0 +1,59 @@
+/*
+ * ss_diff on a pair of 5120x2880 frames, once per kernel this CPU has
+ *
+ *   rake bench:native
+ *
+ * The second frame has 1% of its rows redrawn, so most of the time goes
+ * into comparing equal pixels, as it would for two screenshots.
+ */
+
+#include "synthetic.h"
+#include "image_diff.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WIDTH   5120
+#define HEIGHT  2880
+#define RUNS    10
+
+static const char* const kernel_names[] = { "auto", "scalar", "sse2", "avx2", "neon" };
+
+int
+main(void)
+{
+    bench_frame_t frame;
+    if (bench_frame_init(&frame, WIDTH, HEIGHT))
+        return 1;
+    uint8_t* const before = bench_frame_copy(&frame);
+    if (!before)
+        return 1;
+    bench_frame_step(&frame, 1.0);
+
+    printf("image_diff: %dx%d, best of %d\n", WIDTH, HEIGHT, RUNS);
+    for (ss_diff_kernel_t kernel = SS_DIFF_SCALAR; kernel <= SS_DIFF_NEON; kernel++) {
+        if (!ss_diff_kernel_available(kernel))
+            continue;
+
+        double    best = 1e9;
+        ss_diff_t result;
+        for (int run = 0; run < RUNS; run++) {
+            const double start = bench_now();
+            if (ss_diff(before, frame.stride, frame.pixels, frame.stride,
+                        WIDTH, HEIGHT, 0, NULL, 0, kernel, &result))
+                return 1;
+            const double elapsed = bench_now() - start;
+            if (elapsed < best)
+                best = elapsed;
+        }
+        // both frames are read once
+        const double gigabytes = 2.0 * frame.stride * HEIGHT / 1e9;
+        printf("  %-8s %8.1f ms  %6.2f GB/s  %llu mismatches\n",
+               kernel_names[kernel], best * 1000, gigabytes / best,
+               (unsigned long long)result.mismatches);
+    }
+
+    free(before);
+    bench_frame_free(&frame);
+    return 0;
+}
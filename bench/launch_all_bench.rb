@@ -0,0 +1,62 @@
+# NSWorkspace.launch_all on a simulated launcher with random latencies
+#
+#   rake bench:launch_all
+#
+# Twelve apps each take 0.2 to 1 seconds to get through their phases.
+# A Ruby thread counts while each batch waits, to show how much of the
+# wait other threads get; compare it with the count for a plain sleep
+# of the same length.
+
+require 'bench/helper'
+
+APPS   = 12
+PHASES = { launched: 0.5, responsive: 0.8, window: 1.0 }
+
+class SimulatedLauncher
+  def initialize latencies
+    @latencies = latencies
+    @pids      = {}
+    @started   = {}
+  end
+
+  def launch bundle_id
+    @pids[bundle_id]    = 1000 + @pids.size
+    @started[bundle_id] = Time.now
+    true
+  end
+
+  def pid_for bundle_id
+    @pids[bundle_id]
+  end
+
+  def reached? pid, phase
+    id = @pids.key pid
+    Time.now - @started[id] >= @latencies[id] * PHASES[phase]
+  end
+end
+
+def count_while
+  count  = 0
+  ticker = Thread.new { loop { count += 1; Thread.pass } }
+  elapsed = Benchmark.realtime { yield }
+  ticker.kill.join
+  [elapsed, count]
+end
+
+rng       = Random.new 1337
+ids       = (1..APPS).map { |n| "com.example.app#{n}" }
+latencies = Hash[ids.map { |id| [id, 0.2 + rng.rand(0.8)] }]
+
+printf "launch_all: %d apps, %.1f s of latency in total\n", APPS, latencies.values.reduce(:+)
+[1, 2, 4, APPS].each do |concurrency|
+  launcher = SimulatedLauncher.new latencies
+  results  = nil
+  elapsed, count = count_while {
+    results = NSWorkspace.launch_all ids, concurrency: concurrency, launcher: launcher
+  }
+  abort results.map { |r| r[:error] }.compact.join("\n") if results.any? { |r| r[:error] }
+
+  _, slept = count_while { sleep elapsed }
+  printf "  concurrency %2d  %6.2f s  other thread ran %9d times (%9d while sleeping)\n",
+         concurrency, elapsed, count, slept
+end
@@ -0,0 +1,39 @@
+# Element.partition_valid against Element#invalid? on 20k elements
+# spread across four copies of the fixture app
+#
+#   rake bench:partition_valid
+#
+# Two of the apps are killed along the way: one by a child process
+# while partition_valid is part way through the list, and one before
+# the elements are checked one by one.
+
+require 'bench/helper'
+
+APPS     = 4
+ELEMENTS = 20_000
+
+pids     = launch_fixtures APPS
+elements = pids.flat_map { |pid|
+  collect_elements Accessibility::Element.application_for(pid), ELEMENTS / APPS
+}.shuffle
+
+def kill_later pid, delay
+  Process.detach spawn("sleep #{delay}; kill -9 #{pid}")
+end
+
+puts "partition_valid: #{elements.size} elements across #{APPS} pids"
+Benchmark.bm(22) do |x|
+  x.report('invalid?, all alive')        { elements.each(&:invalid?) }
+  x.report('partition, all alive')       { Accessibility::Element.partition_valid elements }
+
+  # start the kill a little before the check so that it lands mid-way
+  kill_later pids[0], 0.05
+  valid, invalid = nil
+  x.report('partition, one dies')        { valid, invalid = Accessibility::Element.partition_valid elements }
+  puts "#{' ' * 23}#{valid.size} valid, #{invalid.size} invalid"
+
+  Process.kill :KILL, pids[1]
+  sleep 0.5
+  x.report('invalid?, two dead')         { elements.each(&:invalid?) }
+  x.report('partition, dead remembered') { Accessibility::Element.partition_valid elements }
+end
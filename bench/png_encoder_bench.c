@@ -0,0 +1,169 @@
+/*
+ * Encode a 5120x2880 frame as a PNG, serially and in bands
+ *
+ *   rake bench:native
+ *
+ * Bands are compressed on their own threads, like ss_encode does with
+ * dispatch_apply; plain pthreads are used here so that this runs off
+ * OS X too. Banded output should only be a few bytes bigger.
+ *
+ * The last two passes are whole screen shots as ss_take_shot takes
+ * them: the frame is copied into a buffer and its rows are streamed to
+ * a file with ss_png_write_fd, once into one buffer that every shot
+ * reuses, as the pool does, and once into a new buffer per shot.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "synthetic.h"
+#include "png_encoder.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WIDTH    5120
+#define HEIGHT   2880
+#define CHANNELS 3
+#define LEVEL    6
+#define RUNS     3
+
+static
+void*
+encode_band(void* const band)
+{
+    ss_png_encode_band(band);
+    return NULL;
+}
+
+// Returns the encoded size, or 0 on failure
+static
+size_t
+encode(const bench_frame_t* const frame, const size_t threads)
+{
+    ss_png_memory_t memory = { NULL, 0, 0 };
+    int result;
+
+    if (threads < 2) {
+        result = ss_png_encode(ss_png_write_memory, &memory, frame->pixels,
+                               frame->width, frame->height, frame->stride,
+                               CHANNELS, LEVEL, SS_PNG_FILTER_SUB);
+    }
+    else {
+        ss_png_band_t* const bands   = malloc(sizeof(ss_png_band_t) * threads);
+        pthread_t* const     workers = malloc(sizeof(pthread_t) * threads);
+        if (!bands || !workers)
+            return 0;
+
+        const size_t count = ss_png_split_bands(bands, threads, frame->pixels,
+                                                frame->width, frame->height, frame->stride,
+                                                CHANNELS, LEVEL, SS_PNG_FILTER_SUB);
+        for (size_t i = 0; i < count; i++)
+            pthread_create(&workers[i], NULL, encode_band, &bands[i]);
+        for (size_t i = 0; i < count; i++)
+            pthread_join(workers[i], NULL);
+
+        result = ss_png_write_bands(ss_png_write_memory, &memory,
+                                    frame->width, frame->height, CHANNELS, bands, count);
+        ss_png_free_bands(bands, count);
+        free(workers);
+        free(bands);
+    }
+
+    free(memory.bytes);
+    return (result ? 0 : memory.length);
+}
+
+// Returns the size of the file, or 0 on failure; a NULL pool means a
+// new buffer for this shot
+static
+size_t
+shoot(const bench_frame_t* const frame, uint8_t* const pool, const char* const path)
+{
+    const size_t   size   = frame->stride * frame->height;
+    uint8_t* const buffer = (pool ? pool : malloc(size));
+    if (!buffer)
+        return 0;
+    memcpy(buffer, frame->pixels, size); // stands in for the capture
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = -1;
+    off_t length = 0;
+    if (fd >= 0) {
+        result = ss_png_encode(ss_png_write_fd, &fd, buffer,
+                               frame->width, frame->height, frame->stride,
+                               CHANNELS, LEVEL, SS_PNG_FILTER_SUB);
+        length = lseek(fd, 0, SEEK_CUR);
+        if (close(fd))
+            result = -1;
+    }
+
+    if (!pool)
+        free(buffer);
+    return ((result || length < 0) ? 0 : (size_t)length);
+}
+
+int
+main(void)
+{
+    bench_frame_t frame;
+    if (bench_frame_init(&frame, WIDTH, HEIGHT))
+        return 1;
+
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("png_encoder: %dx%d, level %d, sub filter, %ld core(s), best of %d\n",
+           WIDTH, HEIGHT, LEVEL, cores, RUNS);
+
+    static const size_t thread_counts[] = { 1, 2, 4, 8 };
+    double serial = 0;
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        double best   = 1e9;
+        size_t length = 0;
+        for (int run = 0; run < RUNS; run++) {
+            const double start = bench_now();
+            length = encode(&frame, thread_counts[t]);
+            const double elapsed = bench_now() - start;
+            if (!length)
+                return 1;
+            if (elapsed < best)
+                best = elapsed;
+        }
+        if (t == 0)
+            serial = best;
+        // no more than `cores` bands can really run at once
+        printf("  %zu thread(s)  %8.1f ms  %10zu bytes  %4.2fx\n",
+               thread_counts[t], best * 1000, length, serial / best);
+    }
+
+    char path[] = "/tmp/png_encoder_bench.XXXXXX";
+    const int fd = mkstemp(path);
+    uint8_t* const pool = malloc(frame.stride * frame.height);
+    if (fd < 0 || !pool)
+        return 1;
+    close(fd);
+
+    for (int pooled = 1; pooled >= 0; pooled--) {
+        double best   = 1e9;
+        size_t length = 0;
+        for (int run = 0; run < RUNS; run++) {
+            const double start = bench_now();
+            length = shoot(&frame, (pooled ? pool : NULL), path);
+            const double elapsed = bench_now() - start;
+            if (!length)
+                return 1;
+            if (elapsed < best)
+                best = elapsed;
+        }
+        printf("  shot, %-6s  %8.1f ms  %10zu bytes\n",
+               (pooled ? "pooled" : "fresh"), best * 1000, length);
+    }
+
+    unlink(path);
+    free(pool);
+
+    bench_frame_free(&frame);
+    return 0;
+}
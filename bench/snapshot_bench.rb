@@ -0,0 +1,37 @@
+# Snapshot.new, Snapshot#refresh and Snapshot#diff on generated trees
+# of 1k to 100k elements
+#
+#   rake bench:snapshot
+#
+# The fixture window hangs a tree of the given size off itself, and
+# then replaces the given share of its leaves with new elements before
+# each refresh, so every refresh has to find the changed children.
+
+require 'bench/helper'
+
+SIZES = [1_000, 10_000, 100_000]
+CHURN = [0, 1, 10]
+
+pid    = launch_fixtures(1).first
+window = Accessibility::Element.application_for(pid).attribute('AXWindows').first
+
+puts 'snapshot: full snapshot, then refresh and diff after churning leaves'
+SIZES.each do |size|
+  window.set 'AXSimulatedTreeSize', size
+  tree = window.children.find { |x| x.attribute('AXIdentifier') == 'Simulated Tree' }
+
+  snapshot = nil
+  full     = Benchmark.realtime { snapshot = Accessibility::Snapshot.new tree }
+  printf "  %6d nodes  full %9.1f ms\n", snapshot.size, full * 1000
+
+  CHURN.each do |percent|
+    window.set 'AXSimulatedTreeChurn', percent
+    refreshed, records = nil
+    refresh = Benchmark.realtime { refreshed = snapshot.refresh }
+    diff    = Benchmark.realtime { records   = snapshot.diff refreshed }
+    printf "    %3d%% churn  refresh %9.1f ms  diff %7.1f ms  %6d records\n",
+           percent, refresh * 1000, diff * 1000, records.size
+    snapshot = refreshed
+  end
+end
+window.set 'AXSimulatedTreeSize', 0
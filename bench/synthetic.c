@@ -0,0 +1,109 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "synthetic.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static
+uint32_t
+next_random(uint32_t* const seed)
+{
+    // xorshift32; good enough for pixels
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (*seed = x);
+}
+
+static
+void
+put(uint8_t* const px, const uint8_t b, const uint8_t g, const uint8_t r)
+{
+    px[0] = b;
+    px[1] = g;
+    px[2] = r;
+    px[3] = 255;
+}
+
+// Draw rows [top, bottom); `phase` shifts the text so redrawn rows change
+static
+void
+draw_rows(bench_frame_t* const frame, const uint32_t top, const uint32_t bottom,
+          const uint32_t phase)
+{
+    const uint32_t window_left  = frame->width / 8;
+    const uint32_t window_right = frame->width - frame->width / 8;
+
+    for (uint32_t y = top; y < bottom; y++) {
+        uint8_t* const row = frame->pixels + (size_t)y * frame->stride;
+        const int  in_text = ((y + phase) % 18) < 11;
+        for (uint32_t x = 0; x < frame->width; x++) {
+            uint8_t* const px = row + (size_t)x * 4;
+            if (x < window_left || x >= window_right) {
+                put(px, (uint8_t)(y * 255 / frame->height), 96, (uint8_t)(x * 255 / frame->width));
+            }
+            else if (in_text && ((x + phase * 7) % 9) < 5 &&
+                     (next_random(&frame->seed) & 3)) {
+                const uint8_t ink = (uint8_t)(next_random(&frame->seed) & 63);
+                put(px, ink, ink, ink);
+            }
+            else {
+                put(px, 246, 246, 246);
+            }
+        }
+    }
+}
+
+int
+bench_frame_init(bench_frame_t* const frame, const uint32_t width, const uint32_t height)
+{
+    frame->width  = width;
+    frame->height = height;
+    frame->stride = (size_t)width * 4;
+    frame->seed   = 2463534242u;
+    frame->pixels = malloc(frame->stride * height);
+    if (!frame->pixels)
+        return -1;
+    draw_rows(frame, 0, height, 0);
+    return 0;
+}
+
+void
+bench_frame_free(bench_frame_t* const frame)
+{
+    free(frame->pixels);
+    frame->pixels = NULL;
+}
+
+void
+bench_frame_step(bench_frame_t* const frame, const double percent)
+{
+    const uint32_t rows = (uint32_t)(frame->height * percent / 100.0);
+    if (!rows)
+        return;
+
+    static uint32_t step;
+    step++;
+    const uint32_t top = (step * 37) % (frame->height - rows + 1);
+    draw_rows(frame, top, top + rows, step);
+}
+
+uint8_t*
+bench_frame_copy(const bench_frame_t* const frame)
+{
+    uint8_t* const copy = malloc(frame->stride * frame->height);
+    if (copy)
+        memcpy(copy, frame->pixels, frame->stride * frame->height);
+    return copy;
+}
+
+double
+bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
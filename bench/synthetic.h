@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A synthetic framebuffer for the native benchmarks, so that they run
+ * anywhere the C files build, without a window server.
+ *
+ * Frames are 32-bit BGRA, like a capture. They look roughly like a
+ * desktop: a gradient, a few flat windows with rows of "text", and
+ * noise that keeps the compressor honest.
+ */
+
+typedef struct {
+    uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    size_t   stride;
+    uint32_t seed;
+} bench_frame_t;
+
+// Allocate and draw the first frame; returns 0 on success
+int bench_frame_init(bench_frame_t* frame, uint32_t width, uint32_t height);
+
+void bench_frame_free(bench_frame_t* frame);
+
+// Redraw about `percent` of the frame, in a band of full rows that
+// moves down a bit every step, the way a scrolling window would
+void bench_frame_step(bench_frame_t* frame, double percent);
+
+// Copy of a frame's pixels; free() it when done
+uint8_t* bench_frame_copy(const bench_frame_t* frame);
+
+// Monotonic seconds
+double bench_now(void);
@@ -0,0 +1,51 @@
+# Reading a simulated 10M character text element whole and in chunks
+#
+#   rake bench:text_chunk
+#
+# Each way of reading runs in its own process, which reports how much
+# its resident size grew and the largest string it had to hold; the
+# chunked reads should stay near the chunk size no matter how long the
+# text is.
+
+require 'bench/helper'
+
+LENGTH = 10_000_000
+MODES  = {
+  'whole'       => nil,
+  'chunks, 64k' => 65_536,
+  'chunks, 4k'  => 4_096
+}
+
+def fixture_window pid
+  Accessibility::Element.application_for(pid).attribute('AXWindows').first
+end
+
+def rss_kb
+  `ps -o rss= -p #{Process.pid}`.to_i
+end
+
+if (mode = ARGV.first)
+  window  = fixture_window ARGV[1].to_i
+  before  = rss_kb
+  largest = 0
+  time    = Benchmark.realtime {
+    if (size = MODES[mode])
+      window.each_text_chunk(chunk_size: size) { |chunk|
+        largest = chunk.bytesize if chunk.bytesize > largest
+      }
+    else
+      largest = window.parameterized_attribute('AXStringForRange', 0...LENGTH).bytesize
+    end
+  }
+  printf "  %-12s %8.1f ms  %8.1f MB grown  %8.1f MB largest string\n",
+         mode, time * 1000, (rss_kb - before) / 1024.0, largest / 1e6
+  exit
+end
+
+pid = launch_fixtures(1).first
+fixture_window(pid).set 'AXSimulatedTextLength', LENGTH
+
+puts "text_chunk: #{LENGTH} characters"
+MODES.each_key do |name|
+  system RbConfig.ruby, '-I.', __FILE__, name, pid.to_s
+end
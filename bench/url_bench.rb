@@ -0,0 +1,27 @@
+# Bridging 100k file URLs, natively and through URI.parse
+#
+#   rake bench:url
+#
+# Each pass makes a URL from a string and reads its last path component
+# and extension, which is what reading AXURL or AXDocument across many
+# elements comes down to; the URI.parse pass is what every URL used to
+# go through.
+
+require 'bench/helper'
+
+COUNT = 100_000
+
+strings = Array.new(COUNT) { |i| "file:///Users/tester/Documents/project#{i % 100}/file#{i}.txt" }
+
+puts "url: #{COUNT} file URLs"
+Benchmark.bm(18) do |x|
+  x.report('URI.parse') {
+    strings.each { |s| u = URI.parse(s); u.lastPathComponent; u.pathExtension }
+  }
+  x.report('Accessibility::URL') {
+    strings.each { |s| u = Accessibility::URL.new(s); u.lastPathComponent; u.pathExtension }
+  }
+  urls = strings.map { |s| Accessibility::URL.new s }
+  x.report('to_uri, first') { urls.each(&:to_uri) }
+  x.report('to_uri, again') { urls.each(&:to_uri) }
+end
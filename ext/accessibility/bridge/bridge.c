@@ -2,20 +2,11 @@
 #include "ruby/encoding.h"
 #include "assert.h"
 
-//For versions OS X < 10.11 use old constants
-#ifndef MAC_OS_X_VERSION_10_11
-#define	kAXValueTypeIllegal kAXValueIllegalType
-#define kAXValueTypeCGPoint kAXValueCGPointType
-#define kAXValueTypeCGSize kAXValueCGSizeType
-#define kAXValueTypeCGRect kAXValueCGRectType
-#define kAXValueTypeCFRange kAXValueCFRangeType
-#define kAXValueTypeAXError kAXValueAXErrorType
-#endif
-
 void
 spin(const double seconds)
 {
-  NSDate* const interval = [NSDate dateWithTimeIntervalSinceNow:seconds];
+  // owned, not autoreleased, since callers may or may not have a pool
+  NSDate* const interval = [[NSDate alloc] initWithTimeIntervalSinceNow:seconds];
   [[NSRunLoop currentRunLoop] runUntilDate:interval];
   [interval release];
 }
@@ -30,6 +21,7 @@ VALUE rb_cCGSize;
 VALUE rb_cCGRect;
 VALUE rb_mURI; // URI module
 VALUE rb_cURI; // URI::Generic class
+VALUE rb_cURL; // Accessibility::URL class
 VALUE rb_cScreen;
 
 ID sel_x;
@@ -455,25 +447,73 @@ VALUE wrap_array_numbers(CFArrayRef const array) { WRAP_ARRAY(wrap_number) }
 
 
 
+// URLs stay as CFURLs until something needs a URI object, which is
+// then parsed once and kept around (Qundef until then)
+typedef struct {
+  CFURLRef url;
+  VALUE    uri;
+} url_t;
+
+static
+void
+url_mark(void* const data)
+{
+  rb_gc_mark(((url_t*)data)->uri);
+}
+
+static
+void
+url_free(void* const data)
+{
+  CFRelease(((url_t*)data)->url);
+  xfree(data);
+}
+
+static
+url_t*
+url_data(const VALUE url)
+{
+  url_t* data;
+  Data_Get_Struct(url, url_t, data);
+  return data;
+}
+
+static
+VALUE
+wrap_cf_string_or_nil(CFStringRef const string)
+{
+  if (!string)
+    return Qnil;
+  const VALUE str = wrap_string(string);
+  CFRelease(string);
+  return str;
+}
+
 VALUE
 wrap_url(CFURLRef const url)
 {
-  // @note CFURLGetString does not need to be CFReleased since it is a Get
-  return rb_funcall(rb_mURI, sel_parse, 1, wrap_string(CFURLGetString(url)));
+  url_t* data;
+  const VALUE obj = Data_Make_Struct(rb_cURL, url_t, url_mark, url_free, data);
+  data->url = url;
+  data->uri = Qundef;
+  return obj;
 }
 
 VALUE
 wrap_nsurl(NSURL* const url)
 {
-  NSString* const str = [url absoluteString];
-  const VALUE  rb_str = wrap_nsstring(str);
-  [str release];
-  return rb_funcall(rb_mURI, sel_parse, 1, rb_str);
+  return wrap_url((CFURLRef)url);
 }
 
 CFURLRef
 unwrap_url(const VALUE url)
 {
+  if (CLASS_OF(url) == rb_cURL) {
+    CFURLRef const url_ref = url_data(url)->url;
+    CFRetain(url_ref);
+    return url_ref;
+  }
+
   // TODO: should also force encoding to UTF-8 first?
     VALUE url_string = rb_funcall(url, sel_to_s, 0);
     CFStringRef const string =
@@ -559,9 +599,17 @@ wrap_dictionary(NSDictionary* const dict)
 {
     const VALUE hash = rb_hash_new();
 
+    // keys and values are borrowed, but wrappers like wrap_url take
+    // ownership, so hand them a +1 reference and drop it if unused
     [dict enumerateKeysAndObjectsUsingBlock:
      ^(const id key, const id obj, BOOL* const stop) {
-            rb_hash_aset(hash, to_ruby(key), to_ruby(obj));
+            [key retain];
+            [obj retain];
+            const VALUE rb_key = to_ruby(key);
+            const VALUE rb_obj = to_ruby(obj);
+            if (TYPE(rb_key) != T_DATA) [key release];
+            if (TYPE(rb_obj) != T_DATA) [obj release];
+            rb_hash_aset(hash, rb_key, rb_obj);
         }];
 
   return hash;
@@ -616,7 +664,7 @@ to_ax(const VALUE obj)
     else if (type == rb_cData)
         return unwrap_data(obj);
 
-    if (rb_obj_is_kind_of(obj, rb_cURI))
+    if (type == rb_cURL || rb_obj_is_kind_of(obj, rb_cURI))
         return unwrap_url(obj);
 
     // give up if we get this far
@@ -742,6 +790,193 @@ rb_spin(const int argc, VALUE* const argv, const VALUE self)
 }
 
 
+/*
+ * Create a URL from a string
+ *
+ * @param string [String]
+ * @return [Accessibility::URL]
+ */
+static
+VALUE
+rb_url_new(const VALUE self, const VALUE string)
+{
+  CFStringRef const str = unwrap_string(string);
+  CFURLRef    const url = CFURLCreateWithString(NULL, str, NULL);
+  CFRelease(str);
+  if (!url) {
+    volatile VALUE inspected = rb_inspect(string);
+    rb_raise(rb_eArgError, "invalid URL %s", StringValueCStr(inspected));
+  }
+  return wrap_url(url);
+}
+
+/*
+ * The scheme of the URL, such as `"file"` or `"https"`
+ *
+ * @return [String,nil]
+ */
+static
+VALUE
+rb_url_scheme(const VALUE self)
+{
+  return wrap_cf_string_or_nil(CFURLCopyScheme(url_data(self)->url));
+}
+
+/*
+ * The path of the URL, with percent escapes left as they are
+ *
+ * @return [String]
+ */
+static
+VALUE
+rb_url_path(const VALUE self)
+{
+  const VALUE path = wrap_cf_string_or_nil(CFURLCopyPath(url_data(self)->url));
+  return (path == Qnil ? rb_str_new2("") : path);
+}
+
+/*
+ * Return the last component of the path of the URL
+ *
+ * @example
+ *
+ *   url = "https://macruby.macosforge.org/files/nightlies/macruby_nightly-latest.pkg"
+ *   Accessibility::URL.new(url).lastPathComponent # => "macruby_nightly-latest.pkg"
+ *
+ * @return [String,nil]
+ */
+static
+VALUE
+rb_url_last_path_component(const VALUE self)
+{
+  return wrap_cf_string_or_nil(CFURLCopyLastPathComponent(url_data(self)->url));
+}
+
+/*
+ * Returns the path extension of the URL, or an empty string if the
+ * path has no extension
+ *
+ * @return [String]
+ */
+static
+VALUE
+rb_url_path_extension(const VALUE self)
+{
+  const VALUE ext = wrap_cf_string_or_nil(CFURLCopyPathExtension(url_data(self)->url));
+  return (ext == Qnil ? rb_str_new2("") : ext);
+}
+
+/*
+ * The URL as a string
+ *
+ * @return [String]
+ */
+static
+VALUE
+rb_url_to_s(const VALUE self)
+{
+  // @note CFURLGetString does not need to be CFReleased since it is a Get
+  return wrap_string(CFURLGetString(url_data(self)->url));
+}
+
+// The parsed URI, which is frozen since it is shared by every call that
+// gets forwarded to it; use rb_url_to_uri for a copy that can be changed
+static
+VALUE
+rb_url_cached_uri(const VALUE self)
+{
+  url_t* const data = url_data(self);
+  if (data->uri == Qundef)
+    data->uri = rb_obj_freeze(rb_funcall(rb_mURI, sel_parse, 1, rb_url_to_s(self)));
+  return data->uri;
+}
+
+/*
+ * Returns a `URI` object for the URL
+ *
+ * The URL is only parsed the first time this is called; after that each
+ * call gets a copy of the same URI. The copy belongs to the caller, so
+ * changing it does not change the receiver.
+ *
+ * @return [URI::Generic]
+ */
+static
+VALUE
+rb_url_to_uri(const VALUE self)
+{
+  return rb_obj_dup(rb_url_cached_uri(self));
+}
+
+// Make a changed URI the new value of the receiver; this is how setters
+// that are forwarded by method_missing take effect
+static
+VALUE
+rb_url_replace_uri(const VALUE self, const VALUE uri)
+{
+  const VALUE      string = rb_funcall(uri, sel_to_s, 0);
+  CFStringRef const   str = unwrap_string(string);
+  CFURLRef    const   url = CFURLCreateWithString(NULL, str, NULL);
+  CFRelease(str);
+  if (!url) {
+    volatile VALUE inspected = rb_inspect(string);
+    rb_raise(rb_eArgError, "invalid URL %s", StringValueCStr(inspected));
+  }
+
+  url_t* const data = url_data(self);
+  CFRelease(data->url);
+  data->url = url;
+  data->uri = rb_obj_freeze(rb_obj_dup(uri));
+  return self;
+}
+
+/*
+ * Returns the receiver (since the receiver is already a URL)
+ *
+ * @return [Accessibility::URL]
+ */
+static
+VALUE
+rb_url_to_url(const VALUE self)
+{
+  return self;
+}
+
+static
+VALUE
+rb_url_equality(const VALUE self, const VALUE other)
+{
+  if (CLASS_OF(other) == rb_cURL)
+    return (CFEqual(url_data(self)->url, url_data(other)->url) ? Qtrue : Qfalse);
+  if (rb_obj_is_kind_of(other, rb_cURI))
+    return rb_equal(rb_url_to_s(self), rb_funcall(other, sel_to_s, 0));
+  return Qfalse;
+}
+
+static
+VALUE
+rb_url_eql(const VALUE self, const VALUE other)
+{
+  if (CLASS_OF(other) == rb_cURL)
+    return (CFEqual(url_data(self)->url, url_data(other)->url) ? Qtrue : Qfalse);
+  return Qfalse;
+}
+
+static
+VALUE
+rb_url_hash(const VALUE self)
+{
+  return ULONG2NUM((unsigned long)CFHash(url_data(self)->url));
+}
+
+static
+VALUE
+rb_url_inspect(const VALUE self)
+{
+  const VALUE str = rb_url_to_s(self);
+  return rb_sprintf("#<%s %s>", rb_obj_classname(self), StringValueCStr(str));
+}
+
+
 void
 Init_bridge()
 {
@@ -766,6 +1001,37 @@ Init_bridge()
     rb_cURI           = rb_const_get(rb_mURI, rb_intern("Generic"));
 
 
+    /*
+     * Document-class: Accessibility::URL
+     *
+     * A URL that is kept as a `CFURL` until a `URI` object is really
+     * needed. The common `NSURL` style accessors are answered directly
+     * from the `CFURL`; anything else is forwarded to a parsed `URI`,
+     * and setters such as `path=` change the URL itself.
+     *
+     * This is not a `URI::Generic`, so checks like `kind_of?(URI)` are
+     * false for it; call {#to_uri} where a real `URI` is needed.
+     */
+    rb_cURL = rb_define_class_under(rb_mAccessibility, "URL", rb_cObject);
+
+    rb_undef_alloc_func(rb_cURL);
+    rb_define_singleton_method(rb_cURL, "new", rb_url_new, 1);
+
+    rb_define_method(rb_cURL, "scheme",            rb_url_scheme,              0);
+    rb_define_method(rb_cURL, "path",              rb_url_path,                0);
+    rb_define_method(rb_cURL, "lastPathComponent", rb_url_last_path_component, 0);
+    rb_define_method(rb_cURL, "pathExtension",     rb_url_path_extension,      0);
+    rb_define_method(rb_cURL, "to_s",              rb_url_to_s,                0);
+    rb_define_method(rb_cURL, "to_uri",            rb_url_to_uri,              0);
+    rb_define_private_method(rb_cURL, "cached_uri",  rb_url_cached_uri,          0);
+    rb_define_private_method(rb_cURL, "replace_uri", rb_url_replace_uri,         1);
+    rb_define_method(rb_cURL, "to_url",            rb_url_to_url,              0);
+    rb_define_method(rb_cURL, "==",                rb_url_equality,            1);
+    rb_define_method(rb_cURL, "eql?",              rb_url_eql,                 1);
+    rb_define_method(rb_cURL, "hash",              rb_url_hash,                0);
+    rb_define_method(rb_cURL, "inspect",           rb_url_inspect,             0);
+
+
     /*
      * Document-class: NSAttributedString
      *
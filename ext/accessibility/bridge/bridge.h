@@ -3,6 +3,16 @@
 #include "ruby.h"
 #import <Cocoa/Cocoa.h>
 
+//For versions OS X < 10.11 use old constants
+#ifndef MAC_OS_X_VERSION_10_11
+#define	kAXValueTypeIllegal kAXValueIllegalType
+#define kAXValueTypeCGPoint kAXValueCGPointType
+#define kAXValueTypeCGSize kAXValueCGSizeType
+#define kAXValueTypeCGRect kAXValueCGRectType
+#define kAXValueTypeCFRange kAXValueCFRangeType
+#define kAXValueTypeAXError kAXValueAXErrorType
+#endif
+
 // these functions are available on MacRuby as well as MRI
 void spin(const double seconds);
 
@@ -19,6 +29,7 @@ extern VALUE rb_cCGSize;
 extern VALUE rb_cCGRect;
 extern VALUE rb_mURI; // URI module
 extern VALUE rb_cURI; // URI::Generic class
+extern VALUE rb_cURL; // Accessibility::URL class
 extern VALUE rb_cScreen;
 
 extern ID sel_x;
@@ -121,6 +132,7 @@ CFNumberRef unwrap_long_long(const VALUE num);
 CFNumberRef unwrap_float(const VALUE num);
 CFNumberRef unwrap_number(const VALUE number);
 
+// the new Accessibility::URL takes ownership of the given URL
 VALUE wrap_url(CFURLRef const url);
 VALUE wrap_nsurl(NSURL* const url);
 CFURLRef unwrap_url(const VALUE url);
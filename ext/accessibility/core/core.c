@@ -1,16 +1,32 @@
 #include "ruby.h"
 #include "../bridge/bridge.h"
 #import <Cocoa/Cocoa.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/sysctl.h>
 
 
 static ID ivar_attrs;
 static ID ivar_param_attrs;
 static ID ivar_actions;
 static ID ivar_pid;
+static ID ivar_application;
 static ID ivar_key_rate;
 
 static ID sel_to_f;
 
+static VALUE rb_cSnapshot;
+
+static VALUE rb_mError;
+static VALUE rb_eUnknownError;
+
+static ID ivar_error_code;
+static ID ivar_error_element;
+static ID ivar_error_message;
+
+static VALUE rb_cApplication;
+static VALUE applications; // pid => Accessibility::Application
+
 static ID rate_very_slow;
 static ID rate_slow;
 static ID rate_normal;
@@ -18,131 +34,384 @@ static ID rate_default;
 static ID rate_fast;
 static ID rate_zomg;
 
+// Dead elements never come back to life, so once we have seen one we
+// remember it and skip the round trip to the accessibility server the
+// next time someone asks; the set is bounded so that long running
+// processes do not accumulate refs forever
+static CFMutableSetRef dead_elements;
+#define DEAD_ELEMENTS_MAX 65536
+
+// Default number of characters fetched per chunk in each_text_chunk
+#define DEFAULT_TEXT_CHUNK_SIZE 65536
+
+static VALUE key_chunk_size;
+
+static VALUE sym_added;
+static VALUE sym_removed;
+static VALUE sym_changed;
+
+// Number of distinct pids that rb_acore_partition_valid will remember
+// during a single pass
+#define PARTITION_PID_TABLE_SIZE 64
+
+
+enum error_base { ARG_ERROR, RUNTIME_ERROR, NOT_IMP_ERROR };
+
+// every AXError gets its own exception class; the superclasses are the
+// same ones that were used before the structured errors existed so that
+// old rescue clauses keep working
+static struct {
+  const AXError            code;
+  const char* const        name;
+  const enum error_base    base;
+  VALUE                    klass;
+} error_classes[] = {
+  { kAXErrorFailure,                           "FailureError",                           RUNTIME_ERROR, Qnil },
+  { kAXErrorIllegalArgument,                   "IllegalArgumentError",                   ARG_ERROR,     Qnil },
+  { kAXErrorInvalidUIElement,                  "InvalidElementError",                    ARG_ERROR,     Qnil },
+  { kAXErrorInvalidUIElementObserver,          "InvalidObserverError",                   ARG_ERROR,     Qnil },
+  { kAXErrorCannotComplete,                    "CannotCompleteError",                    RUNTIME_ERROR, Qnil },
+  { kAXErrorAttributeUnsupported,              "AttributeUnsupportedError",              ARG_ERROR,     Qnil },
+  { kAXErrorActionUnsupported,                 "ActionUnsupportedError",                 ARG_ERROR,     Qnil },
+  { kAXErrorNotificationUnsupported,           "NotificationUnsupportedError",           ARG_ERROR,     Qnil },
+  { kAXErrorNotImplemented,                    "NotImplementedAXError",                  NOT_IMP_ERROR, Qnil },
+  { kAXErrorNotificationAlreadyRegistered,     "NotificationAlreadyRegisteredError",     ARG_ERROR,     Qnil },
+  { kAXErrorNotificationNotRegistered,         "NotificationNotRegisteredError",         RUNTIME_ERROR, Qnil },
+  { kAXErrorAPIDisabled,                       "APIDisabledError",                       RUNTIME_ERROR, Qnil },
+  { kAXErrorNoValue,                           "NoValueError",                           RUNTIME_ERROR, Qnil },
+  { kAXErrorParameterizedAttributeUnsupported, "ParameterizedAttributeUnsupportedError", ARG_ERROR,     Qnil },
+  { kAXErrorNotEnoughPrecision,                "NotEnoughPrecisionError",                RUNTIME_ERROR, Qnil },
+};
+#define ERROR_CLASSES_COUNT (sizeof(error_classes) / sizeof(error_classes[0]))
+
+static
+VALUE
+acore_error_class(const AXError code)
+{
+  for (size_t i = 0; i < ERROR_CLASSES_COUNT; i++)
+    if (error_classes[i].code == code)
+      return error_classes[i].klass;
+  return rb_eUnknownError;
+}
+
+
+/*
+ * Whether the application went away is only worth knowing as of when
+ * the error happened, so this message cannot wait until it is asked for
+ */
+static
+VALUE
+acore_cannot_complete_message(VALUE element)
+{
+  spin(0);
+
+  pid_t pid = 0;
+  AXUIElementGetPid(unwrap_ref(element), &pid);
+  NSRunningApplication* const app =
+    [NSRunningApplication runningApplicationWithProcessIdentifier:pid];
+
+  if (app)
+    return rb_str_new_cstr("accessibility messaging failure. "
+			   "Perhaps the application is busy or unresponsive?");
+  return rb_sprintf("application for pid=%d is no longer running. "
+		    "Maybe it crashed?",
+		    pid);
+}
 
+/*
+ * Raise the exception that matches the given error code
+ *
+ * Other than for kAXErrorCannotComplete, nothing is formatted here;
+ * exceptions are frequently rescued right away, so the message is only
+ * built if someone asks for it.
+ */
 static
 VALUE
 handle_error(VALUE self, const AXError code)
 {
+  VALUE error = rb_class_new_instance(0, NULL, acore_error_class(code));
+  rb_ivar_set(error, ivar_error_code,    INT2FIX(code));
+  rb_ivar_set(error, ivar_error_element, self);
+  if (code == kAXErrorCannotComplete)
+    rb_ivar_set(error, ivar_error_message, acore_cannot_complete_message(self));
+  rb_exc_raise(error);
+  return Qnil; // unreachable
+}
+
+
+static
+VALUE
+acore_error_message(const AXError code, VALUE element)
+{
+  switch (code) {
+  case kAXErrorSuccess:
+    return rb_str_new_cstr("internal accessibility_core error");
+
+  case kAXErrorAttributeUnsupported:
+    return rb_str_new_cstr("attribute unsupported");
+
+  case kAXErrorActionUnsupported:
+    return rb_str_new_cstr("action unsupported");
+
+  case kAXErrorNotificationUnsupported:
+    return rb_str_new_cstr("notification unsupported");
+
+  case kAXErrorNotImplemented:
+    return rb_str_new_cstr("method not supported by the receiver");
+
+  case kAXErrorNotificationAlreadyRegistered:
+    return rb_str_new_cstr("notification has already been registered");
+
+  case kAXErrorNotificationNotRegistered:
+    return rb_str_new_cstr("notification is not registered yet");
+
+  case kAXErrorAPIDisabled:
+    return rb_str_new_cstr("AXAPI has been disabled");
+
+  case kAXErrorNoValue:
+    return rb_str_new_cstr("accessibility_core internal error; "
+			   "should be handled internally");
+
+  case kAXErrorParameterizedAttributeUnsupported:
+    return rb_str_new_cstr("parameterized attribute unsupported");
+
+  case kAXErrorNotEnoughPrecision:
+    return rb_str_new_cstr("AXAPI said there was not enough precision ¯\\(°_o)/¯");
+
+  case kAXErrorCannotComplete: // handle_error normally fills this in
+    return acore_cannot_complete_message(element);
+
+  default:
+    break;
+  }
+
   @autoreleasepool {
     NSString* const description =
-        (NSString* const)CFCopyDescription(unwrap_ref(self));
+        (NSString* const)CFCopyDescription(unwrap_ref(element));
     [description autorelease];
 
     const char* const inspected_self = description.UTF8String;
 
     switch (code) {
-    case kAXErrorSuccess:
-	rb_raise(rb_eRuntimeError,
-		 "internal accessibility_core error");
-
     case kAXErrorFailure:
-	rb_raise(rb_eRuntimeError,
-		 "An accessibility system failure, possibly an allocation "
-		 "failure, occurred with %s; stopping to be safe",
-		 inspected_self);
+      return rb_sprintf("An accessibility system failure, possibly an allocation "
+			"failure, occurred with %s; stopping to be safe",
+			inspected_self);
 
     case kAXErrorIllegalArgument:
-	rb_raise(rb_eArgError,
-		 "illegal argument was passed to the method for %s",
-		 inspected_self);
+      return rb_sprintf("illegal argument was passed to the method for %s",
+			inspected_self);
 
     case kAXErrorInvalidUIElement:
-	rb_raise(rb_eArgError,
-		 "invalid element `%s' (probably dead)",
-		 inspected_self);
+      return rb_sprintf("invalid element `%s' (probably dead)",
+			inspected_self);
 
     case kAXErrorInvalidUIElementObserver:
-	rb_raise(rb_eArgError,
-		 "invalid observer passed to the method for %s",
-		 inspected_self);
-
-    case kAXErrorCannotComplete:
-	spin(0);
-
-        pid_t pid = 0;
-	AXUIElementGetPid(unwrap_ref(self), &pid);
-	NSRunningApplication* const app =
-            [NSRunningApplication runningApplicationWithProcessIdentifier:pid];
-
-	if (app)
-            rb_raise(rb_eRuntimeError,
-                     "accessibility messaging failure. "
-                     "Perhaps the application is busy or unresponsive?");
-	else
-            rb_raise(rb_eRuntimeError,
-                     "application for pid=%d is no longer running. "
-                     "Maybe it crashed?",
-                     pid);
+      return rb_sprintf("invalid observer passed to the method for %s",
+			inspected_self);
 
-    case kAXErrorAttributeUnsupported:
-        rb_raise(rb_eArgError, "attribute unsupported");
+    default:
+      return rb_sprintf("accessibility_core majorly goofed [%d]", (int)code);
+    }
+  }
+}
+
+/*
+ * The message is built on first use and then cached
+ *
+ * @return [String]
+ */
+static
+VALUE
+rb_error_message(VALUE self)
+{
+  VALUE message = rb_ivar_get(self, ivar_error_message);
+  if (message == Qnil) {
+    VALUE code = rb_ivar_get(self, ivar_error_code);
+    if (code == Qnil) // not raised by us, so there is nothing to add
+      return rb_call_super(0, NULL);
+
+    message = acore_error_message(FIX2INT(code), rb_ivar_get(self, ivar_error_element));
+    rb_ivar_set(self, ivar_error_message, message);
+  }
+  return message;
+}
 
-    case kAXErrorActionUnsupported:
-        rb_raise(rb_eArgError, "action unsupported");
+/*
+ * The `AXError` code returned by the accessibility API
+ *
+ * @return [Fixnum]
+ */
+static
+VALUE
+rb_error_code(VALUE self)
+{
+  return rb_ivar_get(self, ivar_error_code);
+}
 
-    case kAXErrorNotificationUnsupported:
-        rb_raise(rb_eArgError, "notification unsupported");
+/*
+ * The element that the failed call was made on
+ *
+ * @return [Accessibility::Element]
+ */
+static
+VALUE
+rb_error_element(VALUE self)
+{
+  return rb_ivar_get(self, ivar_error_element);
+}
 
-    case kAXErrorNotImplemented:
-        rb_raise(rb_eNotImpError, "method not supported by the receiver");
 
-    case kAXErrorNotificationAlreadyRegistered:
-	rb_raise(rb_eArgError, "notification has already been registered");
+static
+int
+acore_pid_is_alive(const pid_t pid)
+{
+  if (pid <= 0)
+    return 0;
+  // signal 0 only checks that the process exists, which is much cheaper
+  // than asking NSRunningApplication (and does not need the run loop)
+  return (kill(pid, 0) == 0 || errno == EPERM);
+}
 
-    case kAXErrorNotificationNotRegistered:
-	rb_raise(rb_eRuntimeError, "notification is not registered yet");
 
-    case kAXErrorAPIDisabled:
-	rb_raise(rb_eRuntimeError, "AXAPI has been disabled");
+// When the process was started, which tells a reused pid apart from the
+// process that the pid used to belong to
+static
+int
+acore_process_started(const pid_t pid, struct timeval* const started)
+{
+  int               mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, pid };
+  struct kinfo_proc info;
+  size_t            size   = sizeof(info);
+
+  if (sysctl(mib, 4, &info, &size, NULL, 0) || size != sizeof(info))
+    return 0;
+  *started = info.kp_proc.p_starttime;
+  return 1;
+}
 
-    case kAXErrorNoValue:
-	rb_raise(rb_eRuntimeError,
-                 "accessibility_core internal error; "
-		 "should be handled internally");
 
-    case kAXErrorParameterizedAttributeUnsupported:
-	rb_raise(rb_eArgError, "parameterized attribute unsupported");
+typedef struct {
+  pid_t                     pid;
+  struct timeval        started;
+  int                   started_known; // sysctl can fail for other users' processes
+  NSRunningApplication* running_app;
+  VALUE                 element;
+  VALUE                 bundle_id; // Qundef until first asked for
+  VALUE                 name;      // Qundef until first asked for
+  VALUE                 timeout;
+} acore_app_t;
 
-    case kAXErrorNotEnoughPrecision:
-	rb_raise(rb_eRuntimeError,
-		 "AXAPI said there was not enough precision ¯\\(°_o)/¯");
+static
+void
+acore_app_mark(void* const ptr)
+{
+  acore_app_t* const app = ptr;
+  rb_gc_mark(app->element);
+  rb_gc_mark(app->bundle_id);
+  rb_gc_mark(app->name);
+  rb_gc_mark(app->timeout);
+}
 
-    default:
-	rb_raise(rb_eRuntimeError,
-		 "accessibility_core majorly goofed [%d]",
-		 (int)code);
-      }
-  }
+static
+void
+acore_app_free(void* const ptr)
+{
+  acore_app_t* const app = ptr;
+  [app->running_app release];
+  xfree(app);
+}
 
-  return Qnil;
+static
+acore_app_t*
+unwrap_app(VALUE obj)
+{
+  acore_app_t* app;
+  Data_Get_Struct(obj, acore_app_t, app);
+  return app;
 }
 
+// Whether the handle still belongs to a running process, and not to
+// some other process that has since been given the same pid
+static
+int
+acore_app_is_current(const acore_app_t* const app)
+{
+  if (!acore_pid_is_alive(app->pid) || [app->running_app isTerminated])
+    return 0;
+  if (!app->started_known) // isTerminated will have to do
+    return 1;
+
+  struct timeval started;
+  return (acore_process_started(app->pid, &started) &&
+	  timercmp(&started, &app->started, ==));
+}
 
 static
-VALUE
-rb_acore_application_for(VALUE self, VALUE pid)
+int
+acore_sweep_application(VALUE pid, VALUE app, VALUE context)
 {
-  NSDate* date = [NSDate date];
-  [[NSRunLoop currentRunLoop] runUntilDate:date];
-  [date release];
+  return (acore_app_is_current(unwrap_app(app)) ? ST_CONTINUE : ST_DELETE);
+}
 
-  pid_t                     the_pid = NUM2PIDT(pid);
-  NSRunningApplication* running_app =
-    [NSRunningApplication runningApplicationWithProcessIdentifier:the_pid];
+// Handles are otherwise only dropped when their own pid is looked up
+// again, so clear out every dead one whenever a new handle is added
+static
+void
+acore_sweep_applications()
+{
+  rb_hash_foreach(applications, acore_sweep_application, Qnil);
+}
+
+static
+VALUE
+acore_application_for(const pid_t pid)
+{
+  VALUE key = PIDT2NUM(pid);
+  VALUE app = rb_hash_lookup(applications, key);
 
-  if (running_app) {
-    VALUE app = wrap_ref(AXUIElementCreateApplication(the_pid));
-    [running_app release];
+  if (app != Qnil) {
+    if (acore_app_is_current(unwrap_app(app)))
       return app;
+    rb_hash_delete(applications, key);
   }
 
-  rb_raise(
-	   rb_eArgError,
-	   "pid `%d' must belong to a running application",
-	   the_pid
-	   );
+  // give NSRunningApplication a chance to notice new apps
+  spin(0);
 
-  return Qnil; // unreachable
+  NSRunningApplication* const running_app =
+    [NSRunningApplication runningApplicationWithProcessIdentifier:pid];
+
+  if (!running_app)
+    rb_raise(
+	     rb_eArgError,
+	     "pid `%d' must belong to a running application",
+	     pid
+	     );
+
+  acore_app_t* data;
+  app = Data_Make_Struct(rb_cApplication, acore_app_t,
+			 acore_app_mark, acore_app_free, data);
+
+  data->pid         = pid;
+  data->running_app = [running_app retain];
+  data->started_known = acore_process_started(pid, &data->started);
+  data->element     = wrap_ref(AXUIElementCreateApplication(pid));
+  data->bundle_id   = Qundef;
+  data->name        = Qundef;
+  data->timeout     = Qnil;
+
+  acore_sweep_applications();
+  rb_hash_aset(applications, key, app);
+  return app;
+}
+
+
+static
+VALUE
+rb_acore_application_for(VALUE self, VALUE pid)
+{
+  return unwrap_app(acore_application_for(NUM2PIDT(pid)))->element;
 }
 
 
@@ -262,6 +531,40 @@ rb_acore_attribute(VALUE self, VALUE name)
 }
 
 
+/*
+ * Like {#attribute}, but never raises
+ *
+ * Returns a pair of the attribute value (or `nil`) and the `AXError`
+ * code that was returned by the accessibility API, which will be `0`
+ * on success. This is meant for code that expects many lookups to fail,
+ * such as scanning a large number of elements for an attribute that
+ * few of them support.
+ *
+ * @param name [String]
+ * @return [Array(Object, Fixnum)]
+ */
+static
+VALUE
+rb_acore_try_attribute(VALUE self, VALUE name)
+{
+  VALUE       obj = Qnil;
+  CFTypeRef  attr = NULL;
+  CFStringRef attr_name = unwrap_string(name);
+  AXError          code = AXUIElementCopyAttributeValue(
+							unwrap_ref(self),
+							attr_name,
+							&attr
+							);
+  CFRelease(attr_name);
+  if (code == kAXErrorSuccess) {
+    obj = to_ruby(attr);
+    if (TYPE(obj) != T_DATA)
+      CFRelease(attr);
+  }
+  return rb_ary_new3(2, obj, INT2FIX(code));
+}
+
+
 static
 VALUE
 rb_acore_size_of(VALUE self, VALUE name)
@@ -559,6 +862,137 @@ rb_acore_parameterized_attribute(VALUE self, VALUE name, VALUE parameter)
 }
 
 
+/*
+ * Yield the text of the receiver in chunks of at most `chunk_size`
+ * characters, using `AXStringForRange`
+ *
+ * This avoids converting very large text views into a single string
+ * when the caller only needs to look at the text piece by piece. Chunks
+ * are never split in the middle of a surrogate pair, so a chunk may be
+ * one character shorter than requested, and `chunk_size` must be at
+ * least 2. Raises `TypeError` if the element answers with something
+ * other than text.
+ *
+ * @example
+ *
+ *   text_area.each_text_chunk(chunk_size: 1024) { |str| io.write str }
+ *
+ * @param opts [Hash] accepts a `:chunk_size` key
+ * @yieldparam chunk [String]
+ * @return [Accessibility::Element]
+ */
+static
+VALUE
+rb_acore_each_text_chunk(int argc, VALUE* argv, VALUE self)
+{
+  RETURN_ENUMERATOR(self, argc, argv);
+
+  if (argc > 1)
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 0..1)", argc);
+
+  long chunk_size = DEFAULT_TEXT_CHUNK_SIZE;
+  if (argc > 0) {
+    Check_Type(argv[0], T_HASH);
+    VALUE size = rb_hash_lookup(argv[0], key_chunk_size);
+    if (size != Qnil)
+      chunk_size = NUM2LONG(size);
+  }
+  // a chunk of one could only hold half of a surrogate pair
+  if (chunk_size < 2)
+    rb_raise(rb_eArgError, "chunk_size must be at least 2, got %ld", chunk_size);
+
+  AXUIElementRef ref = unwrap_ref(self);
+  CFTypeRef    count = NULL;
+  AXError       code = AXUIElementCopyAttributeValue(
+						 ref,
+						 kAXNumberOfCharactersAttribute,
+						 &count
+						 );
+  switch (code)
+    {
+    case kAXErrorSuccess:
+      break;
+    case kAXErrorNoValue:
+    case kAXErrorInvalidUIElement:
+      return self;
+    default:
+      return handle_error(self, code);
+    }
+
+  if (!count)
+    return self;
+  if (CFGetTypeID(count) != CFNumberGetTypeID()) {
+    CFRelease(count);
+    rb_raise(rb_eTypeError, "expected AXNumberOfCharacters to be a number");
+    return self; // unreachable
+  }
+
+  CFIndex length = 0;
+  CFNumberGetValue(count, kCFNumberCFIndexType, &length);
+  CFRelease(count);
+
+  CFIndex location = 0;
+  while (location < length) {
+    const CFIndex wanted = MIN((CFIndex)chunk_size, length - location);
+    VALUE          range = rb_range_new(LONG2NUM(location),
+					LONG2NUM(location + wanted),
+					1);
+    AXValueRef     param = unwrap_value_range(range);
+    CFTypeRef     string = NULL;
+
+    code = AXUIElementCopyParameterizedAttributeValue(
+						      ref,
+						      kAXStringForRangeParameterizedAttribute,
+						      param,
+						      &string
+						      );
+    CFRelease(param);
+    switch (code)
+      {
+      case kAXErrorSuccess:
+	break;
+      case kAXErrorNoValue:
+      case kAXErrorInvalidUIElement:
+	return self;
+      default:
+	return handle_error(self, code);
+      }
+
+    if (!string)
+      break;
+    if (CFGetTypeID(string) != CFStringGetTypeID()) {
+      CFRelease(string);
+      rb_raise(rb_eTypeError, "expected AXStringForRange to return a string");
+      return self; // unreachable
+    }
+
+    CFIndex got = CFStringGetLength(string);
+    if (!got) { // text got shorter while we were reading it
+      CFRelease(string);
+      break;
+    }
+
+    if (got > 1 &&
+	location + got < length &&
+	CFStringIsSurrogateHighCharacter(CFStringGetCharacterAtIndex(string, got - 1))) {
+      CFStringRef const trimmed =
+	CFStringCreateWithSubstring(NULL, string, CFRangeMake(0, got - 1));
+      CFRelease(string);
+      string = trimmed;
+      got--;
+    }
+
+    VALUE chunk = wrap_string(string);
+    CFRelease(string);
+    location += got;
+
+    rb_yield(chunk);
+  }
+
+  return self;
+}
+
+
 static
 VALUE
 rb_acore_actions(VALUE self)
@@ -650,26 +1084,113 @@ rb_acore_post(VALUE self, VALUE events)
 
 
 static
-VALUE
-rb_acore_is_invalid(VALUE self)
+void
+acore_remember_dead(AXUIElementRef const ref)
 {
+  if (CFSetGetCount(dead_elements) >= DEAD_ELEMENTS_MAX)
+    CFSetRemoveAllValues(dead_elements);
+  CFSetAddValue(dead_elements, ref);
+}
+
+
+static
+int
+acore_ref_is_invalid(AXUIElementRef const ref)
+{
+  if (CFSetContainsValue(dead_elements, ref))
+    return 1;
+
   CFTypeRef value = NULL;
   AXError    code = AXUIElementCopyAttributeValue(
-						  unwrap_ref(self),
+						  ref,
 						  kAXRoleAttribute,
 						  &value
 						  );
   if (value)
     CFRelease(value);
-  return (code == kAXErrorInvalidUIElement ? Qtrue : Qfalse);
+
+  if (code == kAXErrorInvalidUIElement) {
+    acore_remember_dead(ref);
+    return 1;
+  }
+  return 0;
 }
 
 
 static
 VALUE
-rb_acore_application(VALUE self)
+rb_acore_is_invalid(VALUE self)
 {
-  return rb_acore_application_for(rb_cElement, rb_acore_pid(self));
+  return (acore_ref_is_invalid(unwrap_ref(self)) ? Qtrue : Qfalse);
+}
+
+
+/*
+ * Split a list of elements into those that are still alive and those
+ * that are dead, in that order
+ *
+ * Elements are grouped by pid as they are checked, so once an application
+ * is known to have terminated every other element belonging to it is
+ * marked dead without asking the accessibility server. Dead elements are
+ * also remembered across calls, so checking them again is free.
+ *
+ * @param elements [Array<Accessibility::Element>]
+ * @return [Array(Array<Accessibility::Element>, Array<Accessibility::Element>)]
+ */
+static
+VALUE
+rb_acore_partition_valid(VALUE self, VALUE elements)
+{
+  elements = rb_ary_to_ary(elements);
+
+  const long length = RARRAY_LEN(elements);
+  VALUE       valid = rb_ary_new();
+  VALUE     invalid = rb_ary_new();
+
+  pid_t pids[PARTITION_PID_TABLE_SIZE];
+  int   pid_alive[PARTITION_PID_TABLE_SIZE];
+  int   pid_count = 0;
+
+  for (long i = 0; i < length; i++) {
+    VALUE      element = rb_ary_entry(elements, i);
+    AXUIElementRef ref = unwrap_ref(element);
+    int           dead = CFSetContainsValue(dead_elements, ref);
+
+    if (!dead) {
+      pid_t pid = 0;
+      int alive = 1;
+
+      if (AXUIElementGetPid(ref, &pid) == kAXErrorSuccess && pid) {
+	int idx = 0;
+	while (idx < pid_count && pids[idx] != pid)
+	  idx++;
+
+	if (idx < pid_count) {
+	  alive = pid_alive[idx];
+	}
+	else {
+	  alive = acore_pid_is_alive(pid);
+	  if (pid_count < PARTITION_PID_TABLE_SIZE) {
+	    pids[pid_count]      = pid;
+	    pid_alive[pid_count] = alive;
+	    pid_count++;
+	  }
+	}
+      }
+
+      if (alive) {
+	dead = acore_ref_is_invalid(ref);
+      }
+      else {
+	acore_remember_dead(ref);
+	dead = 1;
+      }
+    }
+
+    rb_ary_push(dead ? invalid : valid, element);
+  }
+
+  return rb_ary_new3(2, valid, invalid);
 }
 
 
@@ -690,6 +1211,118 @@ rb_acore_set_timeout_to(VALUE self, VALUE seconds)
 }
 
 
+/*
+ * The handle is remembered on the element, since an element can only
+ * ever belong to the one process; repeated calls only check that the
+ * process is still running, and raise once it has quit.
+ */
+static
+VALUE
+rb_acore_application(VALUE self)
+{
+  VALUE app = rb_ivar_get(self, ivar_application);
+  if (app == Qnil || !acore_app_is_current(unwrap_app(app))) {
+    app = acore_application_for(NUM2PIDT(rb_acore_pid(self)));
+    rb_ivar_set(self, ivar_application, app);
+  }
+  return unwrap_app(app)->element;
+}
+
+
+/*
+ * Returns the shared handle for the application with the given pid
+ *
+ * Handles are cached per pid for as long as the application is running,
+ * so this only does real work the first time an application is looked up.
+ *
+ * @param pid [Number]
+ * @return [Accessibility::Application]
+ */
+static
+VALUE
+rb_app_for(VALUE self, VALUE pid)
+{
+  return acore_application_for(NUM2PIDT(pid));
+}
+
+static
+VALUE
+rb_app_pid(VALUE self)
+{
+  return PIDT2NUM(unwrap_app(self)->pid);
+}
+
+/*
+ * The application level element
+ *
+ * @return [Accessibility::Element]
+ */
+static
+VALUE
+rb_app_element(VALUE self)
+{
+  return unwrap_app(self)->element;
+}
+
+static
+VALUE
+rb_app_bundle_id(VALUE self)
+{
+  acore_app_t* const app = unwrap_app(self);
+  if (app->bundle_id == Qundef) {
+    NSString* const bundle_id = [app->running_app bundleIdentifier];
+    app->bundle_id = bundle_id ? rb_obj_freeze(wrap_nsstring(bundle_id)) : Qnil;
+  }
+  return app->bundle_id;
+}
+
+static
+VALUE
+rb_app_localized_name(VALUE self)
+{
+  acore_app_t* const app = unwrap_app(self);
+  if (app->name == Qundef) {
+    NSString* const name = [app->running_app localizedName];
+    app->name = name ? rb_obj_freeze(wrap_nsstring(name)) : Qnil;
+  }
+  return app->name;
+}
+
+static
+VALUE
+rb_app_is_terminated(VALUE self)
+{
+  return (acore_app_is_current(unwrap_app(self)) ? Qfalse : Qtrue);
+}
+
+/*
+ * The messaging timeout last set through {#timeout=}, or `nil` if the
+ * system default is being used
+ *
+ * The accessibility API keeps timeouts per element, so this only covers
+ * the application element itself; elements fetched from it still use
+ * the global timeout, which is set on {Element.system_wide}.
+ *
+ * @return [Number,nil]
+ */
+static
+VALUE
+rb_app_timeout(VALUE self)
+{
+  return unwrap_app(self)->timeout;
+}
+
+static
+VALUE
+rb_app_set_timeout(VALUE self, VALUE seconds)
+{
+  acore_app_t* const app = unwrap_app(self);
+  rb_acore_set_timeout_to(app->element, seconds);
+  app->timeout = seconds;
+  return seconds;
+}
+
+
 static
 VALUE
 rb_acore_element_at(VALUE self, VALUE point)
@@ -733,6 +1366,409 @@ rb_acore_equality(VALUE self, VALUE other)
 }
 
 
+// A snapshot is a flat table of nodes keyed by AXUIElementRef (so lookups
+// use CFHash/CFEqual of the ref), with the role and identifier of each
+// node kept alongside so that a ref that gets recycled for a different
+// kind of element is treated as a new node instead of a changed one
+typedef struct {
+  AXUIElementRef ref;
+  CFArrayRef     values; // one per snapshot attribute, errors included
+} snapshot_node_t;
+
+typedef struct {
+  AXUIElementRef         root;
+  CFMutableArrayRef      attributes; // role, identifier, ..., children
+  CFMutableArrayRef      order;      // refs in the order they were visited
+  CFMutableDictionaryRef nodes;      // ref => snapshot_node_t*
+  CFMutableArrayRef      pending;    // refs left to visit while building
+} snapshot_t;
+
+#define SNAPSHOT_ROLE_INDEX       0
+#define SNAPSHOT_IDENTIFIER_INDEX 1
+#define SNAPSHOT_FIRST_USER_INDEX 2
+
+static
+void
+snapshot_free_node(const void* key, const void* value, void* context)
+{
+  snapshot_node_t* const node = (snapshot_node_t*)value;
+  CFRelease(node->ref);
+  CFRelease(node->values);
+  xfree(node);
+}
+
+static
+void
+snapshot_free(void* const ptr)
+{
+  snapshot_t* const snap = ptr;
+  if (snap->nodes) {
+    CFDictionaryApplyFunction(snap->nodes, snapshot_free_node, NULL);
+    CFRelease(snap->nodes);
+  }
+  if (snap->order)
+    CFRelease(snap->order);
+  if (snap->pending)
+    CFRelease(snap->pending);
+  if (snap->attributes)
+    CFRelease(snap->attributes);
+  if (snap->root)
+    CFRelease(snap->root);
+  xfree(snap);
+}
+
+static
+snapshot_t*
+unwrap_snapshot(VALUE obj)
+{
+  if (CLASS_OF(obj) != rb_cSnapshot)
+    rb_raise(rb_eTypeError, "expected an Accessibility::Snapshot, got %s",
+	     rb_obj_classname(obj));
+
+  snapshot_t* snap;
+  Data_Get_Struct(obj, snapshot_t, snap);
+  return snap;
+}
+
+static
+VALUE
+snapshot_alloc(snapshot_t** const snap)
+{
+  const VALUE obj = Data_Make_Struct(rb_cSnapshot, snapshot_t,
+				     NULL, snapshot_free, *snap);
+  (*snap)->order = CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+  (*snap)->nodes = CFDictionaryCreateMutable(NULL, 0,
+					     &kCFTypeDictionaryKeyCallBacks,
+					     NULL);
+  return obj;
+}
+
+static
+CFArrayRef
+snapshot_node_children(const snapshot_node_t* const node)
+{
+  const CFTypeRef children =
+    CFArrayGetValueAtIndex(node->values, CFArrayGetCount(node->values) - 1);
+  return (CFGetTypeID(children) == CFArrayGetTypeID() ? children : NULL);
+}
+
+static
+snapshot_node_t*
+snapshot_fetch_node(const snapshot_t* const snap, AXUIElementRef const ref)
+{
+  snapshot_node_t* const node = ALLOC(snapshot_node_t);
+
+  // one round trip for every attribute, errors come back as AXValues
+  CFArrayRef values = NULL;
+  AXError      code = AXUIElementCopyMultipleAttributeValues(
+							   ref,
+							   snap->attributes,
+							   0,
+							   &values
+							   );
+  if (code != kAXErrorSuccess) {
+    xfree(node);
+    return NULL;
+  }
+
+  node->ref    = CFRetain(ref);
+  node->values = values;
+  return node;
+}
+
+static
+snapshot_node_t*
+snapshot_reuse_node(const snapshot_node_t* const old)
+{
+  snapshot_node_t* const node = ALLOC(snapshot_node_t);
+  *node = *old;
+  CFRetain(node->ref);
+  CFRetain(node->values);
+  return node;
+}
+
+// Whether the children of a node are the same elements, in the same
+// order, as when the old snapshot was taken; returns -1 if the node has
+// gone away
+static
+int
+snapshot_same_children(AXUIElementRef const ref, const snapshot_node_t* const old)
+{
+  CFTypeRef children = NULL;
+  AXError       code = AXUIElementCopyAttributeValue(
+						 ref,
+						 kAXChildrenAttribute,
+						 &children
+						 );
+  if (code == kAXErrorInvalidUIElement)
+    return -1;
+
+  CFArrayRef const old_children = snapshot_node_children(old);
+  int same;
+  if (code != kAXErrorSuccess || !children)
+    same = !old_children || !CFArrayGetCount(old_children);
+  else
+    same = old_children && CFEqual(children, old_children);
+
+  if (children)
+    CFRelease(children);
+  return same;
+}
+
+/*
+ * Walk the tree from the root and fill in the snapshot
+ *
+ * When a previous snapshot is given, nodes whose children are the same
+ * elements as before are copied from it instead of being fetched again,
+ * so only the subtrees that changed shape cost a full fetch.
+ */
+static
+void
+snapshot_build(snapshot_t* const snap, const snapshot_t* const previous)
+{
+  // kept on the snapshot so that it is released even if we get interrupted
+  CFMutableArrayRef stack = snap->pending =
+    CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+  CFArrayAppendValue(stack, snap->root);
+
+  CFIndex depth;
+  while ((depth = CFArrayGetCount(stack))) {
+    rb_thread_check_ints();
+
+    AXUIElementRef ref = CFRetain(CFArrayGetValueAtIndex(stack, depth - 1));
+    CFArrayRemoveValueAtIndex(stack, depth - 1);
+
+    if (CFDictionaryContainsKey(snap->nodes, ref)) {
+      CFRelease(ref);
+      continue;
+    }
+
+    snapshot_node_t*     node = NULL;
+    int                  dead = 0;
+    const snapshot_node_t* old =
+      previous ? CFDictionaryGetValue(previous->nodes, ref) : NULL;
+
+    if (old) {
+      const int same = snapshot_same_children(ref, old);
+      if (same < 0)
+	dead = 1;
+      else if (same)
+	node = snapshot_reuse_node(old);
+    }
+
+    if (!node && !dead)
+      node = snapshot_fetch_node(snap, ref);
+
+    if (node) {
+      CFDictionarySetValue(snap->nodes, ref, node);
+      CFArrayAppendValue(snap->order, ref);
+
+      // push in reverse so that children are visited in order
+      CFArrayRef children = snapshot_node_children(node);
+      if (children)
+	for (CFIndex i = CFArrayGetCount(children) - 1; i >= 0; i--)
+	  CFArrayAppendValue(stack, CFArrayGetValueAtIndex(children, i));
+    }
+
+    CFRelease(ref);
+  }
+
+  snap->pending = NULL;
+  CFRelease(stack);
+}
+
+static
+int
+snapshot_same_identity(const snapshot_node_t* const a, const snapshot_node_t* const b)
+{
+  return CFEqual(CFArrayGetValueAtIndex(a->values, SNAPSHOT_ROLE_INDEX),
+		 CFArrayGetValueAtIndex(b->values, SNAPSHOT_ROLE_INDEX)) &&
+         CFEqual(CFArrayGetValueAtIndex(a->values, SNAPSHOT_IDENTIFIER_INDEX),
+		 CFArrayGetValueAtIndex(b->values, SNAPSHOT_IDENTIFIER_INDEX));
+}
+
+static
+VALUE
+snapshot_wrap_element(AXUIElementRef const ref)
+{
+  CFRetain(ref); // wrap_ref takes ownership
+  return wrap_ref(ref);
+}
+
+static
+VALUE
+snapshot_wrap_value(CFTypeRef const value)
+{
+  if (CFGetTypeID(value) == AXValueGetTypeID() &&
+      AXValueGetType(value) == kAXValueTypeAXError)
+    return Qnil;
+
+  CFRetain(value);
+  VALUE obj = to_ruby(value);
+  if (TYPE(obj) != T_DATA)
+    CFRelease(value);
+  return obj;
+}
+
+/*
+ * Take a snapshot of the tree rooted at the given element
+ *
+ * The role and identifier of every node are always recorded, and any
+ * extra attributes that should be compared by {#diff} can be given.
+ *
+ * @param root [Accessibility::Element]
+ * @param attributes [Array<String>]
+ * @return [Accessibility::Snapshot]
+ */
+static
+VALUE
+rb_snapshot_new(int argc, VALUE* argv, VALUE self)
+{
+  if (!argc)
+    rb_raise(rb_eArgError, "wrong number of arguments (0 for 1+)");
+
+  AXUIElementRef root = unwrap_ref(argv[0]);
+  VALUE     rb_attrs  = (argc > 1 ? rb_ary_to_ary(argv[1]) : rb_ary_new());
+
+  snapshot_t* snap;
+  VALUE        obj = snapshot_alloc(&snap);
+
+  snap->root       = CFRetain(root);
+  snap->attributes = CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+  CFArrayAppendValue(snap->attributes, kAXRoleAttribute);
+  CFArrayAppendValue(snap->attributes, CFSTR("AXIdentifier"));
+
+  for (long i = 0; i < RARRAY_LEN(rb_attrs); i++) {
+    CFStringRef name = unwrap_string(rb_ary_entry(rb_attrs, i));
+    CFRange    range = CFRangeMake(0, CFArrayGetCount(snap->attributes));
+    if (!CFArrayContainsValue(snap->attributes, range, name) &&
+	!CFEqual(name, kAXChildrenAttribute))
+      CFArrayAppendValue(snap->attributes, name);
+    CFRelease(name);
+  }
+  CFArrayAppendValue(snap->attributes, kAXChildrenAttribute);
+
+  snapshot_build(snap, NULL);
+  return obj;
+}
+
+/*
+ * Take a new snapshot of the same tree, reusing nodes from the receiver
+ * whose children are still the same elements
+ *
+ * This is much cheaper than a full snapshot for large trees, but changes
+ * to the attributes of reused nodes will not be noticed.
+ *
+ * @return [Accessibility::Snapshot]
+ */
+static
+VALUE
+rb_snapshot_refresh(VALUE self)
+{
+  const snapshot_t* const previous = unwrap_snapshot(self);
+
+  snapshot_t* snap;
+  VALUE        obj = snapshot_alloc(&snap);
+  snap->root       = CFRetain(previous->root);
+  snap->attributes = (CFMutableArrayRef)CFRetain(previous->attributes);
+
+  snapshot_build(snap, previous);
+  return obj;
+}
+
+/*
+ * Compare the receiver with a newer snapshot of the same tree
+ *
+ * Returns a list of records, each of which is one of:
+ *
+ *  - `[:added, element]`
+ *  - `[:removed, element]`
+ *  - `[:changed, element, attribute, old_value, new_value]`
+ *
+ * @param newer [Accessibility::Snapshot]
+ * @return [Array<Array>]
+ */
+static
+VALUE
+rb_snapshot_diff(VALUE self, VALUE newer)
+{
+  const snapshot_t* const old_snap = unwrap_snapshot(self);
+  const snapshot_t* const new_snap = unwrap_snapshot(newer);
+
+  if (!CFEqual(old_snap->attributes, new_snap->attributes))
+    rb_raise(rb_eArgError, "cannot diff snapshots that have different attributes");
+
+  VALUE records = rb_ary_new();
+  const CFIndex last_attr = CFArrayGetCount(new_snap->attributes) - 1;
+
+  const CFIndex new_count = CFArrayGetCount(new_snap->order);
+  for (CFIndex i = 0; i < new_count; i++) {
+    AXUIElementRef const          ref = CFArrayGetValueAtIndex(new_snap->order, i);
+    const snapshot_node_t* const node = CFDictionaryGetValue(new_snap->nodes, ref);
+    const snapshot_node_t* const  old = CFDictionaryGetValue(old_snap->nodes, ref);
+
+    if (!old || !snapshot_same_identity(old, node)) {
+      rb_ary_push(records, rb_ary_new3(2, sym_added, snapshot_wrap_element(ref)));
+      continue;
+    }
+
+    if (old->values == node->values) // reused by an incremental snapshot
+      continue;
+
+    for (CFIndex j = SNAPSHOT_FIRST_USER_INDEX; j < last_attr; j++) {
+      CFTypeRef const old_value = CFArrayGetValueAtIndex(old->values,  j);
+      CFTypeRef const new_value = CFArrayGetValueAtIndex(node->values, j);
+      if (CFEqual(old_value, new_value))
+	continue;
+
+      rb_ary_push(records,
+		  rb_ary_new3(5,
+			      sym_changed,
+			      snapshot_wrap_element(ref),
+			      wrap_string(CFArrayGetValueAtIndex(new_snap->attributes, j)),
+			      snapshot_wrap_value(old_value),
+			      snapshot_wrap_value(new_value)));
+    }
+  }
+
+  const CFIndex old_count = CFArrayGetCount(old_snap->order);
+  for (CFIndex i = 0; i < old_count; i++) {
+    AXUIElementRef const          ref = CFArrayGetValueAtIndex(old_snap->order, i);
+    const snapshot_node_t* const  old = CFDictionaryGetValue(old_snap->nodes, ref);
+    const snapshot_node_t* const node = CFDictionaryGetValue(new_snap->nodes, ref);
+
+    if (!node || !snapshot_same_identity(old, node))
+      rb_ary_push(records, rb_ary_new3(2, sym_removed, snapshot_wrap_element(ref)));
+  }
+
+  return records;
+}
+
+static
+VALUE
+rb_snapshot_size(VALUE self)
+{
+  return LONG2NUM(CFDictionaryGetCount(unwrap_snapshot(self)->nodes));
+}
+
+static
+VALUE
+rb_snapshot_root(VALUE self)
+{
+  return snapshot_wrap_element(unwrap_snapshot(self)->root);
+}
+
+static
+VALUE
+rb_snapshot_includes(VALUE self, VALUE element)
+{
+  if (CLASS_OF(element) != rb_cElement)
+    return Qfalse;
+  return (CFDictionaryContainsKey(unwrap_snapshot(self)->nodes, unwrap_ref(element)) ?
+	  Qtrue : Qfalse);
+}
+
+
 void
 Init_core()
 {
@@ -793,13 +1829,21 @@ Init_core()
   ivar_param_attrs = rb_intern("@param_attrs");
   ivar_actions     = rb_intern("@actions");
   ivar_pid         = rb_intern("@pid");
+  ivar_application = rb_intern("@application");
   ivar_key_rate    = rb_intern("@key_rate");
 
+  key_chunk_size   = ID2SYM(rb_intern("chunk_size"));
+
+  dead_elements    = CFSetCreateMutable(NULL, 0, &kCFTypeSetCallBacks);
+  applications     = rb_hash_new();
+  rb_gc_register_address(&applications);
+
   rb_define_singleton_method(rb_cElement, "application_for", rb_acore_application_for,          1);
   rb_define_singleton_method(rb_cElement, "system_wide",     rb_acore_system_wide,              0);
   rb_define_singleton_method(rb_cElement, "element_at",      rb_acore_element_at,               1);
   rb_define_singleton_method(rb_cElement, "key_rate",        rb_acore_key_rate,                 0);
   rb_define_singleton_method(rb_cElement, "key_rate=",       rb_acore_set_key_rate,             1);
+  rb_define_singleton_method(rb_cElement, "partition_valid", rb_acore_partition_valid,          1);
 
   sel_to_f       = rb_intern("to_f");
   rate_very_slow = rb_intern("very_slow");
@@ -812,6 +1856,7 @@ Init_core()
 
   rb_define_method(rb_cElement, "attributes",                rb_acore_attributes,               0);
   rb_define_method(rb_cElement, "attribute",                 rb_acore_attribute,                1);
+  rb_define_method(rb_cElement, "try_attribute",             rb_acore_try_attribute,            1);
   rb_define_method(rb_cElement, "size_of",                   rb_acore_size_of,                  1);
   rb_define_method(rb_cElement, "writable?",                 rb_acore_is_writable,              1);
   rb_define_method(rb_cElement, "set",                       rb_acore_set,                      2);
@@ -825,6 +1870,7 @@ Init_core()
 
   rb_define_method(rb_cElement, "parameterized_attributes",  rb_acore_parameterized_attributes, 0);
   rb_define_method(rb_cElement, "parameterized_attribute",   rb_acore_parameterized_attribute,  2);
+  rb_define_method(rb_cElement, "each_text_chunk",           rb_acore_each_text_chunk,         -1);
 
   rb_define_method(rb_cElement, "actions",                   rb_acore_actions,                  0);
   rb_define_method(rb_cElement, "perform",                   rb_acore_perform,                  1);
@@ -839,4 +1885,80 @@ Init_core()
   rb_define_method(rb_cElement, "element_at",                rb_acore_element_at,               1);
   rb_define_method(rb_cElement, "==",                        rb_acore_equality,                 1);
 
+
+  /*
+   * Document-module: Accessibility::Error
+   *
+   * Mixed into every exception raised because of an `AXError`, so all
+   * accessibility errors can be rescued together. Each error code has its
+   * own exception class, which keeps the superclass (`ArgumentError` or
+   * `RuntimeError`) that used to be raised for that code.
+   */
+  rb_mError = rb_define_module_under(rb_mAccessibility, "Error");
+  rb_define_method(rb_mError, "code",    rb_error_code,    0);
+  rb_define_method(rb_mError, "element", rb_error_element, 0);
+  rb_define_method(rb_mError, "to_s",    rb_error_message, 0);
+
+  ivar_error_code    = rb_intern("@code");
+  ivar_error_element = rb_intern("@element");
+  ivar_error_message = rb_intern("@message");
+
+  for (size_t i = 0; i < ERROR_CLASSES_COUNT; i++) {
+    VALUE super = rb_eRuntimeError;
+    if (error_classes[i].base == ARG_ERROR)
+      super = rb_eArgError;
+    else if (error_classes[i].base == NOT_IMP_ERROR)
+      super = rb_eNotImpError;
+
+    VALUE klass = rb_define_class_under(rb_mAccessibility, error_classes[i].name, super);
+    rb_include_module(klass, rb_mError);
+    rb_define_const(klass, "CODE", INT2FIX(error_classes[i].code));
+    error_classes[i].klass = klass;
+  }
+  rb_eUnknownError = rb_define_class_under(rb_mAccessibility, "UnknownError", rb_eRuntimeError);
+  rb_include_module(rb_eUnknownError, rb_mError);
+
+  /*
+   * Document-class: Accessibility::Application
+   *
+   * A handle for a running application that is shared by all elements
+   * that belong to the application. It owns the application level
+   * element and caches information that does not change while the
+   * application is running.
+   */
+  rb_cApplication = rb_define_class_under(rb_mAccessibility, "Application", rb_cObject);
+  rb_undef_alloc_func(rb_cApplication);
+
+  rb_define_singleton_method(rb_cApplication, "for", rb_app_for, 1);
+
+  rb_define_method(rb_cApplication, "pid",               rb_app_pid,            0);
+  rb_define_method(rb_cApplication, "element",           rb_app_element,        0);
+  rb_define_method(rb_cApplication, "bundle_identifier", rb_app_bundle_id,      0);
+  rb_define_method(rb_cApplication, "localized_name",    rb_app_localized_name, 0);
+  rb_define_method(rb_cApplication, "terminated?",       rb_app_is_terminated,  0);
+  rb_define_method(rb_cApplication, "timeout",           rb_app_timeout,        0);
+  rb_define_method(rb_cApplication, "timeout=",          rb_app_set_timeout,    1);
+
+
+  /*
+   * Document-class: Accessibility::Snapshot
+   *
+   * A copy of the state of an element tree at one point in time, which
+   * can be compared with a later snapshot to find out what changed.
+   */
+  rb_cSnapshot = rb_define_class_under(rb_mAccessibility, "Snapshot", rb_cObject);
+  rb_undef_alloc_func(rb_cSnapshot);
+
+  rb_define_singleton_method(rb_cSnapshot, "new", rb_snapshot_new, -1);
+
+  rb_define_method(rb_cSnapshot, "refresh",  rb_snapshot_refresh,  0);
+  rb_define_method(rb_cSnapshot, "diff",     rb_snapshot_diff,     1);
+  rb_define_method(rb_cSnapshot, "size",     rb_snapshot_size,     0);
+  rb_define_method(rb_cSnapshot, "root",     rb_snapshot_root,     0);
+  rb_define_method(rb_cSnapshot, "include?", rb_snapshot_includes, 1);
+
+  sym_added   = ID2SYM(rb_intern("added"));
+  sym_removed = ID2SYM(rb_intern("removed"));
+  sym_changed = ID2SYM(rb_intern("changed"));
+
 }
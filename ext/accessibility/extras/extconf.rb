@@ -1,7 +1,7 @@
 require 'mkmf'
 
 $CFLAGS << ' -std=c99 -Wall -Werror -pedantic -ObjC'
-$LIBS   << ' -framework CoreFoundation -framework Cocoa -framework IOKit'
+$LIBS   << ' -framework CoreFoundation -framework ApplicationServices -framework Cocoa -framework IOKit'
 
 unless RbConfig::CONFIG["CC"].match(/clang/)
   clang = `which clang`.chomp
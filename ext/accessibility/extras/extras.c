@@ -1,6 +1,7 @@
 #include "ruby.h"
 
 #include "../bridge/bridge.h"
+#include "ruby/thread.h"
 
 #import <IOKit/IOKitLib.h>
 #import <IOKit/ps/IOPowerSources.h>
@@ -8,6 +9,10 @@
 #import <IOKit/pwr_mgt/IOPMLib.h>
 #import <IOKit/hidsystem/IOHIDShared.h>
 #import <Cocoa/Cocoa.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <mach/mach.h>
+#include <pthread.h>
 
 static VALUE rb_mBattery;
 
@@ -16,6 +21,11 @@ static VALUE battery_charged;
 static VALUE battery_charging;
 static VALUE battery_discharging;
 
+static VALUE battery_key_state;
+static VALUE battery_key_level;
+static VALUE battery_key_to_empty;
+static VALUE battery_key_to_full;
+
 static io_connect_t screen_connection = MACH_PORT_NULL;
 
 static VALUE rb_cRunningApp;
@@ -24,25 +34,104 @@ static VALUE rb_cProcInfo;
 static VALUE rb_cHost;
 static VALUE rb_cBundle;
 
+static VALUE rb_cAppRegistry;
+
+// Backs NSRunningApplication.runningApplicationsWithBundleIdentifier; it
+// is marked stale by NSWorkspace launch and terminate notifications and
+// polled again on the next lookup after that
+static VALUE        shared_registry;
+static volatile int shared_registry_stale = 1;
+
+static ID ivar_source;
+static ID ivar_apps;
+static ID ivar_by_bundle_id;
+static ID ivar_by_name;
+static ID sel_bundle_identifier;
+static ID sel_localized_name;
+static ID sel_call;
+static ID sel_process_identifier;
+static ID sel_launch_date;
+
 static VALUE key_opts;
+static VALUE key_until;
+static VALUE key_timeout;
+static VALUE key_launcher;
+static VALUE key_pid;
+static VALUE key_phases;
+static VALUE key_concurrency;
+static VALUE key_bundle_id;
+static VALUE key_error;
+static VALUE key_parallel;
+
+static ID sel_launch;
+static ID sel_pid_for;
+static ID sel_reached;
 //static VALUE key_event_params;
 //static VALUE key_launch_id;
 
 
+// Properties that never change for the life of the app are converted
+// the first time they are read and kept here; Qundef means not read yet
+typedef struct {
+  NSRunningApplication* app;
+  VALUE                 localized_name;
+  VALUE                 bundle_id;
+  VALUE                 bundle_url;
+  VALUE                 executable_url;
+  VALUE                 launch_date;
+} running_app_t;
+
+static
+void
+running_app_mark(void* const data)
+{
+  running_app_t* const app = data;
+  rb_gc_mark(app->localized_name);
+  rb_gc_mark(app->bundle_id);
+  rb_gc_mark(app->bundle_url);
+  rb_gc_mark(app->executable_url);
+  rb_gc_mark(app->launch_date);
+}
+
+static
+void
+running_app_free(void* const data)
+{
+  running_app_t* const app = data;
+  [app->app release];
+  xfree(app);
+}
+
 static
 VALUE
 wrap_app(NSRunningApplication* const app)
 {
-    return Data_Wrap_Struct(rb_cRunningApp, NULL, objc_finalizer, (void*)app);
+  running_app_t* data;
+  VALUE obj = Data_Make_Struct(rb_cRunningApp, running_app_t,
+			       running_app_mark, running_app_free, data);
+  data->app            = app;
+  data->localized_name = Qundef;
+  data->bundle_id      = Qundef;
+  data->bundle_url     = Qundef;
+  data->executable_url = Qundef;
+  data->launch_date    = Qundef;
+  return obj;
+}
+
+static
+running_app_t*
+running_app_data(VALUE app)
+{
+  running_app_t* data;
+  Data_Get_Struct(app, running_app_t, data);
+  return data;
 }
 
 static
 NSRunningApplication*
 unwrap_app(VALUE app)
 {
-  NSRunningApplication* running_app;
-  Data_Get_Struct(app, NSRunningApplication, running_app);
-  return running_app;
+  return running_app_data(app)->app;
 }
 
 static VALUE wrap_array_apps(NSArray* const ary)
@@ -64,14 +153,6 @@ rb_running_app_with_pid(VALUE self, VALUE num_pid)
     return Qnil; // ruby behaviour would be to raise, but we want "drop-in" compat
 }
 
-static
-VALUE
-rb_running_app_with_bundle_id(VALUE self, VALUE bundle_id)
-{
-  return wrap_array_apps([NSRunningApplication
-			  runningApplicationsWithBundleIdentifier:unwrap_nsstring(bundle_id)]);
-}
-
 static
 VALUE
 rb_running_app_current_app(VALUE self)
@@ -136,34 +217,36 @@ static
 VALUE
 rb_running_app_localized_name(VALUE self)
 {
-  NSString* string = [unwrap_app(self) localizedName];
-  VALUE        str = Qnil;
-  if (string)
-    str = wrap_nsstring(string);
-  [string release];
-  return str;
+  running_app_t* const data = running_app_data(self);
+  if (data->localized_name == Qundef) {
+    NSString* const string = data->app.localizedName;
+    data->localized_name = (string ? rb_obj_freeze(wrap_nsstring(string)) : Qnil);
+  }
+  return data->localized_name;
 }
 
 static
 VALUE
 rb_running_app_bundle_id(VALUE self)
 {
-  NSString* name = [unwrap_app(self) bundleIdentifier];
-  if (name)
-    return wrap_nsstring(name);
-  return Qnil;
+  running_app_t* const data = running_app_data(self);
+  if (data->bundle_id == Qundef) {
+    NSString* const name = data->app.bundleIdentifier;
+    data->bundle_id = (name ? rb_obj_freeze(wrap_nsstring(name)) : Qnil);
+  }
+  return data->bundle_id;
 }
 
 static
 VALUE
 rb_running_app_bundle_url(VALUE self)
 {
-  NSURL* url  = [unwrap_app(self) bundleURL];
-  VALUE rburl = Qnil;
-  if (url)
-    rburl = wrap_nsurl(url);
-  [url release];
-  return rburl;
+  running_app_t* const data = running_app_data(self);
+  if (data->bundle_url == Qundef) {
+    NSURL* const url = data->app.bundleURL;
+    data->bundle_url = (url ? rb_obj_freeze(wrap_nsurl([url retain])) : Qnil);
+  }
+  return data->bundle_url;
 }
 
 static
@@ -177,14 +260,24 @@ static
 VALUE
 rb_running_app_executable_url(VALUE self)
 {
-  return wrap_nsurl(unwrap_app(self).executableURL);
+  running_app_t* const data = running_app_data(self);
+  if (data->executable_url == Qundef) {
+    NSURL* const url = data->app.executableURL;
+    data->executable_url = (url ? rb_obj_freeze(wrap_nsurl([url retain])) : Qnil);
+  }
+  return data->executable_url;
 }
 
 static
 VALUE
 rb_running_app_launch_date(VALUE self)
 {
-  return wrap_nsdate(unwrap_app(self).launchDate);
+  running_app_t* const data = running_app_data(self);
+  if (data->launch_date == Qundef) {
+    NSDate* const date = data->app.launchDate;
+    data->launch_date = (date ? rb_obj_freeze(wrap_nsdate(date)) : Qnil);
+  }
+  return data->launch_date;
 }
 
 static
@@ -312,93 +405,1744 @@ rb_workspace_launch(VALUE self, VALUE bundle_id, VALUE opts)
   return result ? Qtrue : Qfalse;
 }
 
-
+
+typedef enum {
+  LAUNCH_PHASE_REQUESTED = 0, // launch request was accepted
+  LAUNCH_PHASE_PID,           // the app has a pid
+  LAUNCH_PHASE_LAUNCHED,      // NSRunningApplication says finishedLaunching
+  LAUNCH_PHASE_RESPONSIVE,    // the app answers accessibility queries
+  LAUNCH_PHASE_WINDOW,        // the app has at least one AXWindow
+  LAUNCH_PHASE_COUNT
+} launch_phase_t;
+
+static VALUE launch_phases[LAUNCH_PHASE_COUNT];
+
+#define LAUNCH_POLL_INTERVAL       0.01
+#define LAUNCH_DEFAULT_TIMEOUT     30.0
+#define LAUNCH_DEFAULT_CONCURRENCY 4
+
+typedef struct {
+  NSString*                bundle_id;
+  NSRunningApplication*    app;     // only set by the native launcher
+  NSWorkspaceLaunchOptions options;
+  launch_phase_t           target;
+  int                      reached; // -1 until the request is accepted
+  int                      failed;
+  int                      finished;
+  pid_t                    pid;
+  double                   started;
+  double                   timings[LAUNCH_PHASE_COUNT];
+} launch_t;
+
+typedef struct launcher_s launcher_t;
+
+typedef struct {
+  launch_t* const         launches;
+  const size_t            count;
+  const size_t            concurrency;
+  const launcher_t* const launcher;
+  const VALUE             ctx;
+  const double            timeout;
+  int                     state; // set if a stand-in launcher raised
+  volatile int            interrupted;
+} launch_wait_t;
+
+// How launch progress is observed; the whole wait runs without the GVL,
+// the native launcher talks to NSWorkspace and the accessibility APIs
+// and never touches Ruby, the other one forwards to a stand-in object
+// and takes the GVL back for each call
+struct launcher_s {
+  int   (*launch)(launch_t* const launch, launch_wait_t* const wait);
+  pid_t (*pid_for)(launch_t* const launch, launch_wait_t* const wait);
+  int   (*reached)(launch_t* const launch, launch_phase_t phase, launch_wait_t* const wait);
+};
+
+// Launching by URL hands back the NSRunningApplication for the process
+// that was started (or activated, if the app was already running), so
+// another instance with the same bundle identifier cannot be mistaken
+// for the one we launched
+static
+int
+native_launch(launch_t* const launch, launch_wait_t* const wait)
+{
+  @autoreleasepool {
+    NSWorkspace* const workspace = [NSWorkspace sharedWorkspace];
+    NSURL* const             url =
+      [workspace URLForApplicationWithBundleIdentifier:launch->bundle_id];
+    if (!url)
+      return 0;
+
+    launch->app = [[workspace launchApplicationAtURL:url
+					     options:launch->options
+				       configuration:[NSDictionary dictionary]
+					       error:NULL] retain];
+    return (launch->app != nil);
+  }
+}
+
+static
+pid_t
+native_pid_for(launch_t* const launch, launch_wait_t* const wait)
+{
+  return launch->app.processIdentifier;
+}
+
+static
+int
+native_reached(launch_t* const launch, launch_phase_t phase, launch_wait_t* const wait)
+{
+  @autoreleasepool {
+    if (phase == LAUNCH_PHASE_LAUNCHED)
+      return launch->app.isFinishedLaunching;
+
+    AXUIElementRef const app = AXUIElementCreateApplication(launch->pid);
+    int               result = 0;
+
+    if (phase == LAUNCH_PHASE_RESPONSIVE) {
+      CFTypeRef role = NULL;
+      result = (AXUIElementCopyAttributeValue(app, kAXRoleAttribute, &role)
+		== kAXErrorSuccess);
+      if (role)
+	CFRelease(role);
+    }
+    else {
+      CFIndex count = 0;
+      result = (AXUIElementGetAttributeValueCount(app, kAXWindowsAttribute, &count)
+		== kAXErrorSuccess && count > 0);
+    }
+
+    CFRelease(app);
+    return result;
+  }
+}
+
+static const launcher_t native_launcher = {
+  native_launch, native_pid_for, native_reached
+};
+
+typedef struct {
+  launch_t*      launch;
+  launch_phase_t phase;
+  VALUE          launcher;
+  VALUE        (*call)(VALUE);
+  long           result;
+  int            state;
+} launch_callback_t;
+
+static
+void*
+launch_callback_with_gvl(void* const data)
+{
+  launch_callback_t* const callback = data;
+  rb_protect(callback->call, (VALUE)callback, &callback->state);
+  return NULL;
+}
+
+/*
+ * Call into a stand-in launcher with the GVL held
+ *
+ * The result is converted while the GVL is still held. If the stand-in
+ * raises, the wait is stopped and the error is raised again once the
+ * wait has given the GVL back; until then every callback answers 0.
+ */
+static
+long
+launch_callback(launch_t* const launch, launch_phase_t phase,
+		launch_wait_t* const wait, VALUE (*call)(VALUE))
+{
+  if (wait->state)
+    return 0;
+
+  launch_callback_t callback = { launch, phase, wait->ctx, call, 0, 0 };
+  rb_thread_call_with_gvl(launch_callback_with_gvl, &callback);
+  if (callback.state) {
+    wait->state       = callback.state;
+    wait->interrupted = 1;
+    return 0;
+  }
+  return callback.result;
+}
+
+static
+VALUE
+ruby_launch_call(VALUE data)
+{
+  launch_callback_t* const callback = (launch_callback_t*)data;
+  callback->result = RTEST(rb_funcall(callback->launcher, sel_launch, 1,
+				      wrap_nsstring(callback->launch->bundle_id)));
+  return Qnil;
+}
+
+static
+VALUE
+ruby_pid_for_call(VALUE data)
+{
+  launch_callback_t* const callback = (launch_callback_t*)data;
+  VALUE pid = rb_funcall(callback->launcher, sel_pid_for, 1,
+			 wrap_nsstring(callback->launch->bundle_id));
+  callback->result = (pid == Qnil ? 0 : NUM2PIDT(pid));
+  return Qnil;
+}
+
+static
+VALUE
+ruby_reached_call(VALUE data)
+{
+  launch_callback_t* const callback = (launch_callback_t*)data;
+  callback->result = RTEST(rb_funcall(callback->launcher, sel_reached, 2,
+				      PIDT2NUM(callback->launch->pid),
+				      launch_phases[callback->phase]));
+  return Qnil;
+}
+
+static
+int
+ruby_launch(launch_t* const launch, launch_wait_t* const wait)
+{
+  return (int)launch_callback(launch, 0, wait, ruby_launch_call);
+}
+
+static
+pid_t
+ruby_pid_for(launch_t* const launch, launch_wait_t* const wait)
+{
+  return (pid_t)launch_callback(launch, 0, wait, ruby_pid_for_call);
+}
+
+static
+int
+ruby_reached(launch_t* const launch, launch_phase_t phase, launch_wait_t* const wait)
+{
+  return (int)launch_callback(launch, phase, wait, ruby_reached_call);
+}
+
+static const launcher_t ruby_launcher = {
+  ruby_launch, ruby_pid_for, ruby_reached
+};
+
+/*
+ * Move a launch forward through as many phases as are ready right now
+ *
+ * Returns non-zero once the launch is finished, either because it
+ * reached its target phase or because the launch request was refused.
+ */
+static
+int
+launch_step(launch_t* const launch, launch_wait_t* const wait)
+{
+  const launcher_t* const launcher = wait->launcher;
+
+  if (launch->reached < 0) {
+    launch->started = CFAbsoluteTimeGetCurrent();
+    if (!launcher->launch(launch, wait)) {
+      launch->failed = 1;
+      return 1;
+    }
+    launch->reached = LAUNCH_PHASE_REQUESTED;
+    launch->timings[LAUNCH_PHASE_REQUESTED] =
+      CFAbsoluteTimeGetCurrent() - launch->started;
+  }
+
+  while (launch->reached < (int)launch->target) {
+    const launch_phase_t next = launch->reached + 1;
+
+    if (next == LAUNCH_PHASE_PID) {
+      const pid_t pid = launcher->pid_for(launch, wait);
+      if (pid <= 0)
+	return 0;
+      launch->pid = pid;
+    }
+    else if (!launcher->reached(launch, next, wait)) {
+      return 0;
+    }
+
+    launch->reached        = next;
+    launch->timings[next]  = CFAbsoluteTimeGetCurrent() - launch->started;
+  }
+
+  return 1;
+}
+
+/*
+ * Drive a list of launches to completion, with at most `concurrency`
+ * of them in flight at once; runs without the GVL
+ *
+ * Everything happens on the calling thread; each pass over the list
+ * checks every in flight launch once and then waits for a short poll
+ * interval, so slow apps do not hold up the start of the next ones.
+ *
+ * NSRunningApplication only learns about pids and finished launches
+ * when the main run loop runs, so on the main thread the wait spins the
+ * run loop instead of sleeping.
+ */
+static
+void*
+launch_wait(void* const data)
+{
+  launch_wait_t* const wait = data;
+  const int     main_thread = [NSThread isMainThread];
+  size_t           admitted = (wait->count < wait->concurrency ? wait->count : wait->concurrency);
+  size_t           finished = 0;
+
+  while (!wait->interrupted && finished < wait->count) {
+    // admitted can grow during the pass, so a freed slot is used right away
+    for (size_t i = 0; i < admitted && !wait->interrupted; i++) {
+      launch_t* const launch = &wait->launches[i];
+      if (launch->finished)
+	continue;
+
+      if (launch_step(launch, wait) ||
+	  CFAbsoluteTimeGetCurrent() - launch->started > wait->timeout) {
+	launch->finished = 1;
+	finished++;
+	if (admitted < wait->count)
+	  admitted++;
+      }
+    }
+
+    if (finished == wait->count || wait->interrupted)
+      break;
+
+    if (main_thread) {
+      @autoreleasepool {
+	spin(LAUNCH_POLL_INTERVAL);
+      }
+    }
+    else
+      usleep(LAUNCH_POLL_INTERVAL * 1000000);
+  }
+
+  return NULL;
+}
+
+static
+void
+launch_wait_interrupt(void* const data)
+{
+  ((launch_wait_t*)data)->interrupted = 1;
+}
+
+static
+void
+launch_release(launch_wait_t* const wait)
+{
+  for (size_t i = 0; i < wait->count; i++) {
+    [wait->launches[i].bundle_id release];
+    [wait->launches[i].app release];
+  }
+}
+
+/*
+ * Run all the launches; the bundle identifiers are released either way
+ *
+ * The GVL is given up for the whole wait, run loop slices included, so
+ * other Ruby threads keep going; it is only taken back for the calls
+ * into a stand-in launcher, and anything one of them raises comes out
+ * of here once the wait is over.
+ */
+static
+void
+launch_run(launch_wait_t* const wait)
+{
+  rb_thread_call_without_gvl(launch_wait, wait, launch_wait_interrupt, wait);
+  launch_release(wait);
+
+  if (wait->state)
+    rb_jump_tag(wait->state);
+  rb_thread_check_ints();
+}
+
+static
+const char*
+launch_phase_name(int phase)
+{
+  if (phase < 0)
+    return "nothing";
+  return rb_id2name(SYM2ID(launch_phases[phase]));
+}
+
+static
+launch_phase_t
+launch_phase_for(VALUE sym)
+{
+  for (int i = LAUNCH_PHASE_PID; i < LAUNCH_PHASE_COUNT; i++)
+    if (launch_phases[i] == sym)
+      return i;
+
+  VALUE inspected = rb_inspect(sym);
+  rb_raise(rb_eArgError, "unknown launch phase %s", StringValueCStr(inspected));
+  return LAUNCH_PHASE_WINDOW; // unreachable
+}
+
+static
+VALUE
+launch_timings(const launch_t* const launch)
+{
+  VALUE phases = rb_hash_new();
+  for (int i = 0; i <= launch->reached; i++)
+    rb_hash_aset(phases, launch_phases[i], DBL2NUM(launch->timings[i]));
+  return phases;
+}
+
+/*
+ * Describe why a launch did not get to its target phase, or return nil
+ * if it did
+ */
+static
+VALUE
+launch_error(const launch_t* const launch, VALUE bundle_id, double timeout)
+{
+  if (launch->failed)
+    return rb_sprintf("could not launch %s", StringValueCStr(bundle_id));
+
+  if (launch->reached < (int)launch->target)
+    return rb_sprintf("%s did not reach :%s within %g seconds (got to :%s)",
+		      StringValueCStr(bundle_id),
+		      launch_phase_name(launch->target),
+		      timeout,
+		      launch_phase_name(launch->reached));
+
+  return Qnil;
+}
+
+static
+void
+launch_init(launch_t* const launch, VALUE opts)
+{
+  VALUE   rb_until = rb_hash_lookup(opts, key_until);
+  VALUE rb_options = rb_hash_lookup(opts, key_opts);
+
+  memset(launch, 0, sizeof(launch_t));
+  launch->target  = (rb_until   == Qnil ? LAUNCH_PHASE_WINDOW : launch_phase_for(rb_until));
+  launch->options = (rb_options == Qnil ? NSWorkspaceLaunchAsync : NUM2INT(rb_options));
+  launch->reached = -1;
+}
+
+/*
+ * Launch an application and wait for it to be ready
+ *
+ * Progress is tracked natively through each phase of the launch:
+ *
+ *  - `:requested` - the launch request was accepted
+ *  - `:pid` - the app shows up as a running application
+ *  - `:launched` - the app says it has finished launching
+ *  - `:responsive` - the app answers accessibility queries
+ *  - `:window` - the app has at least one window
+ *
+ * The return value includes the pid and the number of seconds it took
+ * to reach each phase. An exception is raised if the launch request is
+ * refused or the `:until` phase is not reached in time.
+ *
+ * A stand-in `:launcher` can be given for testing; it must respond to
+ * `launch(bundle_id)`, `pid_for(bundle_id)`, and `reached?(pid, phase)`.
+ *
+ * @example
+ *
+ *   NSWorkspace.launch_and_wait 'com.apple.TextEdit', until: :window, timeout: 10
+ *     # => { pid: 1234, phases: { requested: 0.02, pid: 0.1, launched: 0.6, ... } }
+ *
+ * @param bundle_id [String]
+ * @param opts [Hash] accepts `:until`, `:timeout`, `:options`, and `:launcher`
+ * @return [Hash]
+ */
+static
+VALUE
+rb_workspace_launch_and_wait(int argc, VALUE* argv, VALUE self)
+{
+  if (!argc)
+    rb_raise(rb_eArgError, "wrong number of arguments (0 for 1+)");
+
+  VALUE bundle_id = argv[0];
+  VALUE      opts = (argc > 1 ? argv[1] : rb_hash_new());
+  StringValue(bundle_id);
+
+  VALUE  rb_timeout = rb_hash_lookup(opts, key_timeout);
+  VALUE rb_launcher = rb_hash_lookup(opts, key_launcher);
+
+  launch_t launch;
+  launch_init(&launch, opts);
+
+  launch_wait_t wait = {
+    &launch,
+    1,
+    1,
+    (rb_launcher == Qnil ? &native_launcher : &ruby_launcher),
+    rb_launcher,
+    (rb_timeout == Qnil ? LAUNCH_DEFAULT_TIMEOUT : NUM2DBL(rb_timeout)),
+    0,
+    0
+  };
+
+  launch.bundle_id = unwrap_nsstring(bundle_id);
+  launch_run(&wait);
+
+  VALUE error = launch_error(&launch, bundle_id, wait.timeout);
+  if (error != Qnil)
+    rb_exc_raise(rb_exc_new3(launch.failed ? rb_eArgError : rb_eRuntimeError, error));
+
+  VALUE result = rb_hash_new();
+  rb_hash_aset(result, key_pid,    PIDT2NUM(launch.pid));
+  rb_hash_aset(result, key_phases, launch_timings(&launch));
+  return result;
+}
+
+/*
+ * Launch several applications at once and wait for each to be ready
+ *
+ * At most `:concurrency` launches are in flight at any time; as soon as
+ * one app reaches the `:until` phase (or fails, or times out), the
+ * next one is started. The `:timeout` applies to each app separately,
+ * counting from when its launch was requested.
+ *
+ * Failures do not raise; instead, each result has an `:error` message
+ * which is `nil` when the app got to where it needed to be. Results
+ * are in the same order as the given bundle identifiers.
+ *
+ * Accepts the same options as {launch_and_wait}, as well as
+ * `:concurrency`, which defaults to 4.
+ *
+ * @example
+ *
+ *   NSWorkspace.launch_all ['com.apple.TextEdit', 'com.apple.Grab'], concurrency: 2
+ *     # => [{ bundle_id: 'com.apple.TextEdit', pid: 1234, phases: {...}, error: nil },
+ *           { bundle_id: 'com.apple.Grab',     pid: 1235, phases: {...}, error: nil }]
+ *
+ * @param bundle_ids [Array<String>]
+ * @param opts [Hash]
+ * @return [Array<Hash>]
+ */
+static
+VALUE
+rb_workspace_launch_all(int argc, VALUE* argv, VALUE self)
+{
+  if (!argc)
+    rb_raise(rb_eArgError, "wrong number of arguments (0 for 1+)");
+
+  VALUE        ids = rb_ary_dup(rb_Array(argv[0]));
+  VALUE       opts = (argc > 1 ? argv[1] : rb_hash_new());
+  const long count = RARRAY_LEN(ids);
+  for (long i = 0; i < count; i++) {
+    VALUE id = rb_ary_entry(ids, i);
+    rb_ary_store(ids, i, StringValue(id));
+  }
+
+  VALUE  rb_timeout = rb_hash_lookup(opts, key_timeout);
+  VALUE rb_launcher = rb_hash_lookup(opts, key_launcher);
+  VALUE  rb_workers = rb_hash_lookup(opts, key_concurrency);
+  const long workers = (rb_workers == Qnil ? LAUNCH_DEFAULT_CONCURRENCY : NUM2LONG(rb_workers));
+  if (workers < 1)
+    rb_raise(rb_eArgError, "concurrency must be at least 1 (got %ld)", workers);
+
+  launch_t proto;
+  launch_init(&proto, opts);
+
+  // buffer is owned by the GC if the stand-in launcher raises
+  VALUE          buffer;
+  launch_t* const launches = ALLOCV_N(launch_t, buffer, count);
+  for (long i = 0; i < count; i++) {
+    launches[i]           = proto;
+    launches[i].bundle_id = unwrap_nsstring(rb_ary_entry(ids, i));
+  }
+
+  launch_wait_t wait = {
+    launches,
+    count,
+    workers,
+    (rb_launcher == Qnil ? &native_launcher : &ruby_launcher),
+    rb_launcher,
+    (rb_timeout == Qnil ? LAUNCH_DEFAULT_TIMEOUT : NUM2DBL(rb_timeout)),
+    0,
+    0
+  };
+
+  launch_run(&wait);
+
+  VALUE results = rb_ary_new2(count);
+  for (long i = 0; i < count; i++) {
+    const launch_t* const launch = &launches[i];
+    VALUE                     id = rb_ary_entry(ids, i);
+    VALUE                 result = rb_hash_new();
+    rb_hash_aset(result, key_bundle_id, id);
+    rb_hash_aset(result, key_pid,       launch->pid > 0 ? PIDT2NUM(launch->pid) : Qnil);
+    rb_hash_aset(result, key_phases,    launch_timings(launch));
+    rb_hash_aset(result, key_error,     launch_error(launch, id, wait.timeout));
+    rb_ary_push(results, result);
+  }
+
+  ALLOCV_END(buffer);
+  return results;
+}
+
+
+/*
+ * Create a new registry
+ *
+ * By default the registry tracks `NSWorkspace.runningApplications`, but
+ * any object that responds to `#call` and returns a list of objects that
+ * respond to `#processIdentifier` can be given as the source instead.
+ *
+ * @param source [#call,nil]
+ */
+static
+VALUE
+rb_registry_init(int argc, VALUE* argv, VALUE self)
+{
+  rb_ivar_set(self, ivar_source,       argc ? argv[0] : Qnil);
+  rb_ivar_set(self, ivar_apps,         rb_hash_new());
+  rb_ivar_set(self, ivar_by_bundle_id, rb_hash_new());
+  rb_ivar_set(self, ivar_by_name,      rb_hash_new());
+  return self;
+}
+
+static
+void
+registry_index(VALUE index, VALUE key, VALUE app)
+{
+  if (key == Qnil)
+    return;
+
+  VALUE list = rb_hash_lookup(index, key);
+  if (list == Qnil) {
+    list = rb_ary_new();
+    rb_hash_aset(index, key, list);
+  }
+  rb_ary_push(list, app);
+}
+
+static
+void
+registry_unindex(VALUE index, VALUE key, VALUE app)
+{
+  if (key == Qnil)
+    return;
+
+  VALUE list = rb_hash_lookup(index, key);
+  if (list == Qnil)
+    return;
+
+  rb_ary_delete(list, app);
+  if (!RARRAY_LEN(list))
+    rb_hash_delete(index, key);
+}
+
+static
+void
+registry_unindex_app(VALUE self, VALUE app)
+{
+  registry_unindex(rb_ivar_get(self, ivar_by_bundle_id),
+		   rb_funcall(app, sel_bundle_identifier, 0), app);
+  registry_unindex(rb_ivar_get(self, ivar_by_name),
+		   rb_funcall(app, sel_localized_name, 0), app);
+}
+
+// Whether `app` is the process that is already registered under its pid,
+// and not a new process that has been given the same pid; apps from a
+// custom source are only told apart if they have a launch date
+static
+int
+registry_same_app(VALUE known, VALUE app)
+{
+  if (known == app || !rb_respond_to(app, sel_launch_date))
+    return 1;
+  return RTEST(rb_equal(rb_funcall(known, sel_launch_date, 0),
+			rb_funcall(app,   sel_launch_date, 0)));
+}
+
+static
+int
+registry_same_running_app(VALUE known, NSRunningApplication* const app)
+{
+  NSRunningApplication* const old = unwrap_app(known);
+  if (old == app)
+    return 1;
+  if (old.isTerminated)
+    return 0;
+
+  NSDate* const old_date = old.launchDate;
+  NSDate* const new_date = app.launchDate;
+  return (old_date == new_date || [old_date isEqualToDate:new_date]);
+}
+
+// Add an app that is new to the registry, replacing whatever app used to
+// have the same pid
+static
+void
+registry_add(VALUE self, VALUE seen, VALUE added, VALUE removed, VALUE pid, VALUE app)
+{
+  VALUE  apps = rb_ivar_get(self, ivar_apps);
+  VALUE known = rb_hash_lookup2(apps, pid, Qundef);
+  if (known != Qundef) {
+    registry_unindex_app(self, known);
+    rb_ary_push(removed, known);
+  }
+
+  rb_hash_aset(seen, pid, Qtrue);
+  rb_hash_aset(apps, pid, app);
+  rb_ary_push(added, app);
+
+  // bundle identifiers and names do not change, so they only need
+  // to be looked up once, when the app first shows up
+  registry_index(rb_ivar_get(self, ivar_by_bundle_id),
+		 rb_funcall(app, sel_bundle_identifier, 0), app);
+  registry_index(rb_ivar_get(self, ivar_by_name),
+		 rb_funcall(app, sel_localized_name, 0), app);
+}
+
+static
+int
+registry_sweep(VALUE pid, VALUE app, VALUE context)
+{
+  VALUE     seen = rb_ary_entry(context, 0);
+  VALUE  removed = rb_ary_entry(context, 1);
+  VALUE     self = rb_ary_entry(context, 2);
+  if (rb_hash_lookup2(seen, pid, Qundef) != Qundef)
+    return ST_CONTINUE;
+
+  registry_unindex_app(self, app);
+  rb_ary_push(removed, app);
+  return ST_DELETE;
+}
+
+typedef struct {
+  VALUE    self;
+  VALUE    seen;
+  VALUE    added;
+  VALUE    removed;
+  NSArray* apps;
+} registry_running_t;
+
+static
+VALUE
+registry_note_running(VALUE data)
+{
+  registry_running_t* const running = (registry_running_t*)data;
+  VALUE apps = rb_ivar_get(running->self, ivar_apps);
+
+  for (NSRunningApplication* app in running->apps) {
+    VALUE   pid = PIDT2NUM(app.processIdentifier);
+    VALUE known = rb_hash_lookup2(apps, pid, Qundef);
+    if (known != Qundef && registry_same_running_app(known, app))
+      rb_hash_aset(running->seen, pid, Qtrue);
+    else
+      registry_add(running->self, running->seen, running->added, running->removed,
+		   pid, wrap_app([app retain]));
+  }
+  return Qnil;
+}
+
+static
+VALUE
+registry_release_running(VALUE data)
+{
+  [((registry_running_t*)data)->apps release];
+  return Qnil;
+}
+
+/*
+ * Update the registry and return the applications that were launched and
+ * terminated since the last poll
+ *
+ * Only the list of pids is compared; applications that were already known
+ * keep the same wrapper object, so nothing is allocated for them. A pid
+ * that now belongs to a different process, going by its launch date, is
+ * reported as both terminated and launched.
+ *
+ * @return [Array(Array<NSRunningApplication>, Array<NSRunningApplication>)]
+ */
+static
+VALUE
+rb_registry_poll(VALUE self)
+{
+  VALUE  source = rb_ivar_get(self, ivar_source);
+  VALUE    apps = rb_ivar_get(self, ivar_apps);
+  VALUE    seen = rb_hash_new();
+  VALUE   added = rb_ary_new();
+  VALUE removed = rb_ary_new();
+
+  if (source == Qnil) {
+    registry_running_t running = { self, seen, added, removed, nil };
+    // drain whatever NSWorkspace autoreleases right away, so that polling
+    // in a loop does not pile up objects until some outer pool drains;
+    // the array itself is kept until the Ruby side is done with it
+    @autoreleasepool {
+      // runningApplications is only updated from the run loop
+      spin(0);
+      running.apps = [[[NSWorkspace sharedWorkspace] runningApplications] retain];
+    }
+    rb_ensure(registry_note_running, (VALUE)&running,
+	      registry_release_running, (VALUE)&running);
+  }
+  else {
+    VALUE list = rb_ary_to_ary(rb_funcall(source, sel_call, 0));
+    for (long i = 0; i < RARRAY_LEN(list); i++) {
+      VALUE   app = rb_ary_entry(list, i);
+      VALUE   pid = rb_funcall(app, sel_process_identifier, 0);
+      VALUE known = rb_hash_lookup2(apps, pid, Qundef);
+      if (known != Qundef && registry_same_app(known, app))
+	rb_hash_aset(seen, pid, Qtrue);
+      else
+	registry_add(self, seen, added, removed, pid, app);
+    }
+  }
+
+  rb_hash_foreach(apps, registry_sweep, rb_ary_new3(3, seen, removed, self));
+  return rb_ary_new3(2, added, removed);
+}
+
+/*
+ * All applications that were running as of the last {#poll}
+ *
+ * @return [Array<NSRunningApplication>]
+ */
+static
+VALUE
+rb_registry_apps(VALUE self)
+{
+  return rb_funcall(rb_ivar_get(self, ivar_apps), rb_intern("values"), 0);
+}
+
+/*
+ * Look up an application by pid without asking the system
+ *
+ * @param pid [Number]
+ * @return [NSRunningApplication,nil]
+ */
+static
+VALUE
+rb_registry_lookup(VALUE self, VALUE pid)
+{
+  return rb_hash_lookup(rb_ivar_get(self, ivar_apps), pid);
+}
+
+static
+VALUE
+rb_registry_size(VALUE self)
+{
+  return rb_funcall(rb_ivar_get(self, ivar_apps), rb_intern("size"), 0);
+}
+
+static
+VALUE
+registry_find(VALUE self, ID index, VALUE key)
+{
+  VALUE list = rb_hash_lookup(rb_ivar_get(self, index), key);
+  return (list == Qnil ? rb_ary_new() : rb_ary_dup(list));
+}
+
+/*
+ * Applications with the given bundle identifier, as of the last {#poll}
+ *
+ * @param bundle_id [String]
+ * @return [Array<NSRunningApplication>]
+ */
+static
+VALUE
+rb_registry_with_bundle_id(VALUE self, VALUE bundle_id)
+{
+  return registry_find(self, ivar_by_bundle_id, bundle_id);
+}
+
+/*
+ * Applications with the given localized name, as of the last {#poll}
+ *
+ * @param name [String]
+ * @return [Array<NSRunningApplication>]
+ */
+static
+VALUE
+rb_registry_named(VALUE self, VALUE name)
+{
+  return registry_find(self, ivar_by_name, name);
+}
+
+static
+int
+registry_match(VALUE key, VALUE list, VALUE context)
+{
+  VALUE pattern = rb_ary_entry(context, 0);
+  if (fnmatch(StringValueCStr(pattern), StringValueCStr(key), 0) == 0)
+    rb_ary_concat(rb_ary_entry(context, 1), list);
+  return ST_CONTINUE;
+}
+
+static
+VALUE
+registry_match_index(VALUE self, ID index, VALUE pattern)
+{
+  StringValue(pattern);
+  VALUE found = rb_ary_new();
+  rb_hash_foreach(rb_ivar_get(self, index), registry_match,
+		  rb_ary_new3(2, pattern, found));
+  return found;
+}
+
+/*
+ * Applications whose bundle identifier matches a shell style wildcard
+ * pattern, as of the last {#poll}
+ *
+ * @example
+ *
+ *   registry.matching 'com.apple.*'
+ *
+ * @param pattern [String]
+ * @return [Array<NSRunningApplication>]
+ */
+static
+VALUE
+rb_registry_matching(VALUE self, VALUE pattern)
+{
+  return registry_match_index(self, ivar_by_bundle_id, pattern);
+}
+
+/*
+ * Applications whose localized name matches a shell style wildcard
+ * pattern, as of the last {#poll}
+ *
+ * @param pattern [String]
+ * @return [Array<NSRunningApplication>]
+ */
+static
+VALUE
+rb_registry_matching_name(VALUE self, VALUE pattern)
+{
+  return registry_match_index(self, ivar_by_name, pattern);
+}
+
+
+/*
+ * Answered from an {Accessibility::AppRegistry} that is only polled again
+ * after NSWorkspace reports that an app was launched or terminated, so
+ * repeated lookups do not ask the system for anything and give back the
+ * same wrapper objects each time.
+ */
+static
+VALUE
+rb_running_app_with_bundle_id(VALUE self, VALUE bundle_id)
+{
+  StringValue(bundle_id);
+
+  spin(0); // workspace notifications are delivered from the run loop
+  if (shared_registry_stale) {
+    shared_registry_stale = 0;
+    rb_registry_poll(shared_registry);
+  }
+  return rb_registry_with_bundle_id(shared_registry, bundle_id);
+}
+
+
+static
+VALUE
+rb_procinfo_self(VALUE self)
+{
+  return self;
+}
+
+static
+VALUE
+rb_procinfo_os_version(VALUE self)
+{
+  NSString* value = [[NSProcessInfo processInfo] operatingSystemVersionString];
+  VALUE       obj = wrap_nsstring(value);
+  [value release];
+  return obj;
+}
+
+static
+VALUE
+rb_procinfo_sys_uptime(VALUE self)
+{
+  return DBL2NUM([[NSProcessInfo processInfo] systemUptime]);
+}
+
+static
+VALUE
+rb_procinfo_cpu_count(VALUE self)
+{
+  return INT2FIX([[NSProcessInfo processInfo] processorCount]);
+}
+
+static
+VALUE
+rb_procinfo_active_cpus(VALUE self)
+{
+  return INT2FIX([[NSProcessInfo processInfo] activeProcessorCount]);
+}
+
+static
+VALUE
+rb_procinfo_total_ram(VALUE self)
+{
+  return ULL2NUM([[NSProcessInfo processInfo] physicalMemory]);
+}
+
+
+/*
+ * Background sampling of host load
+ *
+ * Samples are taken by a timer on a private serial queue, which is also
+ * the only place where the ring buffer is written, so there is exactly
+ * one writer at any time. Readers never block: each slot carries a
+ * sequence number that is odd while the slot is being written, so a
+ * reader copies the slot and then throws the copy away if the sequence
+ * number changed (or was odd) in the meantime.
+ */
+
+#define PROCINFO_DEFAULT_CAPACITY 1024
+#define PROCINFO_DEFAULT_INTERVAL 1.0
+
+typedef struct {
+  uint64_t index;       // position in the stream of samples, used to spot overwrites
+  double   time;        // seconds since the Unix epoch
+  double   uptime;
+  double   load[3];
+  uint64_t memory;
+  uint64_t free_memory;
+  long     cpus;
+  long     active_cpus;
+} procinfo_sample_t;
+
+typedef struct {
+  volatile uint64_t seq;
+  procinfo_sample_t sample;
+} procinfo_slot_t;
+
+static procinfo_slot_t*  procinfo_ring     = NULL;
+static size_t            procinfo_capacity = 0;
+static volatile uint64_t procinfo_head     = 0; // index of the next sample to write
+static dispatch_queue_t  procinfo_queue    = NULL;
+static dispatch_source_t procinfo_timer    = NULL;
+
+static VALUE key_time;
+static VALUE key_uptime;
+static VALUE key_load;
+static VALUE key_memory;
+static VALUE key_free_memory;
+static VALUE key_cpus;
+static VALUE key_active_cpus;
+static VALUE key_since;
+static VALUE key_interval;
+static VALUE key_capacity;
+
+// must only be called on procinfo_queue
+static
+void
+procinfo_record(procinfo_sample_t sample)
+{
+  const uint64_t         head = __atomic_load_n(&procinfo_head, __ATOMIC_RELAXED);
+  procinfo_slot_t* const slot = &procinfo_ring[head % procinfo_capacity];
+
+  sample.index = head;
+  __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->sample = sample;
+  __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&procinfo_head, head + 1, __ATOMIC_RELEASE);
+}
+
+// copies a slot, returning 0 if it was overwritten while we looked
+static
+int
+procinfo_read(const uint64_t index, procinfo_sample_t* const sample)
+{
+  const procinfo_slot_t* const slot = &procinfo_ring[index % procinfo_capacity];
+  const uint64_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+  if (before & 1)
+    return 0;
+
+  *sample = slot->sample;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+  return (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == before &&
+	  sample->index == index);
+}
+
+static
+procinfo_sample_t
+procinfo_measure()
+{
+  procinfo_sample_t sample;
+  memset(&sample, 0, sizeof(procinfo_sample_t));
+
+  @autoreleasepool {
+    NSProcessInfo* const info = [NSProcessInfo processInfo];
+    sample.time        = CFAbsoluteTimeGetCurrent() + kCFAbsoluteTimeIntervalSince1970;
+    sample.uptime      = info.systemUptime;
+    sample.cpus        = info.processorCount;
+    sample.active_cpus = info.activeProcessorCount;
+    sample.memory      = info.physicalMemory;
+  }
+
+  if (getloadavg(sample.load, 3) < 0)
+    sample.load[0] = sample.load[1] = sample.load[2] = -1.0;
+
+  vm_statistics64_data_t vm;
+  mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+  mach_port_t             host = mach_host_self();
+  if (host_statistics64(host, HOST_VM_INFO64, (host_info64_t)&vm, &count) == KERN_SUCCESS)
+    sample.free_memory = (uint64_t)vm.free_count * vm_page_size;
+  mach_port_deallocate(mach_task_self(), host);
+
+  return sample;
+}
+
+static
+VALUE
+procinfo_wrap_sample(const procinfo_sample_t* const sample)
+{
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, key_time,        DBL2NUM(sample->time));
+  rb_hash_aset(hash, key_uptime,      DBL2NUM(sample->uptime));
+  rb_hash_aset(hash, key_cpus,        LONG2NUM(sample->cpus));
+  rb_hash_aset(hash, key_active_cpus, LONG2NUM(sample->active_cpus));
+  rb_hash_aset(hash, key_load,        rb_ary_new3(3,
+						   DBL2NUM(sample->load[0]),
+						   DBL2NUM(sample->load[1]),
+						   DBL2NUM(sample->load[2])));
+  rb_hash_aset(hash, key_memory,      ULL2NUM(sample->memory));
+  rb_hash_aset(hash, key_free_memory, ULL2NUM(sample->free_memory));
+  return hash;
+}
+
+static
+double
+procinfo_hash_double(VALUE hash, VALUE key)
+{
+  VALUE value = rb_hash_lookup(hash, key);
+  return (value == Qnil ? 0.0 : NUM2DBL(value));
+}
+
+// Set up the queue and ring buffer on first use, or resize the ring
+// buffer (dropping the samples it held) when asked for a new capacity
+static
+void
+procinfo_prepare(size_t capacity)
+{
+  if (!procinfo_queue)
+    procinfo_queue = dispatch_queue_create("org.axelements.accessibility.procinfo",
+					   DISPATCH_QUEUE_SERIAL);
+
+  if (procinfo_ring && (!capacity || capacity == procinfo_capacity))
+    return;
+  if (!capacity)
+    capacity = PROCINFO_DEFAULT_CAPACITY;
+
+  procinfo_slot_t* const ring = ALLOC_N(procinfo_slot_t, capacity);
+  memset(ring, 0, sizeof(procinfo_slot_t) * capacity);
+
+  // readers always hold the GVL, as does the caller, so none are running
+  __block procinfo_slot_t* old_ring = NULL;
+  dispatch_sync(procinfo_queue, ^{
+      old_ring          = procinfo_ring;
+      procinfo_ring     = ring;
+      procinfo_capacity = capacity;
+      procinfo_head     = 0;
+    });
+  xfree(old_ring);
+}
+
+/*
+ * Start recording samples of the host load in the background
+ *
+ * A sample is taken every `:interval` seconds (default `1.0`) and kept
+ * in a ring buffer that holds the last `:capacity` samples (default
+ * `1024`). Changing the capacity throws away the samples that have
+ * already been recorded.
+ *
+ * Sampling happens on a background queue and does not need the GVL;
+ * use {samples} to get at the results.
+ *
+ * @param opts [Hash]
+ * @return [Boolean] `false` if sampling was already running
+ */
+static
+VALUE
+rb_procinfo_start_sampling(int argc, VALUE* argv, VALUE self)
+{
+  VALUE        opts = (argc ? argv[0] : rb_hash_new());
+  VALUE rb_interval = rb_hash_lookup(opts, key_interval);
+  VALUE rb_capacity = rb_hash_lookup(opts, key_capacity);
+
+  const double interval =
+    (rb_interval == Qnil ? PROCINFO_DEFAULT_INTERVAL : NUM2DBL(rb_interval));
+  if (interval <= 0)
+    rb_raise(rb_eArgError, "interval must be positive (got %f)", interval);
+
+  const long capacity = (rb_capacity == Qnil ? 0 : NUM2LONG(rb_capacity));
+  if (rb_capacity != Qnil && capacity < 1)
+    rb_raise(rb_eArgError, "capacity must be at least 1 (got %ld)", capacity);
+
+  // checked after the arguments, so bad ones raise whether or not
+  // sampling is already running
+  if (procinfo_timer)
+    return Qfalse;
+
+  procinfo_prepare(capacity);
+
+  procinfo_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, procinfo_queue);
+  dispatch_source_set_timer(procinfo_timer,
+			    dispatch_time(DISPATCH_TIME_NOW, 0),
+			    (uint64_t)(interval * NSEC_PER_SEC),
+			    (uint64_t)(interval * NSEC_PER_SEC / 10));
+  dispatch_source_set_event_handler(procinfo_timer, ^{
+      procinfo_record(procinfo_measure());
+    });
+  dispatch_resume(procinfo_timer);
+
+  return Qtrue;
+}
+
+/*
+ * Stop recording samples in the background
+ *
+ * Samples that were already recorded are kept.
+ *
+ * @return [Boolean] `false` if sampling was not running
+ */
+static
+VALUE
+rb_procinfo_stop_sampling(VALUE self)
+{
+  if (!procinfo_timer)
+    return Qfalse;
+
+  dispatch_source_cancel(procinfo_timer);
+  dispatch_release(procinfo_timer);
+  procinfo_timer = NULL;
+  dispatch_sync(procinfo_queue, ^{}); // wait for an in flight sample
+  return Qtrue;
+}
+
+/*
+ * Whether or not samples are being recorded in the background
+ *
+ * @return [Boolean]
+ */
+static
+VALUE
+rb_procinfo_is_sampling(VALUE self)
+{
+  return (procinfo_timer ? Qtrue : Qfalse);
+}
+
+/*
+ * Take a sample right away and add it to the ring buffer
+ *
+ * @return [Hash]
+ */
+static
+VALUE
+rb_procinfo_sample_now(VALUE self)
+{
+  procinfo_prepare(0);
+
+  __block procinfo_sample_t sample;
+  dispatch_sync(procinfo_queue, ^{
+      sample = procinfo_measure();
+      procinfo_record(sample);
+    });
+
+  return procinfo_wrap_sample(&sample);
+}
+
+/*
+ * Add a sample that was measured somewhere else to the ring buffer
+ *
+ * This is meant for feeding in readings from another source, such as
+ * canned data in tests. It takes a hash with the same keys as the
+ * samples returned by {samples}; missing values are `0`.
+ *
+ * @param sample [Hash]
+ * @return [Hash]
+ */
+static
+VALUE
+rb_procinfo_record_sample(VALUE self, VALUE rb_sample)
+{
+  Check_Type(rb_sample, T_HASH);
+  procinfo_prepare(0);
+
+  procinfo_sample_t sample;
+  memset(&sample, 0, sizeof(procinfo_sample_t));
+  sample.time   = procinfo_hash_double(rb_sample, key_time);
+  sample.uptime = procinfo_hash_double(rb_sample, key_uptime);
+
+  VALUE value = rb_hash_lookup(rb_sample, key_cpus);
+  sample.cpus = (value == Qnil ? 0 : NUM2LONG(value));
+  value = rb_hash_lookup(rb_sample, key_active_cpus);
+  sample.active_cpus = (value == Qnil ? 0 : NUM2LONG(value));
+  value = rb_hash_lookup(rb_sample, key_memory);
+  sample.memory = (value == Qnil ? 0 : NUM2ULL(value));
+  value = rb_hash_lookup(rb_sample, key_free_memory);
+  sample.free_memory = (value == Qnil ? 0 : NUM2ULL(value));
+
+  value = rb_hash_lookup(rb_sample, key_load);
+  if (value != Qnil) {
+    Check_Type(value, T_ARRAY);
+    for (long i = 0; i < 3 && i < RARRAY_LEN(value); i++)
+      sample.load[i] = NUM2DBL(rb_ary_entry(value, i));
+  }
+
+  dispatch_sync(procinfo_queue, ^{ procinfo_record(sample); });
+
+  return procinfo_wrap_sample(&sample);
+}
+
+/*
+ * Returns the recorded samples, oldest first
+ *
+ * Each sample is a hash with the `:time` it was taken (seconds since
+ * the Unix epoch), the system `:uptime`, `:cpus` and `:active_cpus`,
+ * the 1, 5, and 15 minute `:load` averages, and the total and free
+ * `:memory` in bytes.
+ *
+ * Reading samples never waits for the background sampler. Only samples
+ * taken after `:since` (a `Time` or epoch seconds) are returned if it
+ * is given.
+ *
+ * @example
+ *
+ *   NSProcessInfo.start_sampling interval: 0.5
+ *   # ...
+ *   NSProcessInfo.samples(since: Time.now - 10).map { |s| s[:load].first }
+ *
+ * @param opts [Hash]
+ * @return [Array<Hash>]
+ */
+static
+VALUE
+rb_procinfo_samples(int argc, VALUE* argv, VALUE self)
+{
+  VALUE     opts = (argc ? argv[0] : rb_hash_new());
+  VALUE rb_since = rb_hash_lookup(opts, key_since);
+  double   since = -INFINITY;
+  if (rb_since != Qnil)
+    since = NUM2DBL(rb_Float(rb_obj_is_kind_of(rb_since, rb_cTime) ?
+			     rb_funcall(rb_since, rb_intern("to_f"), 0) :
+			     rb_since));
+
+  VALUE samples = rb_ary_new();
+  if (!procinfo_ring)
+    return samples;
+
+  const uint64_t head  = __atomic_load_n(&procinfo_head, __ATOMIC_ACQUIRE);
+  const uint64_t first = (head > procinfo_capacity ? head - procinfo_capacity : 0);
+
+  for (uint64_t i = first; i < head; i++) {
+    procinfo_sample_t sample;
+    if (procinfo_read(i, &sample) && sample.time > since)
+      rb_ary_push(samples, procinfo_wrap_sample(&sample));
+  }
+
+  return samples;
+}
+
+/*
+ * Throw away all the recorded samples
+ *
+ * @return [nil]
+ */
+static
+VALUE
+rb_procinfo_clear_samples(VALUE self)
+{
+  if (procinfo_ring)
+    dispatch_sync(procinfo_queue, ^{
+	memset(procinfo_ring, 0, sizeof(procinfo_slot_t) * procinfo_capacity);
+	__atomic_store_n(&procinfo_head, 0, __ATOMIC_RELEASE);
+      });
+  return Qnil;
+}
+
+
+/*
+ * Host lookups can take seconds when DNS is slow, so they are done once
+ * on a background queue (starting when the extension is loaded) and the
+ * results are cached as frozen Ruby objects. Readers only ever wait if
+ * nothing has been resolved yet; after an explicit refresh they keep
+ * getting the old values until the new ones are ready.
+ *
+ * The background queue cannot touch Ruby, so it leaves its results in
+ * the host_pending_* slots and the next reader converts them.
+ */
+
+static dispatch_queue_t host_queue = NULL;
+static dispatch_group_t host_group = NULL;
+static pthread_mutex_t  host_lock  = PTHREAD_MUTEX_INITIALIZER;
+
+static NSArray*  host_pending_names          = nil;
+static NSArray*  host_pending_addresses      = nil;
+static NSString* host_pending_localized_name = nil;
+static int       host_pending                = 0;
+static unsigned  host_generation             = 0; // bumped when results go stale
+
+static VALUE        host_names          = Qnil;
+static VALUE        host_addresses      = Qnil;
+static VALUE        host_localized_name = Qnil;
+static int          host_resolved       = 0;
+static VALUE        host_resolver       = Qnil; // stand-in used instead of NSHost
+static VALUE        host_thread         = Qnil; // thread running the stand-in
+static volatile int host_wait_interrupted = 0;
+
+static ID sel_names;
+static ID sel_addresses;
+static ID sel_join;
+
+static
+void
+host_resolve_native()
+{
+  const unsigned generation = host_generation;
+  dispatch_group_async(host_group, host_queue, ^{
+      @autoreleasepool {
+	[NSHost flushHostCache];
+	NSHost* const         host = [NSHost currentHost];
+	NSArray* const       names = [[host names] copy];
+	NSArray* const   addresses = [[host addresses] copy];
+	NSString* const local_name = [[host localizedName] copy];
+
+	pthread_mutex_lock(&host_lock);
+	if (generation != host_generation) {
+	  pthread_mutex_unlock(&host_lock);
+	  [names release];
+	  [addresses release];
+	  [local_name release];
+	  return;
+	}
+	[host_pending_names release];
+	[host_pending_addresses release];
+	[host_pending_localized_name release];
+	host_pending_names          = names;
+	host_pending_addresses      = addresses;
+	host_pending_localized_name = local_name;
+	host_pending                = 1;
+	pthread_mutex_unlock(&host_lock);
+      }
+    });
+}
+
+static
+VALUE
+host_freeze_string(VALUE string)
+{
+  return (string == Qnil ? Qnil : rb_obj_freeze(rb_str_dup(StringValue(string))));
+}
+
+static
+VALUE
+host_freeze_strings(VALUE strings)
+{
+  VALUE list = rb_ary_dup(rb_Array(strings));
+  for (long i = 0; i < RARRAY_LEN(list); i++)
+    rb_ary_store(list, i, host_freeze_string(rb_ary_entry(list, i)));
+  return rb_obj_freeze(list);
+}
+
+// take whatever the background queue left behind, needs the GVL
+static
+void
+host_take_pending()
+{
+  pthread_mutex_lock(&host_lock);
+  const int            ready = host_pending;
+  NSArray* const       names = host_pending_names;
+  NSArray* const   addresses = host_pending_addresses;
+  NSString* const local_name = host_pending_localized_name;
+  host_pending_names          = nil;
+  host_pending_addresses      = nil;
+  host_pending_localized_name = nil;
+  host_pending                = 0;
+  pthread_mutex_unlock(&host_lock);
+
+  if (!ready)
+    return;
+
+  host_names          = host_freeze_strings(names ? wrap_array_nsstrings(names) : rb_ary_new());
+  host_addresses      = host_freeze_strings(addresses ? wrap_array_nsstrings(addresses) : rb_ary_new());
+  host_localized_name = host_freeze_string(local_name ? wrap_nsstring(local_name) : Qnil);
+  host_resolved       = 1;
+
+  [names release];
+  [addresses release];
+  [local_name release];
+}
+
+static
+VALUE
+host_resolve_ruby(void* const data)
+{
+  const VALUE resolver = (VALUE)data;
+  if (resolver != host_resolver)
+    return Qnil;
+
+  const VALUE    names = host_freeze_strings(rb_funcall(resolver, sel_names, 0));
+  const VALUE    addrs = host_freeze_strings(rb_funcall(resolver, sel_addresses, 0));
+  const VALUE     name = host_freeze_string(rb_funcall(resolver, sel_localized_name, 0));
+
+  // the resolver could have been swapped while we were calling it
+  if (resolver != host_resolver)
+    return Qnil;
+
+  // no other Ruby thread can run between these, so readers see all or nothing
+  host_names          = names;
+  host_addresses      = addrs;
+  host_localized_name = name;
+  host_resolved       = 1;
+  return Qnil;
+}
+
+static
+void*
+host_wait(void* const data)
+{
+  while (!host_wait_interrupted &&
+	 dispatch_group_wait(host_group, dispatch_time(DISPATCH_TIME_NOW, 50 * NSEC_PER_MSEC)))
+    ;
+  return NULL;
+}
+
+static
+void
+host_wait_interrupt(void* const data)
+{
+  host_wait_interrupted = 1;
+}
+
+static
+void
+host_ensure_resolved()
+{
+  host_take_pending();
+  if (host_resolved)
+    return;
+
+  if (host_thread != Qnil) {
+    rb_funcall(host_thread, sel_join, 0);
+    return;
+  }
+
+  host_wait_interrupted = 0;
+  rb_thread_call_without_gvl(host_wait, NULL, host_wait_interrupt, NULL);
+  rb_thread_check_ints();
+  host_take_pending();
+}
+
+static
+VALUE
+rb_host_self(VALUE self)
+{
+  return self; // hack
+}
+
+/*
+ * Returns the names of the current host
+ *
+ * Names are looked up in the background and cached; see {refresh}.
+ *
+ * @return [Array<String>] frozen
+ */
+static
+VALUE
+rb_host_names(VALUE self)
+{
+  host_ensure_resolved();
+  return host_names;
+}
+
+/*
+ * Returns the addresses of the current host
+ *
+ * Addresses are looked up in the background and cached; see {refresh}.
+ *
+ * @return [Array<String>] frozen
+ */
+static
+VALUE
+rb_host_addresses(VALUE self)
+{
+  host_ensure_resolved();
+  return host_addresses;
+}
+
+/*
+ * Returns the localized name of the current host
+ *
+ * @return [String] frozen
+ */
+static
+VALUE
+rb_host_localized_name(VALUE self)
+{
+  host_ensure_resolved();
+  return host_localized_name;
+}
+
+/*
+ * Look up the host information again in the background
+ *
+ * This does not wait for the lookup; until it finishes, the previously
+ * cached values are returned.
+ *
+ * @return [nil]
+ */
+static
+VALUE
+rb_host_refresh(VALUE self)
+{
+  if (host_resolver == Qnil)
+    host_resolve_native();
+  else
+    host_thread = rb_thread_create(host_resolve_ruby, (void*)host_resolver);
+  return Qnil;
+}
+
+/*
+ * Whether or not the host information has been looked up yet
+ *
+ * @return [Boolean]
+ */
 static
 VALUE
-rb_procinfo_self(VALUE self)
+rb_host_is_resolved(VALUE self)
 {
-  return self;
+  host_take_pending();
+  return (host_resolved ? Qtrue : Qfalse);
 }
 
+/*
+ * Use a stand-in instead of `NSHost` for looking up host information
+ *
+ * The resolver must respond to `names`, `addresses`, and
+ * `localizedName`; it is called from a background Ruby thread. Cached
+ * values are discarded and a lookup is started with the new resolver.
+ * Set it to `nil` to go back to using `NSHost`.
+ *
+ * @param resolver [Object,nil]
+ * @return [Object,nil]
+ */
 static
 VALUE
-rb_procinfo_os_version(VALUE self)
+rb_host_set_resolver(VALUE self, VALUE resolver)
 {
-  NSString* value = [[NSProcessInfo processInfo] operatingSystemVersionString];
-  VALUE       obj = wrap_nsstring(value);
-  [value release];
-  return obj;
+  // anything still being looked up with the old resolver is thrown away
+  pthread_mutex_lock(&host_lock);
+  host_generation++;
+  [host_pending_names release];
+  [host_pending_addresses release];
+  [host_pending_localized_name release];
+  host_pending_names          = nil;
+  host_pending_addresses      = nil;
+  host_pending_localized_name = nil;
+  host_pending                = 0;
+  pthread_mutex_unlock(&host_lock);
+
+  host_resolver       = resolver;
+  host_thread         = Qnil;
+  host_names          = Qnil;
+  host_addresses      = Qnil;
+  host_localized_name = Qnil;
+  host_resolved       = 0;
+
+  rb_host_refresh(self);
+  return resolver;
 }
 
 static
 VALUE
-rb_procinfo_sys_uptime(VALUE self)
+rb_host_resolver(VALUE self)
 {
-  return DBL2NUM([[NSProcessInfo processInfo] systemUptime]);
+  return host_resolver;
 }
 
+
+// Info.plist values are converted the first time they are asked for
+// and then kept, frozen, for the life of the bundle object
+typedef struct {
+  NSBundle* bundle;
+  VALUE     info;  // the whole infoDictionary, Qundef until asked for
+  VALUE     cache; // key => value for objectForInfoDictionaryKey
+} bundle_t;
+
 static
-VALUE
-rb_procinfo_cpu_count(VALUE self)
+void
+bundle_mark(void* const data)
 {
-  return INT2FIX([[NSProcessInfo processInfo] processorCount]);
+  bundle_t* const bundle = data;
+  rb_gc_mark(bundle->info);
+  rb_gc_mark(bundle->cache);
 }
 
 static
-VALUE
-rb_procinfo_active_cpus(VALUE self)
+void
+bundle_free(void* const data)
 {
-  return INT2FIX([[NSProcessInfo processInfo] activeProcessorCount]);
+  [((bundle_t*)data)->bundle release];
+  xfree(data);
 }
 
-static
 VALUE
-rb_procinfo_total_ram(VALUE self)
+wrap_bundle(NSBundle* obj)
 {
-  return ULL2NUM([[NSProcessInfo processInfo] physicalMemory]);
+  bundle_t* data;
+  VALUE bundle = Data_Make_Struct(rb_cBundle, bundle_t, bundle_mark, bundle_free, data);
+  data->bundle = obj;
+  data->info   = Qundef;
+  data->cache  = rb_hash_new();
+  return bundle;
 }
 
-
 static
-VALUE
-rb_host_self(VALUE self)
+bundle_t*
+bundle_data(VALUE obj)
 {
-  return self; // hack
+  bundle_t* data;
+  Data_Get_Struct(obj, bundle_t, data);
+  return data;
 }
 
+NSBundle* unwrap_bundle(VALUE obj) { return bundle_data(obj)->bundle; }
+
+static
+int
+bundle_freeze_pair(VALUE key, VALUE value, VALUE ignored);
+
+// freeze a converted plist value, and everything inside of it
 static
 VALUE
-rb_host_names(VALUE self)
+bundle_freeze(VALUE obj)
 {
-  NSArray* nsnames = [[NSHost currentHost] names];
-  VALUE    rbnames = wrap_array_nsstrings(nsnames);
-  [nsnames release];
-  return rbnames;
+  switch (TYPE(obj)) {
+  case T_ARRAY:
+    for (long i = 0; i < RARRAY_LEN(obj); i++)
+      bundle_freeze(rb_ary_entry(obj, i));
+    break;
+  case T_HASH:
+    rb_hash_foreach(obj, bundle_freeze_pair, Qnil);
+    break;
+  }
+  return rb_obj_freeze(obj);
 }
 
 static
-VALUE
-rb_host_addresses(VALUE self)
+int
+bundle_freeze_pair(VALUE key, VALUE value, VALUE ignored)
 {
-  NSArray* nsaddrs = [[NSHost currentHost] addresses];
-  VALUE    rbaddrs = wrap_array_nsstrings(nsaddrs);
-  [nsaddrs release];
-  return rbaddrs;
+  bundle_freeze(value);
+  return ST_CONTINUE;
 }
 
+// convert a +1 plist object to a frozen Ruby object
 static
 VALUE
-rb_host_localized_name(VALUE self)
+bundle_wrap_value(id const obj)
 {
-  NSString* name = [[NSHost currentHost] localizedName];
-  VALUE  rb_name = wrap_nsstring(name);
-  [name release];
-  return rb_name;
-}
-
+  if (!obj)
+    return Qnil;
 
-VALUE wrap_bundle(NSBundle* obj) { WRAP_OBJC(rb_cBundle, objc_finalizer); }
-NSBundle* unwrap_bundle(VALUE obj) { UNWRAP_OBJC(NSBundle); }
+  VALUE value = to_ruby(obj);
+  if (TYPE(value) != T_DATA)
+    [obj release];
+  return bundle_freeze(value);
+}
 
 static
 VALUE
@@ -407,35 +2151,236 @@ rb_bundle_with_url(VALUE self, VALUE url)
   NSURL*     nsurl = unwrap_nsurl(url);
   NSBundle* bundle = [NSBundle bundleWithURL:nsurl];
   VALUE  rb_bundle = Qnil;
+  [nsurl release];
 
   if (bundle)
-    rb_bundle = wrap_bundle(bundle);
+    rb_bundle = wrap_bundle([bundle retain]);
 
   return rb_bundle;
 }
 
+/*
+ * Returns the bundle's Info.plist, as a frozen hash
+ *
+ * The dictionary is only converted the first time it is asked for.
+ *
+ * @return [Hash,nil]
+ */
 static
 VALUE
 rb_bundle_info_dict(VALUE self)
 {
-  NSDictionary* dict = [unwrap_bundle(self) infoDictionary];
-  VALUE         hash = Qnil;
-  if (dict)
-    hash = wrap_dictionary(dict);
-  return hash;
+  bundle_t* const data = bundle_data(self);
+  if (data->info == Qundef) {
+    NSDictionary* const dict = [data->bundle infoDictionary];
+    data->info = (dict ? bundle_freeze(wrap_dictionary(dict)) : Qnil);
+  }
+  return data->info;
 }
 
+/*
+ * Returns the (localized) value for a key in the bundle's Info.plist
+ *
+ * Values are looked up once per key and then cached, frozen.
+ *
+ * @param key [String]
+ * @return [Object,nil]
+ */
 static
 VALUE
 rb_bundle_object_for_info_dict_key(VALUE self, VALUE key)
 {
-  NSString* nskey = unwrap_nsstring(key);
-  id obj = [unwrap_bundle(self) objectForInfoDictionaryKey:nskey];
-  if (obj)
-    return to_ruby(obj);
+  bundle_t* const data = bundle_data(self);
+  VALUE          value = rb_hash_lookup2(data->cache, key, Qundef);
+  if (value != Qundef)
+    return value;
+
+  NSString* const nskey = unwrap_nsstring(key);
+  id const          obj = [data->bundle objectForInfoDictionaryKey:nskey];
+  [nskey release];
+
+  value = bundle_wrap_value([obj retain]);
+  rb_hash_aset(data->cache, key, value);
+  return value;
+}
+
+typedef struct {
+  NSURL**   urls;   // NULL for URLs that could not be made
+  long      url_count;
+  NSString** keys;
+  long      key_count;
+  id*       values; // url_count * key_count, +1 each, nil if missing
+  char*     found;  // whether there was a bundle at each URL
+  VALUE     rb_urls;
+  VALUE     rb_keys;
+  int       parallel;
+  volatile int interrupted;
+} bundle_info_t;
+
+static
+void
+bundle_info_collect_one(bundle_info_t* const info, const size_t index)
+{
+  if (info->interrupted)
+    return;
+
+  @autoreleasepool {
+    NSBundle* const bundle =
+      (info->urls[index] ? [NSBundle bundleWithURL:info->urls[index]] : nil);
+    if (!bundle)
+      return;
+
+    info->found[index] = 1;
+    for (long k = 0; k < info->key_count; k++)
+      info->values[index * info->key_count + k] =
+	[[bundle objectForInfoDictionaryKey:info->keys[k]] retain];
+  }
+}
+
+static
+void*
+bundle_info_collect(void* const data)
+{
+  bundle_info_t* const info = data;
+  for (long i = 0; i < info->url_count; i++)
+    bundle_info_collect_one(info, i);
+  return NULL;
+}
+
+static
+void*
+bundle_info_collect_parallel(void* const data)
+{
+  bundle_info_t* const info = data;
+  dispatch_apply(info->url_count,
+		 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+		 ^(size_t i) { bundle_info_collect_one(info, i); });
+  return NULL;
+}
+
+static
+void
+bundle_info_interrupt(void* const data)
+{
+  ((bundle_info_t*)data)->interrupted = 1;
+}
+
+static
+VALUE
+bundle_info_run(VALUE data)
+{
+  bundle_info_t* const info = (bundle_info_t*)data;
+
+  for (long i = 0; i < info->url_count; i++)
+    info->urls[i] = unwrap_nsurl(rb_ary_entry(info->rb_urls, i));
+  for (long k = 0; k < info->key_count; k++)
+    info->keys[k] = unwrap_nsstring(rb_ary_entry(info->rb_keys, k));
+
+  rb_thread_call_without_gvl(info->parallel ? bundle_info_collect_parallel : bundle_info_collect,
+			     info, bundle_info_interrupt, info);
+  // an interrupt leaves the results partial; raise it before using them
+  rb_thread_check_ints();
+
+  VALUE results = rb_ary_new2(info->url_count);
+  for (long i = 0; i < info->url_count; i++) {
+    if (!info->found[i]) {
+      rb_ary_push(results, Qnil);
+      continue;
+    }
+
+    VALUE hash = rb_hash_new();
+    for (long k = 0; k < info->key_count; k++) {
+      id* const value = &info->values[i * info->key_count + k];
+      VALUE       obj = bundle_wrap_value(*value);
+      *value = nil; // now owned by obj, or already released
+      rb_hash_aset(hash, rb_ary_entry(info->rb_keys, k), obj);
+    }
+    rb_ary_push(results, rb_obj_freeze(hash));
+  }
+
+  return results;
+}
+
+// release whatever bundle_info_run did not get to hand over, even if it
+// raised partway through unwrapping or wrapping
+static
+VALUE
+bundle_info_release(VALUE data)
+{
+  bundle_info_t* const info = (bundle_info_t*)data;
+
+  for (long i = 0; i < info->url_count; i++)
+    [info->urls[i] release];
+  for (long k = 0; k < info->key_count; k++)
+    [info->keys[k] release];
+  for (long v = 0; v < info->url_count * info->key_count; v++)
+    [info->values[v] release];
   return Qnil;
 }
 
+/*
+ * Read the same Info.plist keys from many bundles at once
+ *
+ * Bundles are looked up and read without holding the GVL, and with
+ * `parallel: true` the bundles are read concurrently. The result has
+ * a hash of key => value (frozen, `nil` when missing) for each URL, or
+ * `nil` if there is no bundle at that URL. Values are the same as what
+ * {#objectForInfoDictionaryKey} returns.
+ *
+ * @example
+ *
+ *   NSBundle.info_for apps, ['CFBundleName', 'CFBundleVersion'], parallel: true
+ *     # => [{ 'CFBundleName' => 'Safari', 'CFBundleVersion' => '...' }, nil, ...]
+ *
+ * @param urls [Array<URI,Accessibility::URL>]
+ * @param keys [Array<String>]
+ * @param opts [Hash] accepts `:parallel`
+ * @return [Array<Hash,nil>]
+ */
+static
+VALUE
+rb_bundle_info_for(int argc, VALUE* argv, VALUE self)
+{
+  if (argc < 2)
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 2..3)", argc);
+
+  VALUE      urls = rb_ary_dup(rb_Array(argv[0]));
+  VALUE      keys = rb_ary_dup(rb_Array(argv[1]));
+  VALUE  parallel = (argc > 2 ? rb_hash_lookup(argv[2], key_parallel) : Qnil);
+  for (long k = 0; k < RARRAY_LEN(keys); k++) {
+    VALUE key = rb_ary_entry(keys, k);
+    rb_ary_store(keys, k, rb_str_new_frozen(StringValue(key)));
+  }
+
+  bundle_info_t info;
+  info.url_count   = RARRAY_LEN(urls);
+  info.key_count   = RARRAY_LEN(keys);
+  info.rb_urls     = urls;
+  info.rb_keys     = keys;
+  info.parallel    = RTEST(parallel);
+  info.interrupted = 0;
+
+  // scratch space is owned by the GC in case anything below raises
+  VALUE url_buffer, key_buffer, value_buffer, found_buffer;
+  info.urls   = ALLOCV_N(NSURL*,    url_buffer,   info.url_count);
+  info.keys   = ALLOCV_N(NSString*, key_buffer,   info.key_count);
+  info.values = ALLOCV_N(id,        value_buffer, info.url_count * info.key_count);
+  info.found  = ALLOCV_N(char,      found_buffer, info.url_count);
+  memset(info.urls,   0, sizeof(NSURL*)    * info.url_count);
+  memset(info.keys,   0, sizeof(NSString*) * info.key_count);
+  memset(info.values, 0, sizeof(id) * info.url_count * info.key_count);
+  memset(info.found,  0, info.url_count);
+
+  VALUE results = rb_ensure(bundle_info_run,     (VALUE)&info,
+			    bundle_info_release, (VALUE)&info);
+
+  ALLOCV_END(url_buffer);
+  ALLOCV_END(key_buffer);
+  ALLOCV_END(value_buffer);
+  ALLOCV_END(found_buffer);
+  return results;
+}
+
 
 static
 VALUE
@@ -555,62 +2500,35 @@ battery_info()
   return NULL;
 }
 
-/*
- * Returns the current battery state
- *
- * The state will be one of:
- *
- *  - `:not_installed`
- *  - `:charged`
- *  - `:charging`
- *  - `:discharging`
- *
- * @return [Symbol]
- */
+// The helpers below read one field from the dictionary returned by
+// battery_info(), which may be NULL when there is no battery
+
 static
 VALUE
-rb_battery_state(VALUE self)
+battery_state_from(CFDictionaryRef const info)
 {
   // constant global strings (like ruby symbols, or lisp atoms, NXAtom, etc)
   // so we do not need to release it later (unless you really want to)
   CFStringRef charged_key  = CFSTR(kIOPSIsChargedKey);
   CFStringRef charging_key = CFSTR(kIOPSIsChargingKey);
 
-  VALUE              state = battery_not_installed;
-  CFDictionaryRef     info = battery_info();
-
-  if (info) {
-    if (CFDictionaryGetValue(info, charged_key) == kCFBooleanTrue)
-      state = battery_charged;
-    else if (CFDictionaryGetValue(info, charging_key) == kCFBooleanTrue)
-      state = battery_charging;
-    else
-      state = battery_discharging;
-
-    CFRelease(info);
-  }
-
-  return state;
+  if (!info)
+    return battery_not_installed;
+  if (CFDictionaryGetValue(info, charged_key) == kCFBooleanTrue)
+    return battery_charged;
+  if (CFDictionaryGetValue(info, charging_key) == kCFBooleanTrue)
+    return battery_charging;
+  return battery_discharging;
 }
 
-/*
- * Returns the batteries charge level as a percentage from 0 to 1
- *
- * A special value of `-1.0` is returned when there is no battery present.
- *
- * @return [Float]
- */
 static
 VALUE
-rb_battery_level(VALUE self)
+battery_level_from(CFDictionaryRef const info)
 {
-  // constant global strings (like ruby symbols, or lisp atoms, NXAtom, etc)
-  // so we do not need to release it later (unless you really want to)
   CFStringRef capacity_key     = CFSTR(kIOPSCurrentCapacityKey);
   CFStringRef max_capacity_key = CFSTR(kIOPSMaxCapacityKey);
 
-  double         level = -1.0;
-  CFDictionaryRef info = battery_info();
+  double level = -1.0;
 
   if (info) {
     CFNumberRef current_cap = CFDictionaryGetValue(info, capacity_key);
@@ -625,13 +2543,91 @@ rb_battery_level(VALUE self)
 
       level = ((double)current)/((double)max);
     }
-
-    CFRelease(info);
   }
 
   return DBL2NUM(level);
 }
 
+static
+VALUE
+battery_time_to_empty_from(CFDictionaryRef const info)
+{
+  CFStringRef ttempty_key = CFSTR(kIOPSTimeToEmptyKey);
+  int                time = -1;
+
+  if (info) {
+    CFNumberRef current_time = CFDictionaryGetValue(info, ttempty_key);
+    if (current_time)
+      CFNumberGetValue(current_time, kCFNumberIntType, &time);
+  }
+
+  if (time)
+    return INT2FIX(time);
+  else
+    return INT2FIX(0);
+}
+
+static
+VALUE
+battery_time_to_full_from(CFDictionaryRef const info)
+{
+  CFStringRef ttfull_key = CFSTR(kIOPSTimeToFullChargeKey);
+  int               time = -1;
+
+  if (info) {
+    CFNumberRef current_time = CFDictionaryGetValue(info, ttfull_key);
+    if (current_time)
+      CFNumberGetValue(current_time, kCFNumberIntType, &time);
+  }
+
+  return INT2FIX(time);
+}
+
+// Copy the battery info once and hand it to one of the helpers above
+static
+VALUE
+battery_read(VALUE (*reader)(CFDictionaryRef const info))
+{
+  CFDictionaryRef const info = battery_info();
+  const VALUE          value = reader(info);
+  if (info)
+    CFRelease(info);
+  return value;
+}
+
+/*
+ * Returns the current battery state
+ *
+ * The state will be one of:
+ *
+ *  - `:not_installed`
+ *  - `:charged`
+ *  - `:charging`
+ *  - `:discharging`
+ *
+ * @return [Symbol]
+ */
+static
+VALUE
+rb_battery_state(VALUE self)
+{
+  return battery_read(battery_state_from);
+}
+
+/*
+ * Returns the batteries charge level as a percentage from 0 to 1
+ *
+ * A special value of `-1.0` is returned when there is no battery present.
+ *
+ * @return [Float]
+ */
+static
+VALUE
+rb_battery_level(VALUE self)
+{
+  return battery_read(battery_level_from);
+}
+
 
 /*
  * Returns the estimated number of minutes until the battery is fully discharged
@@ -649,22 +2645,7 @@ static
 VALUE
 rb_battery_time_to_empty(VALUE self)
 {
-  CFStringRef ttempty_key = CFSTR(kIOPSTimeToEmptyKey);
-  int                time = -1;
-  CFDictionaryRef    info = battery_info();
-
-  if (info) {
-    CFNumberRef current_time = CFDictionaryGetValue(info, ttempty_key);
-    if (current_time)
-      CFNumberGetValue(current_time, kCFNumberIntType, &time);
-
-    CFRelease(info);
-  }
-
-  if (time)
-    return INT2FIX(time);
-  else
-    return INT2FIX(0);
+  return battery_read(battery_time_to_empty_from);
 }
 
 
@@ -680,19 +2661,38 @@ static
 VALUE
 rb_battery_time_full_charge(VALUE self)
 {
-  CFStringRef ttfull_key = CFSTR(kIOPSTimeToFullChargeKey);
-  int                time = -1;
-  CFDictionaryRef    info = battery_info();
+  return battery_read(battery_time_to_full_from);
+}
 
-  if (info) {
-    CFNumberRef current_time = CFDictionaryGetValue(info, ttfull_key);
-    if (current_time)
-      CFNumberGetValue(current_time, kCFNumberIntType, &time);
+/*
+ * Returns all of the battery information at once
+ *
+ * This is the same as calling {state}, {level}, {time_to_empty}, and
+ * {time_to_full_charge}, except that the power source information is
+ * only copied once and all the values come from the same reading.
+ *
+ * @example
+ *
+ *   Battery.snapshot
+ *     # => { state: :discharging, level: 0.87, time_to_empty: 212, time_to_full_charge: -1 }
+ *
+ * @return [Hash{Symbol=>Object}]
+ */
+static
+VALUE
+rb_battery_snapshot(VALUE self)
+{
+  CFDictionaryRef const info = battery_info();
+  const VALUE       snapshot = rb_hash_new();
 
-    CFRelease(info);
-  }
+  rb_hash_aset(snapshot, battery_key_state,    battery_state_from(info));
+  rb_hash_aset(snapshot, battery_key_level,    battery_level_from(info));
+  rb_hash_aset(snapshot, battery_key_to_empty, battery_time_to_empty_from(info));
+  rb_hash_aset(snapshot, battery_key_to_full,  battery_time_to_full_from(info));
 
-  return INT2FIX(time);
+  if (info)
+    CFRelease(info);
+  return snapshot;
 }
 
 
@@ -774,8 +2774,28 @@ Init_extras()
   rb_define_singleton_method(rb_cWorkspace, "menuBarOwningApplication",        rb_workspace_menu_bar_owner, 0);
   rb_define_singleton_method(rb_cWorkspace, "showSearchResultsForQueryString", rb_workspace_find,           1);
   rb_define_singleton_method(rb_cWorkspace, "launchAppWithBundleIdentifier",   rb_workspace_launch,         2);
+  rb_define_singleton_method(rb_cWorkspace, "launch_and_wait",                 rb_workspace_launch_and_wait, -1);
+  rb_define_singleton_method(rb_cWorkspace, "launch_all",                      rb_workspace_launch_all,      -1);
 
   key_opts         = ID2SYM(rb_intern("options"));
+  key_until        = ID2SYM(rb_intern("until"));
+  key_timeout      = ID2SYM(rb_intern("timeout"));
+  key_launcher     = ID2SYM(rb_intern("launcher"));
+  key_pid          = ID2SYM(rb_intern("pid"));
+  key_phases       = ID2SYM(rb_intern("phases"));
+  key_concurrency  = ID2SYM(rb_intern("concurrency"));
+  key_bundle_id    = ID2SYM(rb_intern("bundle_id"));
+  key_error        = ID2SYM(rb_intern("error"));
+
+  sel_launch       = rb_intern("launch");
+  sel_pid_for      = rb_intern("pid_for");
+  sel_reached      = rb_intern("reached?");
+
+  launch_phases[LAUNCH_PHASE_REQUESTED]  = ID2SYM(rb_intern("requested"));
+  launch_phases[LAUNCH_PHASE_PID]        = ID2SYM(rb_intern("pid"));
+  launch_phases[LAUNCH_PHASE_LAUNCHED]   = ID2SYM(rb_intern("launched"));
+  launch_phases[LAUNCH_PHASE_RESPONSIVE] = ID2SYM(rb_intern("responsive"));
+  launch_phases[LAUNCH_PHASE_WINDOW]     = ID2SYM(rb_intern("window"));
   //  key_event_params = ID2SYM(rb_intern("additionalEventParamDescriptor"));
   //  key_launch_id    = ID2SYM(rb_intern("launchIdentifier"));
 
@@ -798,6 +2818,56 @@ Init_extras()
   }
 
 
+  /*
+   * Document-class: Accessibility::AppRegistry
+   *
+   * Keeps a table of running applications, indexed by pid, that is
+   * updated incrementally so that launches and terminations can be
+   * noticed cheaply by polling.
+   *
+   * @example
+   *
+   *   registry = Accessibility::AppRegistry.new
+   *   registry.poll # => [[all, running, apps], []]
+   *   registry.poll # => [[], []]
+   */
+  rb_cAppRegistry = rb_define_class_under(rb_mAccessibility, "AppRegistry", rb_cObject);
+
+  rb_define_method(rb_cAppRegistry, "initialize",             rb_registry_init,          -1);
+  rb_define_method(rb_cAppRegistry, "poll",                   rb_registry_poll,           0);
+  rb_define_method(rb_cAppRegistry, "apps",                   rb_registry_apps,           0);
+  rb_define_method(rb_cAppRegistry, "[]",                     rb_registry_lookup,         1);
+  rb_define_method(rb_cAppRegistry, "size",                   rb_registry_size,           0);
+  rb_define_method(rb_cAppRegistry, "with_bundle_identifier", rb_registry_with_bundle_id, 1);
+  rb_define_method(rb_cAppRegistry, "named",                  rb_registry_named,          1);
+  rb_define_method(rb_cAppRegistry, "matching",               rb_registry_matching,       1);
+  rb_define_method(rb_cAppRegistry, "matching_name",          rb_registry_matching_name,  1);
+
+  ivar_source            = rb_intern("@source");
+  ivar_apps              = rb_intern("@apps");
+  sel_call               = rb_intern("call");
+  sel_process_identifier = rb_intern("processIdentifier");
+  sel_launch_date        = rb_intern("launchDate");
+  sel_bundle_identifier  = rb_intern("bundleIdentifier");
+  sel_localized_name     = rb_intern("localizedName");
+  ivar_by_bundle_id      = rb_intern("@by_bundle_id");
+  ivar_by_name           = rb_intern("@by_name");
+
+  shared_registry = rb_class_new_instance(0, NULL, rb_cAppRegistry);
+  rb_gc_register_address(&shared_registry);
+
+  NSNotificationCenter* const center = [[NSWorkspace sharedWorkspace] notificationCenter];
+  NSString* const names[] = {
+    NSWorkspaceDidLaunchApplicationNotification,
+    NSWorkspaceDidTerminateApplicationNotification
+  };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    [center addObserverForName:names[i]
+			object:nil
+			 queue:nil
+		    usingBlock:^(NSNotification* note) { shared_registry_stale = 1; }];
+
+
   /*
    * Document-class: NSProcessInfo
    *
@@ -816,6 +2886,25 @@ Init_extras()
   rb_define_singleton_method(rb_cProcInfo, "activeProcessorCount",         rb_procinfo_active_cpus, 0);
   rb_define_singleton_method(rb_cProcInfo, "physicalMemory",               rb_procinfo_total_ram,   0);
 
+  rb_define_singleton_method(rb_cProcInfo, "start_sampling",               rb_procinfo_start_sampling, -1);
+  rb_define_singleton_method(rb_cProcInfo, "stop_sampling",                rb_procinfo_stop_sampling,   0);
+  rb_define_singleton_method(rb_cProcInfo, "sampling?",                    rb_procinfo_is_sampling,     0);
+  rb_define_singleton_method(rb_cProcInfo, "sample_now",                   rb_procinfo_sample_now,      0);
+  rb_define_singleton_method(rb_cProcInfo, "record_sample",                rb_procinfo_record_sample,   1);
+  rb_define_singleton_method(rb_cProcInfo, "samples",                      rb_procinfo_samples,        -1);
+  rb_define_singleton_method(rb_cProcInfo, "clear_samples",                rb_procinfo_clear_samples,   0);
+
+  key_time         = ID2SYM(rb_intern("time"));
+  key_uptime       = ID2SYM(rb_intern("uptime"));
+  key_load         = ID2SYM(rb_intern("load"));
+  key_memory       = ID2SYM(rb_intern("memory"));
+  key_free_memory  = ID2SYM(rb_intern("free_memory"));
+  key_cpus         = ID2SYM(rb_intern("cpus"));
+  key_active_cpus  = ID2SYM(rb_intern("active_cpus"));
+  key_since        = ID2SYM(rb_intern("since"));
+  key_interval     = ID2SYM(rb_intern("interval"));
+  key_capacity     = ID2SYM(rb_intern("capacity"));
+
 
   /*
    * Document-class: NSHost
@@ -832,6 +2921,24 @@ Init_extras()
   rb_define_singleton_method(rb_cHost, "names",         rb_host_names,          0);
   rb_define_singleton_method(rb_cHost, "addresses",     rb_host_addresses,      0);
   rb_define_singleton_method(rb_cHost, "localizedName", rb_host_localized_name, 0);
+  rb_define_singleton_method(rb_cHost, "refresh",       rb_host_refresh,        0);
+  rb_define_singleton_method(rb_cHost, "resolved?",     rb_host_is_resolved,    0);
+  rb_define_singleton_method(rb_cHost, "resolver",      rb_host_resolver,       0);
+  rb_define_singleton_method(rb_cHost, "resolver=",     rb_host_set_resolver,   1);
+
+  sel_names               = rb_intern("names");
+  sel_addresses           = rb_intern("addresses");
+  sel_join                = rb_intern("join");
+
+  rb_gc_register_address(&host_names);
+  rb_gc_register_address(&host_addresses);
+  rb_gc_register_address(&host_localized_name);
+  rb_gc_register_address(&host_resolver);
+  rb_gc_register_address(&host_thread);
+
+  host_queue = dispatch_queue_create("org.axelements.accessibility.host", DISPATCH_QUEUE_SERIAL);
+  host_group = dispatch_group_create();
+  host_resolve_native();
 
 
   /*
@@ -847,6 +2954,9 @@ Init_extras()
   rb_define_singleton_method(rb_cBundle, "bundleWithURL", rb_bundle_with_url, 1);
   rb_define_method(rb_cBundle, "infoDictionary",             rb_bundle_info_dict,                0);
   rb_define_method(rb_cBundle, "objectForInfoDictionaryKey", rb_bundle_object_for_info_dict_key, 1);
+  rb_define_singleton_method(rb_cBundle, "info_for",      rb_bundle_info_for, -1);
+
+  key_parallel = ID2SYM(rb_intern("parallel"));
 
   rb_define_method(rb_cObject, "load_plist", rb_load_plist, 1);
 
@@ -881,10 +2991,16 @@ Init_extras()
   battery_charging      = ID2SYM(rb_intern("charging"));
   battery_discharging   = ID2SYM(rb_intern("discharging"));
 
+  battery_key_state     = ID2SYM(rb_intern("state"));
+  battery_key_level     = ID2SYM(rb_intern("level"));
+  battery_key_to_empty  = ID2SYM(rb_intern("time_to_empty"));
+  battery_key_to_full   = ID2SYM(rb_intern("time_to_full_charge"));
+
   rb_define_method(rb_mBattery, "state",     rb_battery_state, 0);
   rb_define_method(rb_mBattery, "level",     rb_battery_level, 0);
   rb_define_method(rb_mBattery, "time_to_discharged", rb_battery_time_to_empty, 0);
   rb_define_method(rb_mBattery, "time_to_charged", rb_battery_time_full_charge, 0);
+  rb_define_method(rb_mBattery, "snapshot",  rb_battery_snapshot, 0);
 
   rb_define_alias(rb_mBattery, "charge_level", "level");
   rb_define_alias(rb_mBattery, "time_to_empty", "time_to_discharged");
@@ -0,0 +1,86 @@
+#include "batch_layout.h"
+
+#include <stdlib.h>
+
+static
+int
+grow(void** const buffer, size_t* const capacity,
+     const size_t needed, const size_t size)
+{
+  if (needed <= *capacity)
+    return 0;
+
+  size_t wanted = (*capacity ? *capacity : 16);
+  while (wanted < needed)
+    wanted *= 2;
+  void* const grown = realloc(*buffer, wanted * size);
+  if (!grown)
+    return -1;
+  *buffer   = grown;
+  *capacity = wanted;
+  return 0;
+}
+
+int
+hl_layout_reserve(hl_layout_t* const layout, const size_t more)
+{
+  void* items = layout->items;
+  const int result = grow(&items, &layout->capacity,
+			  layout->count + more, sizeof(hl_item_t));
+  layout->items = items;
+  return result;
+}
+
+long
+hl_layout_push(hl_layout_t* const layout, const hl_rect_t rect, void* const color)
+{
+  hl_item_t* const item = &layout->items[layout->count++];
+  item->id    = layout->next_id++;
+  item->rect  = rect;
+  item->color = color;
+  return item->id;
+}
+
+hl_rect_t
+hl_layout_place(const hl_layout_t* const layout, const hl_item_t* const item)
+{
+  hl_rect_t rect = item->rect;
+  rect.y  = layout->screen_height - (rect.y + rect.height);
+  rect.x -= layout->frame.x;
+  rect.y -= layout->frame.y;
+  return rect;
+}
+
+int
+hl_layout_record(hl_layout_t* const layout)
+{
+  // forget the old fills first, their colours may be gone
+  layout->fill_count = 0;
+
+  void* fills = layout->fills;
+  const int result = grow(&fills, &layout->fill_capacity,
+			  layout->count, sizeof(hl_fill_t));
+  layout->fills = fills;
+  if (result)
+    return result;
+
+  for (size_t i = 0; i < layout->count; i++) {
+    layout->fills[i].rect  = hl_layout_place(layout, &layout->items[i]);
+    layout->fills[i].color = layout->items[i].color;
+  }
+  layout->fill_count = layout->count;
+  return 0;
+}
+
+void
+hl_layout_free(hl_layout_t* const layout)
+{
+  free(layout->items);
+  free(layout->fills);
+  layout->items         = NULL;
+  layout->fills         = NULL;
+  layout->count         = 0;
+  layout->capacity      = 0;
+  layout->fill_count    = 0;
+  layout->fill_capacity = 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * The highlights of a batch and where they land in its overlay.
+ *
+ * Highlights are given in screen coordinates, with the origin at the
+ * top left of the main screen. The overlay covers all the screens and
+ * is drawn in Cocoa coordinates, with the origin at the bottom left of
+ * the main screen and y going up, so each rect is flipped and then made
+ * relative to the overlay. A headless batch records the fills that a
+ * redraw would have drawn instead of drawing them.
+ *
+ * Colours are not looked at here; they belong to the caller.
+ *
+ * This file does not depend on Cocoa or Ruby.
+ */
+
+typedef struct {
+  double x;
+  double y;
+  double width;
+  double height;
+} hl_rect_t;
+
+typedef struct {
+  long      id;
+  hl_rect_t rect;   // in screen coordinates, origin at the top left
+  void*     color;
+} hl_item_t;
+
+typedef struct {
+  hl_rect_t rect;   // in the overlay's own (unflipped) coordinates
+  void*     color;
+} hl_fill_t;
+
+typedef struct {
+  hl_item_t* items;
+  size_t     count;
+  size_t     capacity;
+  long       next_id;
+  hl_rect_t  frame;          // of the overlay, in Cocoa coordinates
+  double     screen_height;  // of the main screen, for flipping
+  hl_fill_t* fills;          // from the last recorded redraw
+  size_t     fill_count;
+  size_t     fill_capacity;
+} hl_layout_t;
+
+// Make room for `more` items; returns non-zero if out of memory
+int hl_layout_reserve(hl_layout_t* layout, size_t more);
+
+// Add an item, which must have room reserved; returns its id
+long hl_layout_push(hl_layout_t* layout, hl_rect_t rect, void* color);
+
+// Where an item goes in the overlay
+hl_rect_t hl_layout_place(const hl_layout_t* layout, const hl_item_t* item);
+
+// Record a fill for every item, in order; returns non-zero if out of memory
+int hl_layout_record(hl_layout_t* layout);
+
+void hl_layout_free(hl_layout_t* layout);
@@ -1,35 +1,30 @@
 #include "ruby.h"
 #import <Cocoa/Cocoa.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
 #include "../bridge/bridge.h"
 #include "../extras/extras.h"
+#include "batch_layout.h"
 
 
 static VALUE rb_cHighlighter;
+static VALUE rb_cBatch;
 static VALUE rb_cColor;
 
-static ID ivar_color;
-
 static VALUE color_key;
 static VALUE colour_key;
 static VALUE timeout_key;
+static VALUE headless_key;
+static VALUE limit_key;
+static VALUE idle_key;
+static VALUE in_use_key;
+static VALUE created_key;
+static VALUE reused_key;
+static VALUE released_key;
+static VALUE fill_sym;
 
 
-static
-VALUE
-wrap_window(NSWindow* window)
-{
-  return Data_Wrap_Struct(rb_cHighlighter, NULL, objc_finalizer, (void*)window);
-}
-
-static
-NSWindow*
-unwrap_window(VALUE window)
-{
-  NSWindow* nswindow;
-  Data_Get_Struct(window, NSWindow, nswindow);
-  return nswindow;
-}
-
 static
 VALUE
 wrap_color(NSColor* color)
@@ -56,6 +51,490 @@ flip(CGRect rect)
     return rect;
 }
 
+/*
+ * Highlighter windows are pooled. Stopping a highlighter, or letting it
+ * time out, hides its window and keeps it for the next highlighter,
+ * which moves and recolours the window instead of making a new one. At
+ * most `limit` idle windows are kept; the rest are closed and released,
+ * as are all the idle windows when {Highlighter.drain} is called. A
+ * highlighter that is garbage collected while showing (and without a
+ * timeout) is handed back by the main queue, never by the GC itself.
+ *
+ * Each window lives in a surface whose generation goes up whenever it
+ * is handed back, so a stopped highlighter or an old timer can tell
+ * that the surface has moved on to someone else. Surfaces are never
+ * freed (only their windows are) so those old pointers stay safe.
+ *
+ * A headless surface has no window and only remembers whether it is
+ * showing, so the pool can be exercised without a window server.
+ */
+
+#define HIGHLIGHT_ALPHA 0.20
+#define HL_POOL_LIMIT   16
+
+typedef struct hl_surface {
+  NSWindow*          window;    // nil when headless, or not made yet
+  bool               headless;
+  bool               showing;   // only kept for headless surfaces
+  unsigned long      generation;
+  struct hl_surface* next;      // in the idle or spare list
+} hl_surface_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  hl_surface_t*   idle;     // hidden and ready to show again
+  hl_surface_t*   spare;    // without a window
+  size_t          idle_count;
+  size_t          limit;
+  size_t          in_use;
+  size_t          created;
+  size_t          reused;
+  size_t          released; // windows closed for good
+  hl_surface_t*   orphans;  // collected while showing, for the main thread
+  bool            orphans_queued;
+} hl_pool_t;
+
+static hl_pool_t pool = { .lock = PTHREAD_MUTEX_INITIALIZER, .limit = HL_POOL_LIMIT };
+
+typedef struct {
+  hl_surface_t* surface;
+  unsigned long generation;
+  NSColor*      color;
+  CGRect        frame;      // in Cocoa coordinates
+  bool          timed;      // the timer wheel hands the surface back
+} hl_highlight_t;
+
+// Take idle surfaces out of the pool until `keep` are left; call with the lock held
+static
+void
+hl_pool_trim(const size_t keep)
+{
+  while (pool.idle_count > keep) {
+    hl_surface_t* const surface = pool.idle;
+    pool.idle = surface->next;
+    pool.idle_count--;
+
+    if (surface->window) {
+      [surface->window close];
+      [surface->window release];
+      surface->window = nil;
+      pool.released++;
+    }
+    surface->next = pool.spare;
+    pool.spare    = surface;
+  }
+}
+
+static
+hl_surface_t*
+hl_pool_acquire(const bool headless)
+{
+  pthread_mutex_lock(&pool.lock);
+  hl_surface_t* surface = NULL;
+  for (hl_surface_t** link = &pool.idle; *link; link = &(*link)->next) {
+    if ((*link)->headless == headless) {
+      surface = *link;
+      *link   = surface->next;
+      pool.idle_count--;
+      break;
+    }
+  }
+  if (surface) {
+    pool.reused++;
+  }
+  else {
+    pool.created++;
+    if (pool.spare) {
+      surface    = pool.spare;
+      pool.spare = surface->next;
+    }
+  }
+  pool.in_use++;
+  pthread_mutex_unlock(&pool.lock);
+
+  if (!surface) {
+    surface = malloc(sizeof(hl_surface_t));
+    if (!surface) {
+      pthread_mutex_lock(&pool.lock);
+      pool.created--;
+      pool.in_use--;
+      pthread_mutex_unlock(&pool.lock);
+      rb_raise(rb_eNoMemError, "could not allocate a highlighter");
+    }
+    surface->window     = nil;
+    surface->showing    = false;
+    surface->generation = 0;
+  }
+  surface->headless = headless;
+  surface->next     = NULL;
+  return surface;
+}
+
+// Hand a surface back, unless it has already gone back since `generation`
+static
+bool
+hl_pool_release(hl_surface_t* const surface, const unsigned long generation)
+{
+  pthread_mutex_lock(&pool.lock);
+  if (surface->generation != generation) {
+    pthread_mutex_unlock(&pool.lock);
+    return false;
+  }
+  surface->generation++;
+  surface->showing = false;
+  [surface->window orderOut:nil];
+  pool.in_use--;
+
+  surface->next = pool.idle;
+  pool.idle     = surface;
+  pool.idle_count++;
+  hl_pool_trim(pool.limit);
+  pthread_mutex_unlock(&pool.lock);
+  return true;
+}
+
+// Hand back surfaces whose highlighters were collected; only call on the main thread
+static
+void
+hl_pool_release_orphans()
+{
+  pthread_mutex_lock(&pool.lock);
+  hl_surface_t* surface = pool.orphans;
+  pool.orphans          = NULL;
+  pool.orphans_queued   = false;
+  pthread_mutex_unlock(&pool.lock);
+
+  while (surface) {
+    hl_surface_t* const next = surface->next;
+    hl_pool_release(surface, surface->generation);
+    surface = next;
+  }
+}
+
+/*
+ * Queue a surface to be handed back on the main thread
+ *
+ * This is for the GC, which can run on any thread and must not hide or
+ * close windows, so it only links the surface onto a list (its `next`
+ * is free while it is in use) and queues one block to drain it.
+ */
+static
+void
+hl_pool_orphan(hl_surface_t* const surface, const unsigned long generation)
+{
+  pthread_mutex_lock(&pool.lock);
+  const bool current = (surface->generation == generation);
+  if (current) {
+    surface->next = pool.orphans;
+    pool.orphans  = surface;
+  }
+  const bool queue_release = (current && !pool.orphans_queued);
+  if (queue_release)
+    pool.orphans_queued = true;
+  pthread_mutex_unlock(&pool.lock);
+
+  if (queue_release)
+    dispatch_async(dispatch_get_main_queue(), ^(void) { hl_pool_release_orphans(); });
+}
+
+// Move, recolour and show a surface that was just acquired
+static
+void
+hl_surface_show(hl_surface_t* const surface, const CGRect frame, NSColor* const color)
+{
+  if (surface->headless) {
+    surface->showing = true;
+    return;
+  }
+
+  NSWindow* window = surface->window;
+  if (!window) {
+    window = [[NSWindow alloc] initWithContentRect:NSRectFromCGRect(frame)
+					 styleMask:NSWindowStyleMaskBorderless
+					   backing:NSBackingStoreBuffered
+					     defer:true];
+    [window setOpaque:false];
+    [window setLevel:NSStatusWindowLevel];
+    [window setIgnoresMouseEvents:true];
+    [window setReleasedWhenClosed:false];
+    surface->window = window;
+  }
+
+  [window setAlphaValue:HIGHLIGHT_ALPHA];
+  [window setBackgroundColor:color];
+  [window setFrame:NSRectFromCGRect(frame) display:false];
+  [window makeKeyAndOrderFront:NSApp];
+}
+
+static
+bool
+hl_highlight_is_current(const hl_highlight_t* const highlight)
+{
+  pthread_mutex_lock(&pool.lock);
+  const bool current = (highlight->surface->generation == highlight->generation);
+  pthread_mutex_unlock(&pool.lock);
+  return current;
+}
+
+
+/*
+ * Timeouts for all highlighters share one timer wheel: a ring of
+ * millisecond slots, where a timer goes in the slot for its deadline.
+ * A one-shot dispatch timer on a private queue is armed for the
+ * earliest deadline, expires every slot it has passed when it fires,
+ * and is armed again for the next one. Timers more than a lap away
+ * stay in their slot until their deadline comes round, so with only
+ * those pending the wheel wakes up once a lap. Timers that fall due
+ * within the leeway of each other are expired by the same wake up.
+ *
+ * Expired surfaces are collected and handed back together on the main
+ * thread by a single block, however many expired since it was queued.
+ *
+ * The wheel's clock never goes back. The fake clock starts where the
+ * real one is, and when it is swapped out again the real clock is
+ * skewed forward to wherever the fake one was advanced to, so that the
+ * wheel never sits ahead of the clock it is running on.
+ */
+
+#define HL_WHEEL_SLOTS      512
+#define HL_WHEEL_LEEWAY_MS  2
+
+typedef struct hl_timer {
+  hl_surface_t*    surface;
+  unsigned long    generation;
+  uint64_t         deadline; // milliseconds
+  struct hl_timer* next;
+} hl_timer_t;
+
+typedef struct {
+  pthread_mutex_t   lock;
+  hl_timer_t*       slots[HL_WHEEL_SLOTS];
+  uint64_t          now;      // the last millisecond that was expired
+  size_t            pending;
+  hl_timer_t*       closing;  // expired, waiting for the main thread
+  bool              flush_queued;
+  bool              fake;
+  uint64_t          fake_now;
+  uint64_t          skew;     // added to the real clock, only ever grows
+  dispatch_queue_t  queue;
+  dispatch_source_t source;
+  uint64_t          armed;    // deadline the source will fire for, 0 if none
+} hl_wheel_t;
+
+static hl_wheel_t wheel = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static
+uint64_t
+hl_clock_ms()
+{
+  return (wheel.fake ?
+	  wheel.fake_now :
+	  clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / NSEC_PER_MSEC + wheel.skew);
+}
+
+// Move expired timers onto the closing list; call with the lock held
+static
+void
+hl_wheel_expire(const uint64_t now)
+{
+  if (now <= wheel.now)
+    return;
+
+  // visit each slot at most once, however far behind the wheel is
+  uint64_t tick = wheel.now + 1;
+  if (now - wheel.now > HL_WHEEL_SLOTS)
+    tick = now - HL_WHEEL_SLOTS + 1;
+
+  for (; tick <= now; tick++) {
+    hl_timer_t** link = &wheel.slots[tick % HL_WHEEL_SLOTS];
+    while (*link) {
+      hl_timer_t* const timer = *link;
+      if (timer->deadline > now) {
+	link = &timer->next;
+	continue;
+      }
+      *link         = timer->next;
+      timer->next   = wheel.closing;
+      wheel.closing = timer;
+      wheel.pending--;
+    }
+  }
+  wheel.now = now;
+}
+
+// Hand back everything that has expired; only call on the main thread
+static
+void
+hl_wheel_flush()
+{
+  pthread_mutex_lock(&wheel.lock);
+  wheel.flush_queued = false;
+  hl_timer_t* timer  = wheel.closing;
+  wheel.closing      = NULL;
+  pthread_mutex_unlock(&wheel.lock);
+
+  while (timer) {
+    hl_timer_t* const next = timer->next;
+    hl_pool_release(timer->surface, timer->generation);
+    free(timer);
+    timer = next;
+  }
+}
+
+// The earliest pending deadline, or 0 if nothing is pending; call with the lock held
+static
+uint64_t
+hl_wheel_next_deadline()
+{
+  if (!wheel.pending)
+    return 0;
+
+  // only a timer due in this lap can sit in a slot with its own deadline
+  const uint64_t horizon = wheel.now + HL_WHEEL_SLOTS;
+  for (uint64_t tick = wheel.now + 1; tick <= horizon; tick++)
+    for (const hl_timer_t* timer = wheel.slots[tick % HL_WHEEL_SLOTS]; timer; timer = timer->next)
+      if (timer->deadline == tick)
+	return tick;
+
+  // everything is more than a lap away, so check back in a lap
+  return horizon;
+}
+
+// Set the source to fire at the deadline, or never for 0; call with the lock held
+static
+void
+hl_wheel_arm(const uint64_t deadline, const uint64_t now)
+{
+  // the fake clock only moves when it is advanced
+  if (wheel.fake || deadline == wheel.armed)
+    return;
+
+  wheel.armed = deadline;
+  if (!deadline) {
+    dispatch_source_set_timer(wheel.source, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+    return;
+  }
+
+  const uint64_t wait = (deadline > now ? deadline - now : 0);
+  dispatch_source_set_timer(wheel.source,
+			    dispatch_time(DISPATCH_TIME_NOW, (int64_t)(wait * NSEC_PER_MSEC)),
+			    DISPATCH_TIME_FOREVER,
+			    HL_WHEEL_LEEWAY_MS * NSEC_PER_MSEC);
+}
+
+// Whether a flush has to be queued for what expired; call with the lock held
+static
+bool
+hl_wheel_needs_flush()
+{
+  const bool queue_flush = (wheel.closing && !wheel.flush_queued);
+  if (queue_flush)
+    wheel.flush_queued = true;
+  return queue_flush;
+}
+
+static
+void
+hl_wheel_fire()
+{
+  pthread_mutex_lock(&wheel.lock);
+  const uint64_t now = hl_clock_ms();
+  hl_wheel_expire(now);
+  wheel.armed = 0;
+  hl_wheel_arm(hl_wheel_next_deadline(), now);
+  const bool queue_flush = hl_wheel_needs_flush();
+  pthread_mutex_unlock(&wheel.lock);
+
+  if (queue_flush)
+    dispatch_async(dispatch_get_main_queue(), ^(void) { hl_wheel_flush(); });
+}
+
+static
+void
+hl_wheel_schedule(hl_surface_t* const surface,
+		  const unsigned long generation,
+		  const uint64_t timeout)
+{
+  hl_timer_t* const timer = malloc(sizeof(hl_timer_t));
+  if (!timer)
+    rb_raise(rb_eNoMemError, "could not schedule a timeout");
+  timer->surface    = surface;
+  timer->generation = generation;
+
+  pthread_mutex_lock(&wheel.lock);
+  const uint64_t now = hl_clock_ms();
+  if (!wheel.pending && now > wheel.now)
+    wheel.now = now; // nothing to catch up on
+
+  // a timer must land on a slot that has not been passed yet
+  timer->deadline = MAX(now + timeout, wheel.now + 1);
+
+  hl_timer_t** const slot = &wheel.slots[timer->deadline % HL_WHEEL_SLOTS];
+  timer->next = *slot;
+  *slot       = timer;
+  wheel.pending++;
+
+  if (!wheel.armed || timer->deadline < wheel.armed)
+    hl_wheel_arm(timer->deadline, now);
+  pthread_mutex_unlock(&wheel.lock);
+}
+
+static
+void
+hl_wheel_cancel(const hl_surface_t* const surface, const unsigned long generation)
+{
+  pthread_mutex_lock(&wheel.lock);
+  for (size_t i = 0; i < HL_WHEEL_SLOTS; i++) {
+    hl_timer_t** link = &wheel.slots[i];
+    while (*link) {
+      hl_timer_t* const timer = *link;
+      if (timer->surface != surface || timer->generation != generation) {
+	link = &timer->next;
+	continue;
+      }
+      *link = timer->next;
+      free(timer);
+      wheel.pending--;
+    }
+  }
+  pthread_mutex_unlock(&wheel.lock);
+}
+
+static
+void
+hl_wheel_init()
+{
+  wheel.queue  = dispatch_queue_create("org.axelements.accessibility.highlighter",
+				       DISPATCH_QUEUE_SERIAL);
+  wheel.source = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, wheel.queue);
+  // not armed until something is pending
+  dispatch_source_set_timer(wheel.source, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+  dispatch_source_set_event_handler(wheel.source, ^(void) { hl_wheel_fire(); });
+  dispatch_resume(wheel.source);
+}
+
+
+static
+void
+hl_highlight_free(void* const data)
+{
+  hl_highlight_t* const highlight = data;
+  // a highlighter with a timeout stays up until the timeout, as before
+  if (highlight->surface && !highlight->timed)
+    hl_pool_orphan(highlight->surface, highlight->generation);
+  [highlight->color release];
+  xfree(highlight);
+}
+
+static
+hl_highlight_t*
+unwrap_highlight(VALUE self)
+{
+  hl_highlight_t* highlight;
+  Data_Get_Struct(self, hl_highlight_t, highlight);
+  return highlight;
+}
+
 static
 VALUE
 rb_highlighter_new(int argc, VALUE* argv, VALUE self)
@@ -63,14 +542,9 @@ rb_highlighter_new(int argc, VALUE* argv, VALUE self)
   if (!argc)
     rb_raise(rb_eArgError, "wrong number of arguments (0 for 1+)");
 
-  const CGRect bounds = flip(unwrap_rect(coerce_to_rect(argv[0])));
-  NSWindow* const window =
-      [[NSWindow alloc] initWithContentRect:NSRectFromCGRect(bounds)
-                                  styleMask:NSWindowStyleMaskBorderless
-		                    backing:NSBackingStoreBuffered
-                                      defer:true];
-
-  NSColor* color = [NSColor magentaColor];
+  NSColor*  color    = [NSColor magentaColor];
+  long long timeout  = -1;
+  bool      headless = false;
 
   if (argc > 1) {
     VALUE rb_color = rb_hash_lookup(argv[1], color_key);
@@ -78,34 +552,34 @@ rb_highlighter_new(int argc, VALUE* argv, VALUE self)
       rb_color = rb_hash_lookup(argv[1], colour_key);
     if (rb_color != Qnil)
       color = unwrap_color(rb_color);
-  }
-
-  [window setOpaque:false];
-  [window setAlphaValue:0.20];
-  [window setLevel:NSStatusWindowLevel];
-  [window setBackgroundColor:color];
-  [window setIgnoresMouseEvents:true];
-  [window setFrame:NSRectFromCGRect(bounds) display:false];
-  [window makeKeyAndOrderFront:NSApp];
-  [window setReleasedWhenClosed:false];
 
-  if (argc > 1) {
     VALUE rb_timeout = rb_hash_lookup(argv[1], timeout_key);
     if (rb_timeout != Qnil) {
-      dispatch_time_t timeout = dispatch_time(
-					      DISPATCH_TIME_NOW,
-					      NUM2LL(rb_timeout) * NSEC_PER_SEC
-					      );
-      dispatch_after(
-		     timeout,
-		     dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
-		     ^(void) { [window close]; }
-		     );
+      const double seconds = NUM2DBL(rb_timeout);
+      if (seconds < 0)
+	rb_raise(rb_eArgError, "timeout must not be negative");
+      timeout = llround(seconds * 1000);
     }
+
+    headless = RTEST(rb_hash_lookup(argv[1], headless_key));
+  }
+
+  const CGRect bounds = flip(unwrap_rect(coerce_to_rect(argv[0])));
+
+  hl_highlight_t* highlight;
+  VALUE highlighter = Data_Make_Struct(rb_cHighlighter, hl_highlight_t,
+				       NULL, hl_highlight_free, highlight);
+  highlight->color      = [color retain];
+  highlight->frame      = bounds;
+  highlight->surface    = hl_pool_acquire(headless);
+  highlight->generation = highlight->surface->generation;
+  hl_surface_show(highlight->surface, bounds, color);
+
+  if (timeout >= 0) {
+    hl_wheel_schedule(highlight->surface, highlight->generation, (uint64_t)timeout);
+    highlight->timed = true;
   }
 
-  VALUE highlighter = wrap_window(window);
-  rb_ivar_set(highlighter, ivar_color, wrap_color(color));
   return highlighter;
 }
 
@@ -113,7 +587,9 @@ static
 VALUE
 rb_highlighter_stop(VALUE self)
 {
-  [unwrap_window(self) close];
+  hl_highlight_t* const highlight = unwrap_highlight(self);
+  hl_wheel_cancel(highlight->surface, highlight->generation);
+  hl_pool_release(highlight->surface, highlight->generation);
   return self;
 }
 
@@ -121,21 +597,612 @@ static
 VALUE
 rb_highlighter_color(VALUE self)
 {
-  return wrap_color([unwrap_window(self) backgroundColor]);
+  return wrap_color([unwrap_highlight(self)->color retain]);
 }
 
 static
 VALUE
 rb_highlighter_frame(VALUE self)
 {
-    return wrap_rect(NSRectToCGRect([unwrap_window(self) frame]));
+    return wrap_rect(unwrap_highlight(self)->frame);
 }
 
 static
 VALUE
 rb_highlighter_is_visible(VALUE self)
 {
-  return ([unwrap_window(self) isVisible] ? Qtrue : Qfalse);
+  // hand back anything that expired while the main queue was not running
+  if ([NSThread isMainThread]) {
+    hl_wheel_flush();
+    hl_pool_release_orphans();
+  }
+
+  const hl_highlight_t* const highlight = unwrap_highlight(self);
+  if (!hl_highlight_is_current(highlight))
+    return Qfalse;
+  if (highlight->surface->headless)
+    return (highlight->surface->showing ? Qtrue : Qfalse);
+  return ([highlight->surface->window isVisible] ? Qtrue : Qfalse);
+}
+
+/*
+ * How many highlighters are waiting for their timeout
+ *
+ * @return [Integer]
+ */
+static
+VALUE
+rb_highlighter_pending(VALUE self)
+{
+  pthread_mutex_lock(&wheel.lock);
+  const size_t pending = wheel.pending;
+  pthread_mutex_unlock(&wheel.lock);
+  return SIZET2NUM(pending);
+}
+
+/*
+ * Swap the clock that timeouts run on for one that only moves when
+ * {Highlighter.advance} is called, or swap it back again
+ *
+ * Time spent on the fake clock is not given back: the real clock picks
+ * up from wherever the fake one was advanced to, so timeouts keep their
+ * length across the swap. Anything that is due by then times out.
+ *
+ * This is meant for tests.
+ *
+ * @param fake [Boolean]
+ * @return [Boolean]
+ */
+static
+VALUE
+rb_highlighter_set_fake_clock(VALUE self, VALUE fake)
+{
+  pthread_mutex_lock(&wheel.lock);
+  if (RTEST(fake) && !wheel.fake) {
+    hl_wheel_arm(0, 0);
+    wheel.fake_now = hl_clock_ms();
+    wheel.fake     = true;
+    hl_wheel_expire(wheel.fake_now);
+  }
+  else if (!RTEST(fake) && wheel.fake) {
+    wheel.fake = false;
+    const uint64_t real = hl_clock_ms();
+    if (wheel.fake_now > real)
+      wheel.skew += wheel.fake_now - real;
+
+    const uint64_t now = hl_clock_ms();
+    hl_wheel_expire(now);
+    hl_wheel_arm(hl_wheel_next_deadline(), now);
+  }
+  const bool queue_flush = hl_wheel_needs_flush();
+  pthread_mutex_unlock(&wheel.lock);
+
+  if (queue_flush)
+    dispatch_async(dispatch_get_main_queue(), ^(void) { hl_wheel_flush(); });
+  return fake;
+}
+
+/*
+ * Move the fake clock forward, closing any highlighters that time out
+ *
+ * @param seconds [Number]
+ * @return [Integer] how many highlighters timed out
+ */
+static
+VALUE
+rb_highlighter_advance(VALUE self, VALUE seconds)
+{
+  const double delta = NUM2DBL(seconds);
+  if (delta < 0)
+    rb_raise(rb_eArgError, "cannot turn the clock back");
+
+  pthread_mutex_lock(&wheel.lock);
+  if (!wheel.fake) {
+    pthread_mutex_unlock(&wheel.lock);
+    rb_raise(rb_eRuntimeError, "the fake clock is not in use");
+    return Qnil; // unreachable
+  }
+  wheel.fake_now += (uint64_t)llround(delta * 1000);
+  const size_t before = wheel.pending;
+  hl_wheel_expire(wheel.fake_now);
+  const size_t expired = before - wheel.pending;
+  pthread_mutex_unlock(&wheel.lock);
+
+  hl_wheel_flush();
+  return SIZET2NUM(expired);
+}
+
+/*
+ * Close and release the windows kept for reuse
+ *
+ * Highlighters that are showing are left alone.
+ *
+ * @return [Integer] how many windows were released
+ */
+static
+VALUE
+rb_highlighter_drain(VALUE self)
+{
+  pthread_mutex_lock(&pool.lock);
+  const size_t before = pool.released;
+  hl_pool_trim(0);
+  const size_t released = pool.released - before;
+  pthread_mutex_unlock(&pool.lock);
+  return SIZET2NUM(released);
+}
+
+/*
+ * How many idle windows are kept for reuse
+ *
+ * @return [Integer]
+ */
+static
+VALUE
+rb_highlighter_pool_limit(VALUE self)
+{
+  pthread_mutex_lock(&pool.lock);
+  const size_t limit = pool.limit;
+  pthread_mutex_unlock(&pool.lock);
+  return SIZET2NUM(limit);
+}
+
+/*
+ * Change how many idle windows are kept, releasing any over the new limit
+ *
+ * @param limit [Integer]
+ * @return [Integer]
+ */
+static
+VALUE
+rb_highlighter_set_pool_limit(VALUE self, VALUE limit)
+{
+  const long new_limit = NUM2LONG(limit);
+  if (new_limit < 0)
+    rb_raise(rb_eArgError, "pool limit must not be negative");
+
+  pthread_mutex_lock(&pool.lock);
+  pool.limit = (size_t)new_limit;
+  hl_pool_trim(pool.limit);
+  pthread_mutex_unlock(&pool.lock);
+  return limit;
+}
+
+/*
+ * Counters for the window pool
+ *
+ * `:created` counts windows (or headless surfaces) that had to be
+ * made, `:reused` counts highlighters that got one from the pool, and
+ * `:released` counts windows closed for good.
+ *
+ * @example
+ *
+ *   Accessibility::Highlighter.pool_stats
+ *     # => { limit: 16, idle: 3, in_use: 1, created: 4, reused: 120, released: 0 }
+ *
+ * @return [Hash{Symbol=>Integer}]
+ */
+static
+VALUE
+rb_highlighter_pool_stats(VALUE self)
+{
+  // count collected highlighters as handed back, if we can do that here
+  if ([NSThread isMainThread])
+    hl_pool_release_orphans();
+
+  pthread_mutex_lock(&pool.lock);
+  const size_t limit    = pool.limit;
+  const size_t idle     = pool.idle_count;
+  const size_t in_use   = pool.in_use;
+  const size_t created  = pool.created;
+  const size_t reused   = pool.reused;
+  const size_t released = pool.released;
+  pthread_mutex_unlock(&pool.lock);
+
+  VALUE stats = rb_hash_new();
+  rb_hash_aset(stats, limit_key,    SIZET2NUM(limit));
+  rb_hash_aset(stats, idle_key,     SIZET2NUM(idle));
+  rb_hash_aset(stats, in_use_key,   SIZET2NUM(in_use));
+  rb_hash_aset(stats, created_key,  SIZET2NUM(created));
+  rb_hash_aset(stats, reused_key,   SIZET2NUM(reused));
+  rb_hash_aset(stats, released_key, SIZET2NUM(released));
+  return stats;
+}
+
+
+/*
+ * A batch draws any number of highlights into one overlay window that
+ * covers all the screens, instead of making a window per highlight.
+ * Highlights are kept in an array and the whole overlay is redrawn
+ * once per change, however many highlights the change touched.
+ *
+ * A headless batch has no window; redrawing records the fills that
+ * would have been drawn, which is how the layout gets tested. The
+ * layout itself lives in batch_layout.c, which is plain C, but the
+ * overlay's frame still comes from NSScreen, even when headless.
+ */
+
+typedef struct {
+  hl_layout_t layout;    // items hold a retained NSColor each
+  NSColor*    color;     // for highlights added without one
+  NSWindow*   window;    // nil when headless, or once stopped
+  NSView*     view;      // the window's AXHighlightBatchView, not retained
+  bool        headless;
+  size_t      redraws;
+} hl_batch_t;
+
+static
+CGRect
+hl_cgrect(const hl_rect_t rect)
+{
+  return CGRectMake(rect.x, rect.y, rect.width, rect.height);
+}
+
+static
+hl_rect_t
+hl_rect(const CGRect rect)
+{
+  const hl_rect_t converted = {
+    rect.origin.x, rect.origin.y, rect.size.width, rect.size.height
+  };
+  return converted;
+}
+
+@interface AXHighlightBatchView : NSView {
+@public
+  hl_batch_t* batch;
+}
+@end
+
+@implementation AXHighlightBatchView
+
+- (BOOL)isOpaque
+{
+  return NO;
+}
+
+- (void)drawRect:(NSRect)dirty
+{
+  [[NSColor clearColor] set];
+  NSRectFill(dirty);
+  if (!batch)
+    return;
+
+  const hl_layout_t* const layout = &batch->layout;
+  for (size_t i = 0; i < layout->count; i++) {
+    const hl_item_t* const item = &layout->items[i];
+    [[(NSColor*)item->color colorWithAlphaComponent:HIGHLIGHT_ALPHA] set];
+    NSRectFillUsingOperation(NSRectFromCGRect(hl_cgrect(hl_layout_place(layout, item))),
+			     NSCompositingOperationSourceOver);
+  }
+}
+
+@end
+
+static
+void
+hl_batch_redraw(hl_batch_t* const batch)
+{
+  batch->redraws++;
+
+  // a stopped batch has nowhere to draw, and never records
+  if (batch->window)
+    [[batch->window contentView] setNeedsDisplay:true];
+  else if (batch->headless && hl_layout_record(&batch->layout))
+    rb_raise(rb_eNoMemError, "failed to record %ld draw calls", (long)batch->layout.count);
+}
+
+static
+void
+hl_batch_close(hl_batch_t* const batch)
+{
+  if (!batch->window)
+    return;
+  ((AXHighlightBatchView*)batch->view)->batch = NULL;
+  [batch->window close];
+  [batch->window release];
+  batch->window = nil;
+  batch->view   = nil;
+}
+
+/*
+ * Close the overlay of a collected batch on the main thread
+ *
+ * The GC can run on any thread and must not close windows, so the view
+ * is cut loose from the batch right away (it must not draw what is
+ * about to be freed) and the window is closed by a main queue block.
+ */
+static
+void
+hl_batch_orphan(hl_batch_t* const batch)
+{
+  NSWindow* const window = batch->window;
+  if (!window)
+    return;
+  ((AXHighlightBatchView*)batch->view)->batch = NULL;
+  batch->window = nil;
+  batch->view   = nil;
+  dispatch_async(dispatch_get_main_queue(), ^(void) {
+      [window close];
+      [window release];
+    });
+}
+
+static
+void
+hl_batch_free(void* const data)
+{
+  hl_batch_t* const batch = data;
+  hl_batch_orphan(batch);
+  for (size_t i = 0; i < batch->layout.count; i++)
+    [(NSColor*)batch->layout.items[i].color release];
+  [batch->color release];
+  hl_layout_free(&batch->layout);
+  xfree(batch);
+}
+
+static
+hl_batch_t*
+unwrap_batch(VALUE self)
+{
+  hl_batch_t* batch;
+  Data_Get_Struct(self, hl_batch_t, batch);
+  return batch;
+}
+
+static
+NSColor*
+hl_color_from(VALUE opts)
+{
+  VALUE rb_color = rb_hash_lookup(opts, color_key);
+  if (rb_color == Qnil)
+    rb_color = rb_hash_lookup(opts, colour_key);
+  return (rb_color == Qnil ? nil : unwrap_color(rb_color));
+}
+
+// Add highlights without redrawing; returns their ids
+static
+VALUE
+hl_batch_add(hl_batch_t* const batch, VALUE rects, NSColor* color)
+{
+  // a lone rect might be a CGRect or an Array like [x, y, w, h]
+  if (TYPE(rects) != T_ARRAY ||
+      (RARRAY_LEN(rects) && rb_obj_is_kind_of(rb_ary_entry(rects, 0), rb_cNumeric)))
+    rects = rb_ary_new3(1, rects);
+
+  const long length = RARRAY_LEN(rects);
+  if (!color)
+    color = batch->color;
+
+  // work out all the rects before touching the batch, in case one raises
+  VALUE bounds_buffer;
+  CGRect* const bounds = ALLOCV_N(CGRect, bounds_buffer, length);
+  for (long i = 0; i < length; i++)
+    bounds[i] = unwrap_rect(coerce_to_rect(rb_ary_entry(rects, i)));
+
+  if (hl_layout_reserve(&batch->layout, (size_t)length))
+    rb_raise(rb_eNoMemError, "failed to make room for %ld highlights", length);
+
+  VALUE ids = rb_ary_new2(length);
+  for (long i = 0; i < length; i++) {
+    const long id = hl_layout_push(&batch->layout, hl_rect(bounds[i]), [color retain]);
+    rb_ary_push(ids, LONG2NUM(id));
+  }
+  ALLOCV_END(bounds_buffer);
+  return ids;
+}
+
+/*
+ * Highlight many rects with a single overlay window
+ *
+ * Takes the same `:color` option as {Highlighter.new}, which is used
+ * for rects that are added without a colour of their own. With
+ * `headless: true`, no window is made and {Batch#draw_calls} records
+ * what would have been drawn instead.
+ *
+ * @example
+ *
+ *   batch = Accessibility::Highlighter.batch buttons.map(&:to_rect), color: NSColor.greenColor
+ *   batch.add field.to_rect, color: NSColor.redColor
+ *   batch.stop
+ *
+ * @param rects [Array<CGRect,#to_rect>]
+ * @param opts [Hash]
+ * @return [Accessibility::Highlighter::Batch]
+ */
+static
+VALUE
+rb_highlighter_batch(int argc, VALUE* argv, VALUE self)
+{
+  if (!argc)
+    rb_raise(rb_eArgError, "wrong number of arguments (0 for 1+)");
+
+  VALUE       opts = (argc > 1 ? argv[1] : rb_hash_new());
+  NSColor*   color = hl_color_from(opts);
+  hl_batch_t* batch;
+  VALUE        obj = Data_Make_Struct(rb_cBatch, hl_batch_t, NULL, hl_batch_free, batch);
+  batch->color    = [(color ? color : [NSColor magentaColor]) retain];
+  batch->headless = RTEST(rb_hash_lookup(opts, headless_key));
+
+  NSRect frame = NSZeroRect;
+  for (NSScreen* screen in [NSScreen screens])
+    frame = NSUnionRect(frame, [screen frame]);
+  batch->layout.frame         = hl_rect(NSRectToCGRect(frame));
+  batch->layout.screen_height = NSMaxY([[NSScreen mainScreen] frame]);
+
+  hl_batch_add(batch, argv[0], nil);
+
+  if (!batch->headless) {
+    NSWindow* const window =
+      [[NSWindow alloc] initWithContentRect:frame
+				  styleMask:NSWindowStyleMaskBorderless
+				    backing:NSBackingStoreBuffered
+				      defer:true];
+    AXHighlightBatchView* const view = [[AXHighlightBatchView alloc] initWithFrame:frame];
+    view->batch = batch;
+
+    [window setOpaque:false];
+    [window setBackgroundColor:[NSColor clearColor]];
+    [window setLevel:NSStatusWindowLevel];
+    [window setIgnoresMouseEvents:true];
+    [window setReleasedWhenClosed:false];
+    [window setContentView:view];
+    [view release];
+    [window setFrame:frame display:false];
+    [window makeKeyAndOrderFront:NSApp];
+    batch->window = window;
+    batch->view   = view;
+  }
+
+  hl_batch_redraw(batch);
+  return obj;
+}
+
+/*
+ * Add more highlights, with a single redraw
+ *
+ * @param rects [Array<CGRect,#to_rect>,CGRect,#to_rect]
+ * @param opts [Hash] accepts `:color`
+ * @return [Array<Integer>] ids that can be given to {#remove}
+ */
+static
+VALUE
+rb_batch_add(int argc, VALUE* argv, VALUE self)
+{
+  if (!argc)
+    rb_raise(rb_eArgError, "wrong number of arguments (0 for 1..2)");
+
+  hl_batch_t* const batch = unwrap_batch(self);
+  NSColor* const    color = (argc > 1 ? hl_color_from(argv[1]) : nil);
+
+  VALUE ids = hl_batch_add(batch, argv[0], color);
+  hl_batch_redraw(batch);
+  return ids;
+}
+
+/*
+ * Take highlights away, with a single redraw
+ *
+ * @param ids [Array<Integer>,Integer]
+ * @return [Integer] how many highlights were removed
+ */
+static
+VALUE
+rb_batch_remove(VALUE self, VALUE ids)
+{
+  hl_batch_t* const  batch = unwrap_batch(self);
+  hl_layout_t* const layout = &batch->layout;
+  ids = rb_Array(ids);
+
+  // look ids up in a hash, so this is not quadratic for big removals
+  VALUE doomed = rb_hash_new();
+  for (long i = 0; i < RARRAY_LEN(ids); i++)
+    rb_hash_aset(doomed, LONG2NUM(NUM2LONG(rb_ary_entry(ids, i))), Qtrue);
+
+  size_t kept = 0;
+  for (size_t i = 0; i < layout->count; i++) {
+    hl_item_t* const item = &layout->items[i];
+    if (rb_hash_lookup(doomed, LONG2NUM(item->id)) == Qtrue) {
+      [(NSColor*)item->color release];
+      continue;
+    }
+    layout->items[kept++] = *item;
+  }
+
+  const size_t removed = layout->count - kept;
+  layout->count = kept;
+  if (removed)
+    hl_batch_redraw(batch);
+  return SIZET2NUM(removed);
+}
+
+/*
+ * The rects being highlighted, in the order they were added
+ *
+ * @return [Array<CGRect>]
+ */
+static
+VALUE
+rb_batch_rects(VALUE self)
+{
+  const hl_layout_t* const layout = &unwrap_batch(self)->layout;
+  VALUE rects = rb_ary_new2(layout->count);
+  for (size_t i = 0; i < layout->count; i++)
+    rb_ary_push(rects, wrap_rect(hl_cgrect(layout->items[i].rect)));
+  return rects;
+}
+
+/*
+ * Remove the overlay; a stopped batch cannot be started again
+ *
+ * @return [self]
+ */
+static
+VALUE
+rb_batch_stop(VALUE self)
+{
+  hl_batch_close(unwrap_batch(self));
+  return self;
+}
+
+/*
+ * @return [Boolean]
+ */
+static
+VALUE
+rb_batch_is_visible(VALUE self)
+{
+  hl_batch_t* const batch = unwrap_batch(self);
+  return (batch->window && [batch->window isVisible] ? Qtrue : Qfalse);
+}
+
+/*
+ * What the last redraw of a headless batch drew
+ *
+ * Each call is `[:fill, rect, color]`, where the rect is in the
+ * overlay's own (unflipped) coordinates. Always empty for a batch that
+ * has a window, even after it has been stopped.
+ *
+ * @return [Array<Array>]
+ */
+static
+VALUE
+rb_batch_draw_calls(VALUE self)
+{
+  const hl_layout_t* const layout = &unwrap_batch(self)->layout;
+  VALUE calls = rb_ary_new2(layout->fill_count);
+  for (size_t i = 0; i < layout->fill_count; i++) {
+    const hl_fill_t* const fill = &layout->fills[i];
+    [(NSColor*)fill->color retain];
+    rb_ary_push(calls, rb_ary_new3(3,
+				   fill_sym,
+				   wrap_rect(hl_cgrect(fill->rect)),
+				   wrap_color((NSColor*)fill->color)));
+  }
+  return calls;
+}
+
+/*
+ * How many times the overlay has been redrawn
+ *
+ * @return [Integer]
+ */
+static
+VALUE
+rb_batch_redraws(VALUE self)
+{
+  return SIZET2NUM(unwrap_batch(self)->redraws);
+}
+
+/*
+ * The frame of the overlay, in Cocoa coordinates
+ *
+ * @return [CGRect]
+ */
+static
+VALUE
+rb_batch_frame(VALUE self)
+{
+  return wrap_rect(hl_cgrect(unwrap_batch(self)->layout.frame));
 }
 
 
@@ -250,11 +1317,46 @@ Init_highlighter()
 
   rb_define_alias(rb_cHighlighter, "colour", "color");
 
-  ivar_color  = rb_intern("color");
+  hl_wheel_init();
+  rb_define_singleton_method(rb_cHighlighter, "pending",     rb_highlighter_pending,        0);
+  rb_define_singleton_method(rb_cHighlighter, "fake_clock=", rb_highlighter_set_fake_clock, 1);
+  rb_define_singleton_method(rb_cHighlighter, "advance",     rb_highlighter_advance,        1);
+
+  rb_define_singleton_method(rb_cHighlighter, "drain",       rb_highlighter_drain,          0);
+  rb_define_singleton_method(rb_cHighlighter, "pool_limit",  rb_highlighter_pool_limit,     0);
+  rb_define_singleton_method(rb_cHighlighter, "pool_limit=", rb_highlighter_set_pool_limit, 1);
+  rb_define_singleton_method(rb_cHighlighter, "pool_stats",  rb_highlighter_pool_stats,     0);
+
+  rb_define_singleton_method(rb_cHighlighter, "batch", rb_highlighter_batch, -1);
+
+  /*
+   * Document-class: Accessibility::Highlighter::Batch
+   *
+   * Many highlights drawn into one overlay window. See
+   * {Accessibility::Highlighter.batch}.
+   */
+  rb_cBatch = rb_define_class_under(rb_cHighlighter, "Batch", rb_cObject);
+  rb_undef_alloc_func(rb_cBatch);
+  rb_define_method(rb_cBatch, "add",        rb_batch_add,        -1);
+  rb_define_method(rb_cBatch, "remove",     rb_batch_remove,      1);
+  rb_define_method(rb_cBatch, "rects",      rb_batch_rects,       0);
+  rb_define_method(rb_cBatch, "stop",       rb_batch_stop,        0);
+  rb_define_method(rb_cBatch, "visible?",   rb_batch_is_visible,  0);
+  rb_define_method(rb_cBatch, "draw_calls", rb_batch_draw_calls,  0);
+  rb_define_method(rb_cBatch, "redraws",    rb_batch_redraws,     0);
+  rb_define_method(rb_cBatch, "frame",      rb_batch_frame,       0);
 
-  color_key   = ID2SYM(rb_intern("color"));
-  colour_key  = ID2SYM(rb_intern("colour")); // fuck yeah, Canada
-  timeout_key = ID2SYM(rb_intern("timeout"));
+  color_key    = ID2SYM(rb_intern("color"));
+  colour_key   = ID2SYM(rb_intern("colour")); // fuck yeah, Canada
+  timeout_key  = ID2SYM(rb_intern("timeout"));
+  headless_key = ID2SYM(rb_intern("headless"));
+  limit_key    = ID2SYM(rb_intern("limit"));
+  idle_key     = ID2SYM(rb_intern("idle"));
+  in_use_key   = ID2SYM(rb_intern("in_use"));
+  created_key  = ID2SYM(rb_intern("created"));
+  reused_key   = ID2SYM(rb_intern("reused"));
+  released_key = ID2SYM(rb_intern("released"));
+  fill_sym     = ID2SYM(rb_intern("fill"));
 
 
   /*
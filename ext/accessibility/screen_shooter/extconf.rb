@@ -7,6 +7,8 @@ $CFLAGS << ' -Wno-conversion'
 
 $LIBS  << ' -framework Foundation'
 $LIBS  << ' -framework CoreGraphics'
+$LIBS  << ' -framework ApplicationServices'
+$LIBS  << ' -lz'
 
 unless RbConfig::CONFIG['CC'].match(/clang/)
   clang = `which clang`.chomp
@@ -0,0 +1,361 @@
+#include "frame_delta.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define SS_SEQUENCE_HEADER_SIZE 28
+#define SS_SEQUENCE_FRAME_SIZE  9
+#define SS_SEQUENCE_MAX_SIDE    (1 << 16)  // bigger than any screen
+
+static const uint8_t sequence_magic[4] = { 'A', 'X', 'S', 'Q' };
+
+static
+void
+put_be32(uint8_t* const bytes, const uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+static
+uint32_t
+get_be32(const uint8_t* const bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+           ((uint32_t)bytes[2] << 8)  |  (uint32_t)bytes[3];
+}
+
+static
+size_t
+frame_size(const ss_sequence_t* const sequence)
+{
+    return (size_t)sequence->width * sequence->height * 4;
+}
+
+static
+size_t
+tile_count(const ss_sequence_t* const sequence)
+{
+    return (size_t)sequence->tiles_x * sequence->tiles_y;
+}
+
+static
+size_t
+bitset_size(const ss_sequence_t* const sequence)
+{
+    return (tile_count(sequence) + 7) / 8;
+}
+
+// The pixel rect covered by a tile, clipped to the frame
+static
+void
+tile_rect(const ss_sequence_t* const sequence, const size_t index,
+          uint32_t* const x, uint32_t* const y, uint32_t* const width, uint32_t* const height)
+{
+    *x      = (uint32_t)(index % sequence->tiles_x) * sequence->tile;
+    *y      = (uint32_t)(index / sequence->tiles_x) * sequence->tile;
+    *width  = (sequence->width  - *x < sequence->tile ? sequence->width  - *x : sequence->tile);
+    *height = (sequence->height - *y < sequence->tile ? sequence->height - *y : sequence->tile);
+}
+
+static
+size_t
+tile_size(const ss_sequence_t* const sequence, const size_t index)
+{
+    uint32_t x, y, width, height;
+    tile_rect(sequence, index, &x, &y, &width, &height);
+    return (size_t)width * height * 4;
+}
+
+int
+ss_sequence_init(ss_sequence_t* const sequence,
+                 const uint32_t width, const uint32_t height,
+                 const uint32_t tile, const uint32_t keyframe_interval, const int level)
+{
+    memset(sequence, 0, sizeof(ss_sequence_t));
+    if (!width || !height || width > SS_SEQUENCE_MAX_SIDE || height > SS_SEQUENCE_MAX_SIDE ||
+        !tile || !keyframe_interval ||
+        level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)
+        return -1;
+
+    sequence->width             = width;
+    sequence->height            = height;
+    sequence->tile              = tile;
+    sequence->keyframe_interval = keyframe_interval;
+    sequence->level             = level;
+    sequence->tiles_x           = (width  + tile - 1) / tile;
+    sequence->tiles_y           = (height + tile - 1) / tile;
+    sequence->previous          = malloc(frame_size(sequence));
+    sequence->scratch           = malloc(frame_size(sequence));
+    if (!sequence->previous || !sequence->scratch) {
+        ss_sequence_free(sequence);
+        return -1;
+    }
+    return 0;
+}
+
+void
+ss_sequence_free(ss_sequence_t* const sequence)
+{
+    for (size_t i = 0; i < sequence->count; i++)
+        free(sequence->frames[i].data);
+    free(sequence->frames);
+    free(sequence->previous);
+    free(sequence->scratch);
+    memset(sequence, 0, sizeof(ss_sequence_t));
+}
+
+static
+ss_delta_frame_t*
+push_frame(ss_sequence_t* const sequence)
+{
+    if (sequence->count == sequence->capacity) {
+        const size_t capacity = (sequence->capacity ? sequence->capacity * 2 : 16);
+        ss_delta_frame_t* const frames = realloc(sequence->frames, capacity * sizeof(ss_delta_frame_t));
+        if (!frames)
+            return NULL;
+        sequence->frames   = frames;
+        sequence->capacity = capacity;
+    }
+    ss_delta_frame_t* const frame = &sequence->frames[sequence->count];
+    memset(frame, 0, sizeof(ss_delta_frame_t));
+    return frame;
+}
+
+// Compress `length` bytes of `raw` into the frame data, after `prefix` bytes
+static
+int
+compress_into(ss_delta_frame_t* const frame, const size_t prefix,
+              const uint8_t* const raw, const size_t length, const int level)
+{
+    uLongf        packed = compressBound((uLong)length);
+    uint8_t* const grown = realloc(frame->data, prefix + packed);
+    if (!grown)
+        return -1;
+    frame->data = grown;
+    if (length && compress2(frame->data + prefix, &packed, raw, (uLong)length, level) != Z_OK)
+        return -1;
+    frame->length = prefix + (length ? packed : 0);
+
+    uint8_t* const shrunk = realloc(frame->data, frame->length ? frame->length : 1);
+    if (shrunk)
+        frame->data = shrunk;
+    return 0;
+}
+
+int
+ss_sequence_append(ss_sequence_t* const sequence, const uint8_t* const pixels, const size_t stride)
+{
+    ss_delta_frame_t* const frame = push_frame(sequence);
+    if (!frame)
+        return -1;
+
+    const size_t row = (size_t)sequence->width * 4;
+    frame->keyframe  = (sequence->count % sequence->keyframe_interval == 0);
+
+    if (frame->keyframe) {
+        for (uint32_t y = 0; y < sequence->height; y++)
+            memcpy(sequence->scratch + y * row, pixels + y * stride, row);
+        frame->tiles = (uint32_t)tile_count(sequence);
+        if (compress_into(frame, 0, sequence->scratch, frame_size(sequence), sequence->level)) {
+            free(frame->data);
+            return -1;
+        }
+    }
+    else {
+        // the bit set goes first, the compressed tiles after it
+        const size_t bits = bitset_size(sequence);
+        frame->data = calloc(bits, 1);
+        if (!frame->data)
+            return -1;
+
+        size_t gathered = 0;
+        for (size_t i = 0; i < tile_count(sequence); i++) {
+            uint32_t x, y, width, height;
+            tile_rect(sequence, i, &x, &y, &width, &height);
+            const size_t tile_row = (size_t)width * 4;
+
+            int differs = 0;
+            for (uint32_t ty = 0; ty < height && !differs; ty++)
+                differs = memcmp(pixels + (y + ty) * stride + x * 4,
+                                 sequence->previous + (y + ty) * row + x * 4,
+                                 tile_row) != 0;
+            if (!differs)
+                continue;
+
+            frame->data[i / 8] |= (uint8_t)(1 << (i % 8));
+            frame->tiles++;
+            for (uint32_t ty = 0; ty < height; ty++) {
+                memcpy(sequence->scratch + gathered, pixels + (y + ty) * stride + x * 4, tile_row);
+                gathered += tile_row;
+            }
+        }
+
+        if (compress_into(frame, bits, sequence->scratch, gathered, sequence->level)) {
+            free(frame->data);
+            return -1;
+        }
+    }
+
+    for (uint32_t y = 0; y < sequence->height; y++)
+        memcpy(sequence->previous + y * row, pixels + y * stride, row);
+    sequence->count++;
+    return 0;
+}
+
+// Apply one stored frame on top of `out`, which holds the frame before it
+static
+int
+apply_frame(const ss_sequence_t* const sequence, const ss_delta_frame_t* const frame,
+            uint8_t* const out, uint8_t* const scratch)
+{
+    if (frame->keyframe) {
+        uLongf length = (uLongf)frame_size(sequence);
+        if (uncompress(out, &length, frame->data, (uLong)frame->length) != Z_OK ||
+            length != frame_size(sequence))
+            return -1;
+        return 0;
+    }
+
+    const size_t    bits = bitset_size(sequence);
+    const uint8_t* const changed = frame->data;
+    if (frame->length < bits)
+        return -1;
+    if (!frame->tiles)
+        return 0;
+
+    size_t expected = 0;
+    for (size_t i = 0; i < tile_count(sequence); i++)
+        if (changed[i / 8] & (1 << (i % 8)))
+            expected += tile_size(sequence, i);
+
+    uLongf length = (uLongf)expected;
+    if (uncompress(scratch, &length, frame->data + bits, (uLong)(frame->length - bits)) != Z_OK ||
+        length != expected)
+        return -1;
+
+    const size_t  row = (size_t)sequence->width * 4;
+    size_t     offset = 0;
+    for (size_t i = 0; i < tile_count(sequence); i++) {
+        if (!(changed[i / 8] & (1 << (i % 8))))
+            continue;
+        uint32_t x, y, width, height;
+        tile_rect(sequence, i, &x, &y, &width, &height);
+        for (uint32_t ty = 0; ty < height; ty++) {
+            memcpy(out + (y + ty) * row + x * 4, scratch + offset, (size_t)width * 4);
+            offset += (size_t)width * 4;
+        }
+    }
+    return 0;
+}
+
+int
+ss_sequence_frame(const ss_sequence_t* const sequence, const size_t index, uint8_t* const out)
+{
+    if (index >= sequence->count)
+        return -1;
+
+    uint8_t* const scratch = malloc(frame_size(sequence));
+    if (!scratch)
+        return -1;
+
+    const size_t key = index - index % sequence->keyframe_interval;
+    int       result = 0;
+    for (size_t i = key; i <= index && !result; i++)
+        result = apply_frame(sequence, &sequence->frames[i], out, scratch);
+
+    free(scratch);
+    return result;
+}
+
+size_t
+ss_sequence_bytes(const ss_sequence_t* const sequence)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < sequence->count; i++)
+        bytes += sequence->frames[i].length;
+    return bytes;
+}
+
+int
+ss_sequence_dump(const ss_sequence_t* const sequence, const ss_png_write_fn write, void* const ctx)
+{
+    uint8_t header[SS_SEQUENCE_HEADER_SIZE];
+    memcpy(header, sequence_magic, 4);
+    put_be32(header + 4,  SS_SEQUENCE_VERSION);
+    put_be32(header + 8,  sequence->width);
+    put_be32(header + 12, sequence->height);
+    put_be32(header + 16, sequence->tile);
+    put_be32(header + 20, sequence->keyframe_interval);
+    put_be32(header + 24, (uint32_t)sequence->count);
+    if (write(ctx, header, sizeof(header)))
+        return -1;
+
+    for (size_t i = 0; i < sequence->count; i++) {
+        const ss_delta_frame_t* const frame = &sequence->frames[i];
+        uint8_t frame_header[SS_SEQUENCE_FRAME_SIZE];
+        frame_header[0] = frame->keyframe;
+        put_be32(frame_header + 1, frame->tiles);
+        put_be32(frame_header + 5, (uint32_t)frame->length);
+        if (write(ctx, frame_header, sizeof(frame_header)) ||
+            (frame->length && write(ctx, frame->data, frame->length)))
+            return -1;
+    }
+    return 0;
+}
+
+int
+ss_sequence_load(ss_sequence_t* const sequence, const uint8_t* const bytes, const size_t length,
+                 const int level)
+{
+    memset(sequence, 0, sizeof(ss_sequence_t));
+    if (length < SS_SEQUENCE_HEADER_SIZE || memcmp(bytes, sequence_magic, 4) ||
+        get_be32(bytes + 4) != SS_SEQUENCE_VERSION)
+        return -1;
+
+    if (ss_sequence_init(sequence,
+                         get_be32(bytes + 8),  get_be32(bytes + 12),
+                         get_be32(bytes + 16), get_be32(bytes + 20), level))
+        return -1;
+
+    const uint32_t count = get_be32(bytes + 24);
+    size_t        offset = SS_SEQUENCE_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        if (length - offset < SS_SEQUENCE_FRAME_SIZE)
+            goto fail;
+
+        ss_delta_frame_t* const frame = push_frame(sequence);
+        if (!frame)
+            goto fail;
+        frame->keyframe = bytes[offset];
+        frame->tiles    = get_be32(bytes + offset + 1);
+        frame->length   = get_be32(bytes + offset + 5);
+        offset         += SS_SEQUENCE_FRAME_SIZE;
+
+        // keyframes have to be where appending would have put them
+        if (frame->keyframe != (i % sequence->keyframe_interval == 0) ||
+            length - offset < frame->length)
+            goto fail;
+
+        frame->data = malloc(frame->length ? frame->length : 1);
+        if (!frame->data)
+            goto fail;
+        memcpy(frame->data, bytes + offset, frame->length);
+        offset += frame->length;
+        sequence->count++;
+    }
+    if (offset != length)
+        goto fail;
+
+    // appending carries on from the last frame
+    if (count && ss_sequence_frame(sequence, count - 1, sequence->previous))
+        goto fail;
+    return 0;
+
+ fail:
+    ss_sequence_free(sequence);
+    return -1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "png_encoder.h"
+
+/*
+ * A sequence of same sized BGRA frames, stored as deltas.
+ *
+ * Frames are split into square tiles. Every `keyframe_interval` frames
+ * (starting with the first) the whole frame is stored; in between, only
+ * the tiles that changed since the frame before are stored. Either way
+ * the pixels are zlib compressed. Any frame can be rebuilt from the
+ * keyframe before it and the deltas that follow.
+ *
+ * A dumped sequence looks like this, with all numbers big endian:
+ *
+ *   "AXSQ" version width height tile keyframe_interval count  (u32 each)
+ *   then for each frame:
+ *     kind (u8, 1 for a keyframe) tiles (u32) length (u32) data
+ *
+ * where `tiles` is how many tiles are stored and a delta's data starts
+ * with a bit set of the changed tiles (row major, least significant bit
+ * first) before the compressed pixels.
+ *
+ * This file does not depend on Cocoa or Ruby.
+ */
+
+#define SS_SEQUENCE_VERSION 1
+
+typedef struct {
+    uint8_t  keyframe;
+    uint32_t tiles;   // tiles stored, all of them for a keyframe
+    uint8_t* data;
+    size_t   length;
+} ss_delta_frame_t;
+
+typedef struct {
+    uint32_t          width;
+    uint32_t          height;
+    uint32_t          tile;
+    uint32_t          keyframe_interval;
+    int               level;
+    uint32_t          tiles_x;
+    uint32_t          tiles_y;
+    ss_delta_frame_t* frames;
+    size_t            count;
+    size_t            capacity;
+    uint8_t*          previous;  // the last frame appended, packed
+    uint8_t*          scratch;   // changed tiles, gathered before compressing
+} ss_sequence_t;
+
+// Set up an empty sequence; level is a zlib level (0-9)
+int ss_sequence_init(ss_sequence_t* sequence,
+                     uint32_t width, uint32_t height,
+                     uint32_t tile, uint32_t keyframe_interval, int level);
+
+void ss_sequence_free(ss_sequence_t* sequence);
+
+// Add a frame of `width * height` BGRA pixels, `stride` bytes per row
+int ss_sequence_append(ss_sequence_t* sequence, const uint8_t* pixels, size_t stride);
+
+// Rebuild frame `index` into `out`, which is packed (`width * 4` bytes per row)
+int ss_sequence_frame(const ss_sequence_t* sequence, size_t index, uint8_t* out);
+
+// Total bytes of stored frame data, not counting container headers
+size_t ss_sequence_bytes(const ss_sequence_t* sequence);
+
+// Write the container format described above
+int ss_sequence_dump(const ss_sequence_t* sequence, ss_png_write_fn write, void* ctx);
+
+// Read the container format into an uninitialized sequence
+int ss_sequence_load(ss_sequence_t* sequence, const uint8_t* bytes, size_t length, int level);
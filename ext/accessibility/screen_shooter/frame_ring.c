@@ -0,0 +1,98 @@
+#include "frame_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int
+ss_ring_init(ss_ring_t* const ring, const size_t capacity)
+{
+    memset(ring, 0, sizeof(ss_ring_t));
+    ring->slots = calloc(capacity, sizeof(ss_slot_t));
+    if (!ring->slots)
+        return -1;
+    ring->capacity = capacity;
+    return 0;
+}
+
+void
+ss_ring_clear(ss_ring_t* const ring, const ss_ring_release_fn release)
+{
+    for (size_t i = 0; i < ring->capacity; i++) {
+        release(ring->slots[i].frame.buffer);
+        memset(&ring->slots[i], 0, sizeof(ss_slot_t));
+    }
+    ring->head    = 0;
+    ring->dropped = 0;
+    ring->failed  = 0;
+    ring->first   = 0;
+    ring->last    = 0;
+}
+
+void
+ss_ring_free(ss_ring_t* const ring, const ss_ring_release_fn release)
+{
+    if (ring->slots) {
+        ss_ring_clear(ring, release);
+        free(ring->slots);
+    }
+    release(ring->spare.buffer);
+    memset(ring, 0, sizeof(ss_ring_t));
+}
+
+void
+ss_ring_record(ss_ring_t* const ring, const unsigned long ticks, const int failed,
+               const double time)
+{
+    if (ticks > 1)
+        ring->dropped += ticks - 1;
+    if (failed) {
+        ring->failed++;
+        return;
+    }
+
+    ss_slot_t* const slot = &ring->slots[ring->head % ring->capacity];
+    const ss_frame_t  old = slot->frame;
+    slot->frame = ring->spare;
+    slot->time  = time;
+    ring->spare = old;
+    if (!ring->head)
+        ring->first = time;
+    ring->last = time;
+    ring->head++;
+}
+
+size_t
+ss_ring_count(const ss_ring_t* const ring)
+{
+    return (ring->head < ring->capacity ? (size_t)ring->head : ring->capacity);
+}
+
+const ss_slot_t*
+ss_ring_newest(const ss_ring_t* const ring, const size_t count, const size_t index)
+{
+    return &ring->slots[(ring->head - count + index) % ring->capacity];
+}
+
+double
+ss_ring_fps(const ss_ring_t* const ring)
+{
+    const double elapsed = ring->last - ring->first;
+    return (ring->head > 1 && elapsed > 0 ? (double)(ring->head - 1) / elapsed : 0.0);
+}
+
+size_t
+ss_ring_bytes(const ss_ring_t* const ring)
+{
+    size_t bytes = ring->spare.buffer.capacity;
+    for (size_t i = 0; i < ring->capacity; i++)
+        bytes += ring->slots[i].frame.buffer.capacity;
+    return bytes;
+}
+
+uint64_t
+ss_ring_interval(const double fps)
+{
+    // a rate so low that the interval overflows just never comes due
+    const double interval = 1e9 / fps;
+    return (interval < (double)INT64_MAX ? (uint64_t)interval : (uint64_t)INT64_MAX);
+}
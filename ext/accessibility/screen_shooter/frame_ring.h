@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The ring of frames behind a recorder, with its drop and frame rate
+ * bookkeeping.
+ *
+ * A frame is captured into the spare and then swapped into the ring,
+ * so the oldest frame's buffer becomes the next spare and nothing is
+ * copied or allocated while the ring is locked. The ring does no
+ * locking of its own, and it does not allocate pixel buffers either:
+ * they come from whoever fills the spare, and go back through the
+ * release function given to ss_ring_clear and ss_ring_free.
+ *
+ * This file does not depend on Cocoa or Ruby.
+ */
+
+// Frames per second a ring can be recorded at; one frame a millisecond
+// is already far more than any screen can be captured at
+#define SS_RING_MAX_FPS 1000
+
+typedef struct {
+    uint8_t* bytes;
+    size_t   capacity;
+} ss_buffer_t;
+
+// A BGRA (premultiplied alpha, little endian) frame in a buffer
+typedef struct {
+    ss_buffer_t buffer;
+    size_t      width;
+    size_t      height;
+    size_t      stride;
+} ss_frame_t;
+
+typedef struct {
+    ss_frame_t frame;
+    double     time;
+} ss_slot_t;
+
+typedef struct {
+    ss_slot_t* slots;
+    size_t     capacity;
+    ss_frame_t spare;    // where the next frame is captured
+    uint64_t   head;     // frames captured, slots[head % capacity] is next
+    uint64_t   dropped;  // timer ticks missed because a capture ran long
+    uint64_t   failed;   // captures that did not work
+    double     first;    // time of the first frame in this recording
+    double     last;     // time of the latest frame
+} ss_ring_t;
+
+// Gives back a buffer that the ring no longer holds
+typedef void (*ss_ring_release_fn)(ss_buffer_t buffer);
+
+// Set up an empty ring of `capacity` slots; returns 0 on success
+int ss_ring_init(ss_ring_t* ring, size_t capacity);
+
+// Release every frame in the ring and start the counts over; the spare
+// is kept for the next recording
+void ss_ring_clear(ss_ring_t* ring, ss_ring_release_fn release);
+
+// Release every frame, the spare included, and the ring itself
+void ss_ring_free(ss_ring_t* ring, ss_ring_release_fn release);
+
+/*
+ * Account for one timer tick at `time`
+ *
+ * `ticks` is how many ticks came due since the last one, so anything
+ * over one was dropped. Unless the capture failed, the spare goes into
+ * the ring as the newest frame.
+ */
+void ss_ring_record(ss_ring_t* ring, unsigned long ticks, int failed, double time);
+
+// How many frames are in the ring
+size_t ss_ring_count(const ss_ring_t* ring);
+
+// Of the newest `count` frames, the `index`th oldest
+const ss_slot_t* ss_ring_newest(const ss_ring_t* ring, size_t count, size_t index);
+
+// Frames per second sustained between the first and latest frames
+double ss_ring_fps(const ss_ring_t* ring);
+
+// Bytes held for frames, the spare included
+size_t ss_ring_bytes(const ss_ring_t* ring);
+
+// Nanoseconds between frames at `fps`, which must be in (0, SS_RING_MAX_FPS]
+uint64_t ss_ring_interval(double fps);
@@ -0,0 +1,322 @@
+#include "image_diff.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SS_DIFF_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define SS_DIFF_ARM 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * The SIMD kernels work on a block of pixels at a time and build a bit
+ * set with one bit per mismatched pixel; this folds that into the row
+ * count and first/last positions. Whatever is left over at the end of
+ * the row goes through the scalar kernel.
+ */
+static inline
+void
+diff_block_bits(const uint32_t bits, const uint32_t x,
+                uint32_t* const count, uint32_t* const first, uint32_t* const last)
+{
+    if (!bits)
+        return;
+    if (!*count)
+        *first = x + (uint32_t)__builtin_ctz(bits);
+    *last   = x + 31 - (uint32_t)__builtin_clz(bits);
+    *count += (uint32_t)__builtin_popcount(bits);
+}
+
+static inline
+int
+diff_pixel(const uint8_t* const a, const uint8_t* const b, const uint8_t tolerance)
+{
+    for (int channel = 0; channel < 4; channel++) {
+        const int delta = a[channel] - b[channel];
+        if (delta > tolerance || -delta > tolerance)
+            return 1;
+    }
+    return 0;
+}
+
+static
+uint32_t
+diff_row_scalar(const uint8_t* const a, const uint8_t* const b, const uint32_t width,
+                const uint8_t tolerance, uint8_t* const mask,
+                uint32_t* const first, uint32_t* const last)
+{
+    uint32_t count = 0;
+    for (uint32_t x = 0; x < width; x++) {
+        const int differs = diff_pixel(a + x * 4, b + x * 4, tolerance);
+        if (mask)
+            mask[x] = (differs ? 0xff : 0);
+        if (!differs)
+            continue;
+        if (!count)
+            *first = x;
+        *last = x;
+        count++;
+    }
+    return count;
+}
+
+// Finish off a row after a SIMD kernel has done the first `x` pixels
+static inline
+uint32_t
+diff_row_tail(const uint8_t* const a, const uint8_t* const b,
+              const uint32_t x, const uint32_t width,
+              const uint8_t tolerance, uint8_t* const mask,
+              uint32_t count, uint32_t* const first, uint32_t* const last)
+{
+    if (x == width)
+        return count;
+
+    uint32_t tail_first = 0, tail_last = 0;
+    const uint32_t tail = diff_row_scalar(a + x * 4, b + x * 4, width - x, tolerance,
+                                          (mask ? mask + x : NULL), &tail_first, &tail_last);
+    if (tail) {
+        if (!count)
+            *first = x + tail_first;
+        *last = x + tail_last;
+    }
+    return count + tail;
+}
+
+
+#ifdef SS_DIFF_X86
+
+// 0xffffffff for each of the 4 pixels that mismatch
+static inline
+__m128i
+diff_sse2_pixels(const uint8_t* const a, const uint8_t* const b, const __m128i tolerance)
+{
+    const __m128i pa = _mm_loadu_si128((const __m128i*)a);
+    const __m128i pb = _mm_loadu_si128((const __m128i*)b);
+    const __m128i delta = _mm_or_si128(_mm_subs_epu8(pa, pb), _mm_subs_epu8(pb, pa));
+    const __m128i  over = _mm_subs_epu8(delta, tolerance);
+    const __m128i  same = _mm_cmpeq_epi32(over, _mm_setzero_si128());
+    return _mm_xor_si128(same, _mm_set1_epi32(-1));
+}
+
+static
+uint32_t
+diff_row_sse2(const uint8_t* const a, const uint8_t* const b, const uint32_t width,
+              const uint8_t tolerance, uint8_t* const mask,
+              uint32_t* const first, uint32_t* const last)
+{
+    const __m128i tol = _mm_set1_epi8((char)tolerance);
+    uint32_t    count = 0;
+    uint32_t        x = 0;
+
+    // 16 pixels at a time, narrowed down to one byte each
+    for (; x + 16 <= width; x += 16) {
+        const uint8_t* const pa = a + x * 4;
+        const uint8_t* const pb = b + x * 4;
+        const __m128i lo = _mm_packs_epi32(diff_sse2_pixels(pa,      pb,      tol),
+                                           diff_sse2_pixels(pa + 16, pb + 16, tol));
+        const __m128i hi = _mm_packs_epi32(diff_sse2_pixels(pa + 32, pb + 32, tol),
+                                           diff_sse2_pixels(pa + 48, pb + 48, tol));
+        const __m128i bytes = _mm_packs_epi16(lo, hi);
+        if (mask)
+            _mm_storeu_si128((__m128i*)(mask + x), bytes);
+        diff_block_bits((uint32_t)_mm_movemask_epi8(bytes), x, &count, first, last);
+    }
+
+    return diff_row_tail(a, b, x, width, tolerance, mask, count, first, last);
+}
+
+__attribute__((target("avx2")))
+static inline
+__m256i
+diff_avx2_pixels(const uint8_t* const a, const uint8_t* const b, const __m256i tolerance)
+{
+    const __m256i pa = _mm256_loadu_si256((const __m256i*)a);
+    const __m256i pb = _mm256_loadu_si256((const __m256i*)b);
+    const __m256i delta = _mm256_or_si256(_mm256_subs_epu8(pa, pb), _mm256_subs_epu8(pb, pa));
+    const __m256i  over = _mm256_subs_epu8(delta, tolerance);
+    const __m256i  same = _mm256_cmpeq_epi32(over, _mm256_setzero_si256());
+    return _mm256_xor_si256(same, _mm256_set1_epi32(-1));
+}
+
+__attribute__((target("avx2")))
+static
+uint32_t
+diff_row_avx2(const uint8_t* const a, const uint8_t* const b, const uint32_t width,
+              const uint8_t tolerance, uint8_t* const mask,
+              uint32_t* const first, uint32_t* const last)
+{
+    const __m256i tol = _mm256_set1_epi8((char)tolerance);
+    // the packs work within 128-bit lanes, this puts the pixels back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t    count = 0;
+    uint32_t        x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        const uint8_t* const pa = a + x * 4;
+        const uint8_t* const pb = b + x * 4;
+        const __m256i lo = _mm256_packs_epi32(diff_avx2_pixels(pa,      pb,      tol),
+                                              diff_avx2_pixels(pa + 32, pb + 32, tol));
+        const __m256i hi = _mm256_packs_epi32(diff_avx2_pixels(pa + 64, pb + 64, tol),
+                                              diff_avx2_pixels(pa + 96, pb + 96, tol));
+        const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(lo, hi), order);
+        if (mask)
+            _mm256_storeu_si256((__m256i*)(mask + x), bytes);
+        diff_block_bits((uint32_t)_mm256_movemask_epi8(bytes), x, &count, first, last);
+    }
+
+    return diff_row_tail(a, b, x, width, tolerance, mask, count, first, last);
+}
+
+#endif
+
+
+#ifdef SS_DIFF_ARM
+
+// 0xff for each of the 4 pixels that mismatch, narrowed to 16 bits each
+static inline
+uint16x4_t
+diff_neon_pixels(const uint8_t* const a, const uint8_t* const b, const uint8x16_t tolerance)
+{
+    const uint8x16_t over = vcgtq_u8(vabdq_u8(vld1q_u8(a), vld1q_u8(b)), tolerance);
+    const uint32x4_t wide = vreinterpretq_u32_u8(over);
+    return vmovn_u32(vtstq_u32(wide, wide));
+}
+
+static
+uint32_t
+diff_row_neon(const uint8_t* const a, const uint8_t* const b, const uint32_t width,
+              const uint8_t tolerance, uint8_t* const mask,
+              uint32_t* const first, uint32_t* const last)
+{
+    const uint8x16_t tol = vdupq_n_u8(tolerance);
+    uint32_t       count = 0;
+    uint32_t           x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        const uint8_t* const pa = a + x * 4;
+        const uint8_t* const pb = b + x * 4;
+        const uint16x8_t lo = vcombine_u16(diff_neon_pixels(pa,      pb,      tol),
+                                           diff_neon_pixels(pa + 16, pb + 16, tol));
+        const uint16x8_t hi = vcombine_u16(diff_neon_pixels(pa + 32, pb + 32, tol),
+                                           diff_neon_pixels(pa + 48, pb + 48, tol));
+        const uint8x16_t bytes = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+        if (mask)
+            vst1q_u8(mask + x, bytes);
+        if (!vmaxvq_u8(bytes))
+            continue;
+
+        // NEON has no movemask, so weight each lane by its bit and add up
+        static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                             1, 2, 4, 8, 16, 32, 64, 128 };
+        const uint8x16_t bits = vandq_u8(bytes, vld1q_u8(weights));
+        const uint32_t    set = (uint32_t)vaddv_u8(vget_low_u8(bits)) |
+                                ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+        diff_block_bits(set, x, &count, first, last);
+    }
+
+    return diff_row_tail(a, b, x, width, tolerance, mask, count, first, last);
+}
+
+#endif
+
+
+int
+ss_diff_kernel_available(const ss_diff_kernel_t kernel)
+{
+    switch (kernel) {
+    case SS_DIFF_AUTO:
+    case SS_DIFF_SCALAR:
+        return 1;
+#ifdef SS_DIFF_X86
+    case SS_DIFF_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case SS_DIFF_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef SS_DIFF_ARM
+    case SS_DIFF_NEON:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+ss_diff_kernel_t
+ss_diff_best_kernel(const ss_diff_kernel_t kernel)
+{
+    if (kernel != SS_DIFF_AUTO)
+        return kernel;
+    if (ss_diff_kernel_available(SS_DIFF_AVX2))
+        return SS_DIFF_AVX2;
+    if (ss_diff_kernel_available(SS_DIFF_SSE2))
+        return SS_DIFF_SSE2;
+    if (ss_diff_kernel_available(SS_DIFF_NEON))
+        return SS_DIFF_NEON;
+    return SS_DIFF_SCALAR;
+}
+
+ss_diff_row_fn
+ss_diff_row_kernel(ss_diff_kernel_t kernel)
+{
+    kernel = ss_diff_best_kernel(kernel);
+    if (!ss_diff_kernel_available(kernel))
+        return NULL;
+
+    switch (kernel) {
+#ifdef SS_DIFF_X86
+    case SS_DIFF_SSE2:
+        return diff_row_sse2;
+    case SS_DIFF_AVX2:
+        return diff_row_avx2;
+#endif
+#ifdef SS_DIFF_ARM
+    case SS_DIFF_NEON:
+        return diff_row_neon;
+#endif
+    default:
+        return diff_row_scalar;
+    }
+}
+
+int
+ss_diff(const uint8_t* const a, const size_t stride_a,
+        const uint8_t* const b, const size_t stride_b,
+        const uint32_t width, const uint32_t height, const uint8_t tolerance,
+        uint8_t* const mask, const size_t mask_stride,
+        const ss_diff_kernel_t kernel, ss_diff_t* const result)
+{
+    const ss_diff_row_fn diff_row = ss_diff_row_kernel(kernel);
+    memset(result, 0, sizeof(ss_diff_t));
+    if (!diff_row)
+        return -1;
+
+    result->min_x = UINT32_MAX;
+    result->min_y = UINT32_MAX;
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint32_t first = 0, last = 0;
+        const uint32_t count = diff_row(a + y * stride_a, b + y * stride_b, width, tolerance,
+                                        (mask ? mask + y * mask_stride : NULL),
+                                        &first, &last);
+        if (!count)
+            continue;
+
+        result->mismatches += count;
+        if (result->min_y == UINT32_MAX)
+            result->min_y = y;
+        result->max_y = y;
+        if (first < result->min_x)
+            result->min_x = first;
+        if (last > result->max_x)
+            result->max_x = last;
+    }
+
+    if (!result->mismatches)
+        memset(result, 0, sizeof(ss_diff_t));
+    return 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Pixel by pixel comparison of two 32-bit BGRA images.
+ *
+ * A pixel is a mismatch when any of its four channels differs by more
+ * than the tolerance. Rows are compared by a kernel; the SIMD kernels
+ * must give exactly the same answers as the scalar one, which is kept
+ * around as the reference.
+ *
+ * This file does not depend on Cocoa or Ruby.
+ */
+
+typedef enum {
+    SS_DIFF_AUTO = 0,  // the fastest kernel this CPU supports
+    SS_DIFF_SCALAR,
+    SS_DIFF_SSE2,
+    SS_DIFF_AVX2,
+    SS_DIFF_NEON
+} ss_diff_kernel_t;
+
+typedef struct {
+    uint64_t mismatches;
+    // bounding box of the mismatches, inclusive; only valid when there are any
+    uint32_t min_x;
+    uint32_t min_y;
+    uint32_t max_x;
+    uint32_t max_y;
+} ss_diff_t;
+
+/*
+ * Compare one row of `width` pixels and return how many mismatched
+ *
+ * When there are mismatches, `first` and `last` are set to the x of the
+ * first and last one. If `mask` is not NULL, it gets one byte per pixel,
+ * 0xff for a mismatch and 0 otherwise.
+ */
+typedef uint32_t (*ss_diff_row_fn)(const uint8_t* a, const uint8_t* b, uint32_t width,
+                                   uint8_t tolerance, uint8_t* mask,
+                                   uint32_t* first, uint32_t* last);
+
+// Whether the kernel can run on this CPU; the scalar kernel always can
+int ss_diff_kernel_available(ss_diff_kernel_t kernel);
+
+// The row function for a kernel, or NULL if it is not available
+ss_diff_row_fn ss_diff_row_kernel(ss_diff_kernel_t kernel);
+
+// Resolve SS_DIFF_AUTO to a real kernel; other kernels are returned as is
+ss_diff_kernel_t ss_diff_best_kernel(ss_diff_kernel_t kernel);
+
+// Compare two images of the same size; `mask` may be NULL. Returns 0 on
+// success, or -1 if the kernel is not available.
+int ss_diff(const uint8_t* a, size_t stride_a,
+            const uint8_t* b, size_t stride_b,
+            uint32_t width, uint32_t height, uint8_t tolerance,
+            uint8_t* mask, size_t mask_stride,
+            ss_diff_kernel_t kernel, ss_diff_t* result);
@@ -0,0 +1,480 @@
+#include "png_encoder.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SS_PNG_OUT_SIZE (64 * 1024)
+
+static const uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+static
+void
+put_be32(uint8_t* const bytes, const uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)(value >> 16);
+    bytes[2] = (uint8_t)(value >> 8);
+    bytes[3] = (uint8_t)value;
+}
+
+int
+ss_png_write_chunk(const ss_png_write_fn write, void* const ctx,
+                   const char type[4], const uint8_t* const data, const size_t length)
+{
+    uint8_t header[8];
+    put_be32(header, (uint32_t)length);
+    memcpy(header + 4, type, 4);
+
+    uLong crc = crc32(0, header + 4, 4);
+    if (length)
+        crc = crc32(crc, data, (uInt)length);
+
+    uint8_t trailer[4];
+    put_be32(trailer, (uint32_t)crc);
+
+    if (write(ctx, header, sizeof(header)))
+        return -1;
+    if (length && write(ctx, data, length))
+        return -1;
+    return write(ctx, trailer, sizeof(trailer));
+}
+
+int
+ss_png_write_fd(void* const ctx, const void* const bytes, const size_t length)
+{
+    const int          fd = *(int*)ctx;
+    const uint8_t* cursor = bytes;
+    size_t           left = length;
+
+    while (left) {
+        const ssize_t written = write(fd, cursor, left);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        cursor += written;
+        left   -= (size_t)written;
+    }
+    return 0;
+}
+
+int
+ss_png_write_memory(void* const ctx, const void* const bytes, const size_t length)
+{
+    ss_png_memory_t* const memory = ctx;
+
+    if (!length)
+        return 0;
+    if (length > SIZE_MAX - memory->length)
+        return -1;
+
+    if (memory->length + length > memory->capacity) {
+        size_t capacity = (memory->capacity ? memory->capacity : 64 * 1024);
+        while (capacity < memory->length + length)
+            capacity *= 2;
+        uint8_t* const grown = realloc(memory->bytes, capacity);
+        if (!grown)
+            return -1;
+        memory->bytes    = grown;
+        memory->capacity = capacity;
+    }
+
+    memcpy(memory->bytes + memory->length, bytes, length);
+    memory->length += length;
+    return 0;
+}
+
+// Undo premultiplied alpha for one colour channel
+static
+uint8_t
+unpremultiply(const uint8_t value, const uint8_t alpha)
+{
+    if (alpha == 255 || alpha == 0)
+        return value;
+    const unsigned result = ((unsigned)value * 255 + alpha / 2) / alpha;
+    return (uint8_t)(result > 255 ? 255 : result);
+}
+
+void
+ss_png_encode_row(uint8_t* const out, uint8_t* const scratch, const uint8_t* const bgra,
+                  const uint32_t width, const int channels, const ss_png_filter_t filter)
+{
+    uint8_t* const raw = (filter == SS_PNG_FILTER_NONE ? out + 1 : scratch);
+
+    if (channels == 4) {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* const px = bgra + x * 4;
+            uint8_t* const      dst = raw + x * 4;
+            dst[0] = unpremultiply(px[2], px[3]);
+            dst[1] = unpremultiply(px[1], px[3]);
+            dst[2] = unpremultiply(px[0], px[3]);
+            dst[3] = px[3];
+        }
+    }
+    else {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* const px = bgra + x * 4;
+            uint8_t* const      dst = raw + x * 3;
+            dst[0] = unpremultiply(px[2], px[3]);
+            dst[1] = unpremultiply(px[1], px[3]);
+            dst[2] = unpremultiply(px[0], px[3]);
+        }
+    }
+
+    out[0] = (uint8_t)filter;
+    if (filter == SS_PNG_FILTER_SUB) {
+        const size_t bpp    = (size_t)channels;
+        const size_t length = (size_t)width * bpp;
+        memcpy(out + 1, raw, bpp < length ? bpp : length);
+        for (size_t i = bpp; i < length; i++)
+            out[1 + i] = (uint8_t)(raw[i] - raw[i - bpp]);
+    }
+}
+
+static
+int
+flush_idat(ss_png_t* const png)
+{
+    const size_t length = png->out_size - png->zs.avail_out;
+    if (length &&
+        ss_png_write_chunk(png->write, png->ctx, "IDAT", png->out, length))
+        return -1;
+    png->zs.next_out  = png->out;
+    png->zs.avail_out = (uInt)png->out_size;
+    return 0;
+}
+
+static
+void
+free_png(ss_png_t* const png)
+{
+    free(png->row);
+    free(png->scratch);
+    free(png->out);
+    png->row     = NULL;
+    png->scratch = NULL;
+    png->out     = NULL;
+}
+
+// The signature and IHDR chunk
+static
+int
+write_header(const ss_png_write_fn write, void* const ctx,
+             const uint32_t width, const uint32_t height, const int channels)
+{
+    uint8_t ihdr[13];
+    put_be32(ihdr, width);
+    put_be32(ihdr + 4, height);
+    ihdr[8]  = 8;                        // bit depth
+    ihdr[9]  = (channels == 4 ? 6 : 2);  // RGBA or RGB
+    ihdr[10] = 0;                        // deflate
+    ihdr[11] = 0;                        // adaptive filtering
+    ihdr[12] = 0;                        // no interlace
+
+    if (write(ctx, png_signature, sizeof(png_signature)))
+        return -1;
+    return ss_png_write_chunk(write, ctx, "IHDR", ihdr, sizeof(ihdr));
+}
+
+// screen shots are full of flat runs, so favour run length matches
+static
+int
+deflate_strategy(const ss_png_filter_t filter)
+{
+    return (filter == SS_PNG_FILTER_NONE ? Z_DEFAULT_STRATEGY : Z_FILTERED);
+}
+
+int
+ss_png_begin(ss_png_t* const png,
+             const ss_png_write_fn write, void* const ctx,
+             const uint32_t width, const uint32_t height,
+             const int channels, const int level, const ss_png_filter_t filter)
+{
+    memset(png, 0, sizeof(ss_png_t));
+    if (!width || !height || (channels != 3 && channels != 4) ||
+        level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)
+        return -1;
+
+    png->write    = write;
+    png->ctx      = ctx;
+    png->width    = width;
+    png->height   = height;
+    png->channels = channels;
+    png->filter   = filter;
+    png->out_size = SS_PNG_OUT_SIZE;
+    png->row      = malloc(1 + (size_t)width * (size_t)channels);
+    png->scratch  = malloc((size_t)width * (size_t)channels);
+    png->out      = malloc(png->out_size);
+    if (!png->row || !png->scratch || !png->out) {
+        free_png(png);
+        return -1;
+    }
+
+    if (deflateInit2(&png->zs, level, Z_DEFLATED, 15, 8, deflate_strategy(filter)) != Z_OK) {
+        free_png(png);
+        return -1;
+    }
+    png->zs.next_out  = png->out;
+    png->zs.avail_out = (uInt)png->out_size;
+
+    if (write_header(write, ctx, width, height, channels)) {
+        ss_png_abort(png);
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+ss_png_write_row(ss_png_t* const png, const uint8_t* const bgra)
+{
+    if (png->failed || png->rows >= png->height)
+        return -1;
+
+    ss_png_encode_row(png->row, png->scratch, bgra, png->width, png->channels, png->filter);
+    png->zs.next_in  = png->row;
+    png->zs.avail_in = (uInt)(1 + (size_t)png->width * (size_t)png->channels);
+
+    while (png->zs.avail_in) {
+        if (deflate(&png->zs, Z_NO_FLUSH) == Z_STREAM_ERROR) {
+            png->failed = 1;
+            return -1;
+        }
+        if (!png->zs.avail_out && flush_idat(png)) {
+            png->failed = 1;
+            return -1;
+        }
+    }
+
+    png->rows++;
+    return 0;
+}
+
+int
+ss_png_end(ss_png_t* const png)
+{
+    int result = (png->failed || png->rows != png->height ? -1 : 0);
+
+    while (!result) {
+        const int status = deflate(&png->zs, Z_FINISH);
+        if (status == Z_STREAM_ERROR) {
+            result = -1;
+        }
+        else if (status == Z_STREAM_END) {
+            result = flush_idat(png);
+            break;
+        }
+        else if (!png->zs.avail_out) {
+            result = flush_idat(png);
+        }
+    }
+
+    if (!result)
+        result = ss_png_write_chunk(png->write, png->ctx, "IEND", NULL, 0);
+
+    deflateEnd(&png->zs);
+    free_png(png);
+    return result;
+}
+
+void
+ss_png_abort(ss_png_t* const png)
+{
+    deflateEnd(&png->zs);
+    free_png(png);
+}
+
+int
+ss_png_encode(const ss_png_write_fn write, void* const ctx,
+              const uint8_t* const pixels,
+              const uint32_t width, const uint32_t height, const size_t stride,
+              const int channels, const int level, const ss_png_filter_t filter)
+{
+    ss_png_t png;
+    if (ss_png_begin(&png, write, ctx, width, height, channels, level, filter))
+        return -1;
+
+    for (uint32_t y = 0; y < height; y++) {
+        if (ss_png_write_row(&png, pixels + (size_t)y * stride)) {
+            ss_png_abort(&png);
+            return -1;
+        }
+    }
+
+    return ss_png_end(&png);
+}
+
+
+size_t
+ss_png_split_bands(ss_png_band_t* const bands, const size_t count,
+                   const uint8_t* const pixels,
+                   const uint32_t width, const uint32_t height, const size_t stride,
+                   const int channels, const int level, const ss_png_filter_t filter)
+{
+    if (!count || !height)
+        return 0;
+
+    // very short bands cost more in flushes than they win back
+    uint32_t rows = (uint32_t)((height + count - 1) / count);
+    if (rows < SS_PNG_MIN_BAND_ROWS)
+        rows = SS_PNG_MIN_BAND_ROWS;
+
+    size_t used = 0;
+    for (uint32_t y = 0; y < height; y += rows, used++) {
+        ss_png_band_t* const band = &bands[used];
+        memset(band, 0, sizeof(ss_png_band_t));
+        band->pixels   = pixels + (size_t)y * stride;
+        band->stride   = stride;
+        band->width    = width;
+        band->rows     = (height - y < rows ? height - y : rows);
+        band->channels = channels;
+        band->level    = level;
+        band->filter   = filter;
+        band->last     = (y + band->rows == height);
+        band->result   = -1;
+    }
+    return used;
+}
+
+void
+ss_png_encode_band(ss_png_band_t* const band)
+{
+    const size_t row_size = 1 + (size_t)band->width * (size_t)band->channels;
+    uint8_t* const    row = malloc(row_size);
+    uint8_t* const  inner = malloc(row_size - 1);
+    uint8_t* const    out = malloc(SS_PNG_OUT_SIZE);
+    z_stream           zs;
+    memset(&zs, 0, sizeof(z_stream));
+    band->result = -1;
+    band->adler  = adler32(0, NULL, 0);
+
+    // a raw stream, the zlib header and checksum are written around all the bands
+    if (!row || !inner || !out ||
+        deflateInit2(&zs, band->level, Z_DEFLATED, -15, 8, deflate_strategy(band->filter)) != Z_OK) {
+        free(row);
+        free(inner);
+        free(out);
+        return;
+    }
+
+    int failed = 0;
+    for (uint32_t y = 0; y <= band->rows && !failed; y++) {
+        // after the last row, end on a byte boundary so the next band can follow
+        int flush = Z_NO_FLUSH;
+        if (y == band->rows) {
+            flush       = (band->last ? Z_FINISH : Z_SYNC_FLUSH);
+            zs.avail_in = 0;
+        }
+        else {
+            ss_png_encode_row(row, inner, band->pixels + (size_t)y * band->stride,
+                              band->width, band->channels, band->filter);
+            band->adler   = adler32(band->adler, row, (uInt)row_size);
+            band->length += row_size;
+            zs.next_in    = row;
+            zs.avail_in   = (uInt)row_size;
+        }
+
+        do {
+            zs.next_out  = out;
+            zs.avail_out = SS_PNG_OUT_SIZE;
+            const int status = deflate(&zs, flush);
+            if (status == Z_STREAM_ERROR ||
+                ss_png_write_memory(&band->out, out, SS_PNG_OUT_SIZE - zs.avail_out)) {
+                failed = 1;
+                break;
+            }
+        } while (!zs.avail_out);
+    }
+
+    deflateEnd(&zs);
+    free(row);
+    free(inner);
+    free(out);
+    if (!failed)
+        band->result = 0;
+}
+
+// Collects IDAT data across bands so that chunks come out full sized
+typedef struct {
+    ss_png_write_fn write;
+    void*           ctx;
+    uint8_t*        bytes;
+    size_t          length;
+} idat_writer_t;
+
+static
+int
+idat_flush(idat_writer_t* const idat)
+{
+    const size_t length = idat->length;
+    idat->length = 0;
+    if (!length)
+        return 0;
+    return ss_png_write_chunk(idat->write, idat->ctx, "IDAT", idat->bytes, length);
+}
+
+static
+int
+idat_append(idat_writer_t* const idat, const uint8_t* bytes, size_t length)
+{
+    while (length) {
+        const size_t room  = SS_PNG_OUT_SIZE - idat->length;
+        const size_t taken = (length < room ? length : room);
+        memcpy(idat->bytes + idat->length, bytes, taken);
+        idat->length += taken;
+        bytes        += taken;
+        length       -= taken;
+        if (idat->length == SS_PNG_OUT_SIZE && idat_flush(idat))
+            return -1;
+    }
+    return 0;
+}
+
+int
+ss_png_write_bands(const ss_png_write_fn write, void* const ctx,
+                   const uint32_t width, const uint32_t height, const int channels,
+                   const ss_png_band_t* const bands, const size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        if (bands[i].result)
+            return -1;
+
+    idat_writer_t idat = { write, ctx, malloc(SS_PNG_OUT_SIZE), 0 };
+    if (!idat.bytes || write_header(write, ctx, width, height, channels)) {
+        free(idat.bytes);
+        return -1;
+    }
+
+    // zlib header for a 32K window; the level bits are only a hint
+    static const uint8_t zlib_header[2] = { 0x78, 0x9c };
+    int result = idat_append(&idat, zlib_header, sizeof(zlib_header));
+
+    uLong adler = adler32(0, NULL, 0);
+    for (size_t i = 0; i < count && !result; i++) {
+        adler  = adler32_combine(adler, bands[i].adler, (z_off_t)bands[i].length);
+        result = idat_append(&idat, bands[i].out.bytes, bands[i].out.length);
+    }
+
+    uint8_t trailer[4];
+    put_be32(trailer, (uint32_t)adler);
+    if (!result)
+        result = idat_append(&idat, trailer, sizeof(trailer));
+    if (!result)
+        result = idat_flush(&idat);
+    free(idat.bytes);
+    if (!result)
+        result = ss_png_write_chunk(write, ctx, "IEND", NULL, 0);
+    return result;
+}
+
+void
+ss_png_free_bands(ss_png_band_t* const bands, const size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        free(bands[i].out.bytes);
+        memset(&bands[i].out, 0, sizeof(ss_png_memory_t));
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+/*
+ * A PNG encoder that takes one row of pixels at a time and hands out
+ * compressed IDAT chunks as soon as zlib produces them, so the whole
+ * encoded image never has to be held in memory.
+ *
+ * Rows are given as 32-bit BGRA with premultiplied alpha, which is
+ * what CoreGraphics gives us for kCGImageAlphaPremultipliedFirst with
+ * kCGBitmapByteOrder32Little. They are written out as 8-bit RGB or RGBA.
+ *
+ * This file does not depend on Cocoa or Ruby.
+ */
+
+// Sink for encoded bytes; returns 0 on success
+typedef int (*ss_png_write_fn)(void* ctx, const void* bytes, size_t length);
+
+typedef enum {
+    SS_PNG_FILTER_NONE = 0,
+    SS_PNG_FILTER_SUB  = 1
+} ss_png_filter_t;
+
+typedef struct {
+    z_stream        zs;
+    ss_png_write_fn write;
+    void*           ctx;
+    uint8_t*        row;      // filter type byte followed by one encoded row
+    uint8_t*        scratch;  // the same row before filtering
+    uint8_t*        out;      // deflate output, written as an IDAT chunk when full
+    size_t          out_size;
+    uint32_t        width;
+    uint32_t        height;
+    uint32_t        rows;     // rows written so far
+    int             channels; // 3 for RGB, 4 for RGBA
+    ss_png_filter_t filter;
+    int             failed;
+} ss_png_t;
+
+// Write the PNG header and get ready for rows; level is a zlib level (0-9)
+int ss_png_begin(ss_png_t* png,
+                 ss_png_write_fn write, void* ctx,
+                 uint32_t width, uint32_t height,
+                 int channels, int level, ss_png_filter_t filter);
+
+// Encode the next row, which must be `width` BGRA pixels
+int ss_png_write_row(ss_png_t* png, const uint8_t* bgra);
+
+// Flush the compressed data and write the trailer; frees everything
+int ss_png_end(ss_png_t* png);
+
+// Free everything without finishing the image, after an error
+void ss_png_abort(ss_png_t* png);
+
+// Write a PNG chunk with the given type and data
+int ss_png_write_chunk(ss_png_write_fn write, void* ctx,
+                       const char type[4], const uint8_t* data, size_t length);
+
+// Convert one BGRA row to RGB(A) and apply a filter, into `out` (which
+// has room for the filter type byte plus the row)
+void ss_png_encode_row(uint8_t* out, uint8_t* scratch, const uint8_t* bgra,
+                       uint32_t width, int channels, ss_png_filter_t filter);
+
+// An ss_png_write_fn for file descriptors; ctx points at an int
+int ss_png_write_fd(void* ctx, const void* bytes, size_t length);
+
+// A growable in memory sink; start it zeroed and free(bytes) when done
+typedef struct {
+    uint8_t* bytes;
+    size_t   length;
+    size_t   capacity;
+} ss_png_memory_t;
+
+// An ss_png_write_fn that appends to an ss_png_memory_t
+int ss_png_write_memory(void* ctx, const void* bytes, size_t length);
+
+// Encode a whole BGRA image, `stride` bytes per row, in one go
+int ss_png_encode(ss_png_write_fn write, void* ctx,
+                  const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+                  int channels, int level, ss_png_filter_t filter);
+
+/*
+ * Encoding in bands, so that each band can be compressed on its own
+ * thread. Each band is a separate raw deflate stream that ends on a
+ * byte boundary (the last one finishes the stream), which can just be
+ * put one after the other. The Adler-32 checksums of the bands are
+ * combined for the zlib trailer. Bands cost a few bytes each.
+ */
+
+#define SS_PNG_MIN_BAND_ROWS 16
+
+typedef struct {
+    const uint8_t*  pixels;   // first row of the band
+    size_t          stride;
+    uint32_t        width;
+    uint32_t        rows;
+    int             channels;
+    int             level;
+    ss_png_filter_t filter;
+    int             last;     // finishes the deflate stream
+    ss_png_memory_t out;      // compressed band
+    uLong           adler;    // of the filtered rows that went in
+    size_t          length;   // how many bytes went in
+    int             result;
+} ss_png_band_t;
+
+// Split an image into at most `count` bands; returns how many were used
+size_t ss_png_split_bands(ss_png_band_t* bands, size_t count,
+                          const uint8_t* pixels, uint32_t width, uint32_t height, size_t stride,
+                          int channels, int level, ss_png_filter_t filter);
+
+// Compress one band; safe to call for different bands at the same time
+void ss_png_encode_band(ss_png_band_t* band);
+
+// Write a whole PNG made out of encoded bands, in order
+int ss_png_write_bands(ss_png_write_fn write, void* ctx,
+                       uint32_t width, uint32_t height, int channels,
+                       const ss_png_band_t* bands, size_t count);
+
+// Free the compressed data held by the bands
+void ss_png_free_bands(ss_png_band_t* bands, size_t count);
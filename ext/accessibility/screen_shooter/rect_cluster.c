@@ -0,0 +1,76 @@
+#include "rect_cluster.h"
+
+#include <math.h>
+
+static
+int
+is_empty(const ss_rect_t* const rect)
+{
+    return !(rect->width > 0 && rect->height > 0 && isfinite(rect->x) && isfinite(rect->y));
+}
+
+static
+int
+is_near(const ss_rect_t* const a, const ss_rect_t* const b, const double gap)
+{
+    return (a->x <= b->x + b->width  + gap && b->x <= a->x + a->width  + gap &&
+            a->y <= b->y + b->height + gap && b->y <= a->y + a->height + gap);
+}
+
+static
+ss_rect_t
+join(const ss_rect_t* const a, const ss_rect_t* const b)
+{
+    const double left   = fmin(a->x, b->x);
+    const double top    = fmin(a->y, b->y);
+    const double right  = fmax(a->x + a->width,  b->x + b->width);
+    const double bottom = fmax(a->y + a->height, b->y + b->height);
+    const ss_rect_t rect = { left, top, right - left, bottom - top };
+    return rect;
+}
+
+size_t
+ss_cluster_rects(const ss_rect_t* const rects, const size_t count, const double gap,
+                 size_t* const group, ss_rect_t* const bounds)
+{
+    size_t groups = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (is_empty(&rects[i])) {
+            group[i] = SS_CLUSTER_NONE;
+        }
+        else {
+            group[i]         = groups;
+            bounds[groups++] = rects[i];
+        }
+    }
+
+    // a merged group is bigger, so it can come near groups that it was
+    // not near before; keep going until nothing merges
+    int merged;
+    do {
+        merged = 0;
+        for (size_t a = 0; a < groups; a++) {
+            size_t b = a + 1;
+            while (b < groups) {
+                if (!is_near(&bounds[a], &bounds[b], gap)) {
+                    b++;
+                    continue;
+                }
+
+                // fold b into a, then move the last group into b's place
+                bounds[a] = join(&bounds[a], &bounds[b]);
+                groups--;
+                for (size_t i = 0; i < count; i++) {
+                    if (group[i] == b)
+                        group[i] = a;
+                    else if (group[i] == groups)
+                        group[i] = b;
+                }
+                bounds[b] = bounds[groups];
+                merged    = 1;
+            }
+        }
+    } while (merged);
+
+    return groups;
+}
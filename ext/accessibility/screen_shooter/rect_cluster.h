@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Grouping rects that are close together, so that each group can be
+ * captured once instead of capturing either every rect on its own or
+ * one area that covers all of them, gaps and all.
+ *
+ * Rects go in the same group when they overlap or when the gap between
+ * them is no more than `gap`. Groups whose bounds come that close are
+ * merged too, so no two groups' bounds are within `gap` of each other
+ * and no pixel is captured twice.
+ *
+ * This file does not depend on Cocoa or Ruby.
+ */
+
+#define SS_CLUSTER_NONE ((size_t)-1)
+
+typedef struct {
+    double x;
+    double y;
+    double width;
+    double height;
+} ss_rect_t;
+
+/*
+ * Group `count` rects, and return how many groups there are
+ *
+ * `group[i]` is set to the group of `rects[i]`, or SS_CLUSTER_NONE if
+ * the rect is empty (no width, no height, or not a number). `bounds`
+ * must have room for `count` rects and gets the bounds of each group;
+ * it can be the same array as `rects`.
+ */
+size_t ss_cluster_rects(const ss_rect_t* rects, size_t count, double gap,
+                        size_t* group, ss_rect_t* bounds);
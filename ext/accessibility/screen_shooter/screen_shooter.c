@@ -1,48 +1,1889 @@
 #include "ruby.h"
+#include "ruby/thread.h"
 #import <Cocoa/Cocoa.h>
 #include "../bridge/bridge.h"
+#include "png_encoder.h"
+#include "image_diff.h"
+#include "frame_delta.h"
+#include "frame_ring.h"
+#include "rect_cluster.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 static VALUE rb_mSS;
+static VALUE rb_cImage;
+static VALUE rb_cRecorder;
+static VALUE rb_cSequence;
+
+static VALUE key_level;
+static VALUE key_filter;
+static VALUE key_alpha;
+static VALUE key_source;
+static VALUE sym_sub;
+static VALUE sym_none;
+static VALUE sym_screen;
+static VALUE sym_synthetic;
+static VALUE key_allocations;
+static VALUE key_reuses;
+static VALUE key_bytes;
+static VALUE key_format;
+static VALUE key_stride;
+static VALUE sym_bgra;
+static VALUE sym_png;
+static VALUE sym_raw;
+static VALUE key_tolerance;
+static VALUE key_mask;
+static VALUE key_kernel;
+static VALUE key_mismatches;
+static VALUE key_bounds;
+static VALUE sym_auto;
+static VALUE sym_scalar;
+static VALUE sym_sse2;
+static VALUE sym_avx2;
+static VALUE sym_neon;
+static VALUE key_fps;
+static VALUE key_capacity;
+static VALUE key_captured;
+static VALUE key_frames;
+static VALUE key_dropped;
+static VALUE key_failed;
+static VALUE key_tile;
+static VALUE key_threads;
+static VALUE key_keyframe_every;
+static VALUE key_keyframes;
+static VALUE key_tiles;
+static VALUE key_raw_bytes;
+
+#define SS_SYNTHETIC_WIDTH  1920
+#define SS_SYNTHETIC_HEIGHT 1080
+#define SS_DEFAULT_LEVEL    6
+#define SS_MAX_THREADS      64
+
+
+/*
+ * A single pixel buffer is kept around between shots so that capturing
+ * the same area over and over does not allocate (and fault in) a new
+ * full screen buffer each time. Taking a buffer out of the pool leaves
+ * it empty, so concurrent shots just get their own buffer.
+ */
+
+static ss_buffer_t     ss_pool             = { NULL, 0 };
+static pthread_mutex_t ss_pool_lock        = PTHREAD_MUTEX_INITIALIZER;
+static size_t          ss_pool_allocations = 0;
+static size_t          ss_pool_reuses      = 0;
 
 static
-VALUE
-rb_ss_take_shot(__unused const VALUE self, const VALUE rbrect, const VALUE path)
+ss_buffer_t
+ss_buffer_checkout(const size_t size)
 {
-    NSString* const ns_path =
-	[[NSString alloc] initWithBytesNoCopy:RSTRING_PTR(path)
-                                       length:RSTRING_LEN(path)
-                                     encoding:NSUTF8StringEncoding
-                                 freeWhenDone:NO];
+    pthread_mutex_lock(&ss_pool_lock);
+    ss_buffer_t buffer = ss_pool;
+    ss_pool.bytes      = NULL;
+    ss_pool.capacity   = 0;
+    if (buffer.capacity >= size)
+	ss_pool_reuses++;
+    else
+	ss_pool_allocations++;
+    pthread_mutex_unlock(&ss_pool_lock);
+
+    if (buffer.capacity < size) {
+	free(buffer.bytes);
+	buffer.bytes    = malloc(size);
+	buffer.capacity = (buffer.bytes ? size : 0);
+    }
+    return buffer;
+}
+
+static
+void
+ss_buffer_checkin(const ss_buffer_t buffer)
+{
+    pthread_mutex_lock(&ss_pool_lock);
+    ss_buffer_t extra = buffer;
+    if (buffer.capacity > ss_pool.capacity) {
+	extra   = ss_pool;
+	ss_pool = buffer;
+    }
+    pthread_mutex_unlock(&ss_pool_lock);
+    free(extra.bytes);
+}
 
-    CGRect rect = unwrap_rect(rbrect);
-    if (rect.size.width < 0 || rect.size.height < 0)
-	rect = CGRectInfinite;
 
+// Make sure the frame buffer can hold `stride * height` bytes
+static
+int
+ss_frame_reserve(ss_frame_t* const frame)
+{
+    const size_t size = frame->stride * frame->height;
+    if (frame->buffer.capacity < size) {
+	ss_buffer_checkin(frame->buffer);
+	frame->buffer = ss_buffer_checkout(size);
+    }
+    return (frame->buffer.bytes ? 0 : -1);
+}
+
+static
+int
+ss_capture_screen(const CGRect rect, ss_frame_t* const frame)
+{
     CGImageRef const image =
 	CGWindowListCreateImage(rect,
 				kCGWindowListOptionOnScreenOnly,
 				kCGNullWindowID,
 				kCGWindowImageDefault);
+    if (!image)
+	return -1;
+
+    frame->width  = CGImageGetWidth(image);
+    frame->height = CGImageGetHeight(image);
+    frame->stride = frame->width * 4;
+    if (ss_frame_reserve(frame) || !frame->width || !frame->height) {
+	CFRelease(image);
+	return -1;
+    }
 
-    NSBitmapImageRep* const rep =
-	[[NSBitmapImageRep alloc] initWithCGImage:image];
+    CGColorSpaceRef const space = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+    CGContextRef const  context =
+	CGBitmapContextCreate(frame->buffer.bytes,
+			      frame->width,
+			      frame->height,
+			      8,
+			      frame->stride,
+			      space,
+			      kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGColorSpaceRelease(space);
+    if (!context) {
+	CFRelease(image);
+	return -1;
+    }
 
-    NSData* const data = [rep representationUsingType:NSPNGFileType
-                                           properties:@{}];
+    // copy rather than blend, the buffer may have an old shot in it
+    CGContextSetBlendMode(context, kCGBlendModeCopy);
+    CGContextDrawImage(context,
+		       CGRectMake(0, 0, frame->width, frame->height),
+		       image);
+    CGContextRelease(context);
+    CFRelease(image);
+    return 0;
+}
 
-    const VALUE result =
-	[data writeToFile:ns_path atomically:NO] ? Qtrue : Qfalse;
+/*
+ * A stand-in for the screen that needs no window server: red follows
+ * the screen x, green follows the screen y, and blue is x ^ y (all mod
+ * 256), fully opaque; one point is one pixel
+ */
+static
+int
+ss_capture_synthetic(const CGRect rect, ss_frame_t* const frame)
+{
+    const int infinite = CGRectIsInfinite(rect);
+    frame->width  = (infinite ? SS_SYNTHETIC_WIDTH  : (size_t)rect.size.width);
+    frame->height = (infinite ? SS_SYNTHETIC_HEIGHT : (size_t)rect.size.height);
+    frame->stride = frame->width * 4;
+    if (ss_frame_reserve(frame) || !frame->width || !frame->height)
+	return -1;
 
+    const long left = (infinite ? 0 : (long)rect.origin.x);
+    const long  top = (infinite ? 0 : (long)rect.origin.y);
+    for (size_t row = 0; row < frame->height; row++) {
+	uint8_t* const px = frame->buffer.bytes + row * frame->stride;
+	const long      y = top + (long)row;
+	for (size_t column = 0; column < frame->width; column++) {
+	    const long x = left + (long)column;
+	    px[column * 4 + 0] = (uint8_t)(x ^ y);
+	    px[column * 4 + 1] = (uint8_t)y;
+	    px[column * 4 + 2] = (uint8_t)x;
+	    px[column * 4 + 3] = 255;
+	}
+    }
+    return 0;
+}
 
-    [ns_path release];
-    if (image)
-	CFRelease(image);
-    [rep release];
-    [data release];
+// Seconds since the epoch
+static
+double
+ss_now(void)
+{
+    return CFAbsoluteTimeGetCurrent() + kCFAbsoluteTimeIntervalSince1970;
+}
+
+/*
+ * Capture into the frame, reusing its buffer if it is already big
+ * enough; start with a zeroed frame and check the buffer back in when
+ * it is no longer needed
+ */
+static
+int
+ss_capture(const CGRect rect, const int synthetic, ss_frame_t* const frame)
+{
+    @autoreleasepool {
+	if (synthetic)
+	    return ss_capture_synthetic(rect, frame);
+	return ss_capture_screen(rect, frame);
+    }
+}
 
+// How to encode a PNG, from the `:level`, `:filter`, `:alpha`, and `:threads` options
+typedef struct {
+    int             level;
+    int             channels;
+    ss_png_filter_t filter;
+    size_t          threads;
+} ss_encoding_t;
+
+/*
+ * Encode a BGRA image as a PNG
+ *
+ * With more than one thread, the image is cut into bands that are
+ * compressed at the same time and then written out in order; otherwise
+ * rows are streamed to the sink as they are compressed.
+ */
+static
+int
+ss_encode(const ss_png_write_fn write, void* const ctx,
+	  const uint8_t* const pixels, const size_t width, const size_t height, const size_t stride,
+	  const ss_encoding_t* const encoding)
+{
+    if (encoding->threads < 2 || height < 2 * SS_PNG_MIN_BAND_ROWS)
+	return ss_png_encode(write, ctx, pixels, (uint32_t)width, (uint32_t)height, stride,
+			     encoding->channels, encoding->level, encoding->filter);
+
+    ss_png_band_t* const bands = malloc(sizeof(ss_png_band_t) * encoding->threads);
+    if (!bands)
+	return -1;
+
+    const size_t count = ss_png_split_bands(bands, encoding->threads, pixels,
+					    (uint32_t)width, (uint32_t)height, stride,
+					    encoding->channels, encoding->level, encoding->filter);
+    dispatch_apply(count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+		   ^(const size_t index) {
+		       ss_png_encode_band(&bands[index]);
+		   });
+
+    const int result = ss_png_write_bands(write, ctx, (uint32_t)width, (uint32_t)height,
+					  encoding->channels, bands, count);
+    ss_png_free_bands(bands, count);
+    free(bands);
     return result;
 }
 
+typedef struct {
+    CGRect          rect;
+    const char*     path;
+    int             synthetic;
+    ss_encoding_t   encoding;
+    int             result;
+} ss_shot_t;
+
+// Capture and encode straight to disk; does not need the GVL
+static
+void*
+ss_take_shot(void* const data)
+{
+    ss_shot_t* const shot = data;
+    ss_frame_t      frame;
+    memset(&frame, 0, sizeof(ss_frame_t));
+    shot->result = -1;
+
+    if (ss_capture(shot->rect, shot->synthetic, &frame)) {
+	ss_buffer_checkin(frame.buffer);
+	return NULL;
+    }
+
+    int fd = open(shot->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+	ss_buffer_checkin(frame.buffer);
+	return NULL;
+    }
+
+    // only a regular file is ours to remove if encoding fails; the path
+    // could just as well be a pipe or a device
+    struct stat info;
+    const int regular = (!fstat(fd, &info) && S_ISREG(info.st_mode));
+
+    int result = ss_encode(ss_png_write_fd, &fd, frame.buffer.bytes,
+			   frame.width, frame.height, frame.stride, &shot->encoding);
+    if (close(fd))
+	result = -1;
+    if (result && regular)
+	unlink(shot->path); // rather than leave a truncated PNG behind
+    ss_buffer_checkin(frame.buffer);
+    shot->result = result;
+    return NULL;
+}
+
+// The options hash at argv[index], or an empty one if it was left out
+// or given as nil
+static
+VALUE
+ss_opts_at(const int argc, VALUE* const argv, const int index)
+{
+    if (argc <= index || argv[index] == Qnil)
+	return rb_hash_new();
+    Check_Type(argv[index], T_HASH);
+    return argv[index];
+}
+
+static
+int
+ss_level_from(const VALUE opts)
+{
+    const VALUE level = rb_hash_lookup(opts, key_level);
+    if (level == Qnil)
+	return SS_DEFAULT_LEVEL;
+
+    const int value = NUM2INT(level);
+    if (value < Z_NO_COMPRESSION || value > Z_BEST_COMPRESSION)
+	rb_raise(rb_eArgError, "compression level must be 0-9 (got %d)", value);
+    return value;
+}
+
+static
+ss_png_filter_t
+ss_filter_from(const VALUE opts)
+{
+    const VALUE filter = rb_hash_lookup(opts, key_filter);
+    if (filter == Qnil || filter == sym_sub)
+	return SS_PNG_FILTER_SUB;
+    if (filter == sym_none)
+	return SS_PNG_FILTER_NONE;
+
+    volatile VALUE inspected = rb_inspect(filter);
+    rb_raise(rb_eArgError, "unknown PNG filter %s", StringValueCStr(inspected));
+    return SS_PNG_FILTER_SUB; // unreachable
+}
+
+static
+int
+ss_synthetic_from(const VALUE opts)
+{
+    const VALUE source = rb_hash_lookup(opts, key_source);
+    if (source == Qnil || source == sym_screen)
+	return 0;
+    if (source == sym_synthetic)
+	return 1;
+
+    volatile VALUE inspected = rb_inspect(source);
+    rb_raise(rb_eArgError, "unknown capture source %s", StringValueCStr(inspected));
+    return 0; // unreachable
+}
+
+static
+size_t
+ss_threads_from(const VALUE opts)
+{
+    const VALUE threads = rb_hash_lookup(opts, key_threads);
+    if (threads == Qnil)
+	return 1;
+    if (threads == sym_auto)
+	return (size_t)[[NSProcessInfo processInfo] activeProcessorCount];
+
+    const long value = NUM2LONG(threads);
+    if (value < 1 || value > SS_MAX_THREADS)
+	rb_raise(rb_eArgError, "threads must be 1-%d or :auto (got %ld)", SS_MAX_THREADS, value);
+    return (size_t)value;
+}
+
+static
+ss_encoding_t
+ss_encoding_from(const VALUE opts)
+{
+    ss_encoding_t encoding;
+    encoding.level    = ss_level_from(opts);
+    encoding.filter   = ss_filter_from(opts);
+    encoding.channels = (RTEST(rb_hash_lookup(opts, key_alpha)) ? 4 : 3);
+    encoding.threads  = ss_threads_from(opts);
+    return encoding;
+}
+
+/*
+ * Take a screen shot of the given rect and save it as a PNG
+ *
+ * The pixels are captured into a buffer that is reused between shots,
+ * and compressed rows are written to the file as they are encoded, so
+ * there is never more than one full copy of the image in memory. The
+ * GVL is released while capturing and encoding.
+ *
+ * Options:
+ *
+ *  - `:level` - zlib compression level, `0` (fastest) to `9` (smallest),
+ *    defaults to `6`
+ *  - `:filter` - PNG row filter, `:sub` (default) or `:none`
+ *  - `:alpha` - whether to keep the alpha channel (default `false`)
+ *  - `:threads` - how many bands of the image to compress at the same
+ *    time, or `:auto` for one per CPU; the default of `1` streams rows
+ *    to the file instead, which uses less memory but only one core
+ *  - `:source` - `:screen` (default) or `:synthetic`, a generated
+ *    test pattern that does not need a window server
+ *
+ * A rect with a negative size captures all the screens.
+ *
+ * @param rect [CGRect,#to_rect]
+ * @param path [String]
+ * @param opts [Hash]
+ * @return [Boolean]
+ */
+static
+VALUE
+rb_ss_screenshot(const int argc, VALUE* const argv, __unused const VALUE self)
+{
+    if (argc < 2)
+	rb_raise(rb_eArgError, "wrong number of arguments (%d for 2..3)", argc);
+
+    VALUE       path = argv[1];
+    const VALUE opts = ss_opts_at(argc, argv, 2);
+
+    ss_shot_t shot;
+    shot.rect      = unwrap_rect(argv[0]);
+    shot.path      = StringValueCStr(path);
+    shot.encoding  = ss_encoding_from(opts);
+    shot.synthetic = ss_synthetic_from(opts);
+    shot.result    = -1;
+    if (shot.rect.size.width < 0 || shot.rect.size.height < 0)
+	shot.rect = CGRectInfinite;
+
+    rb_thread_call_without_gvl(ss_take_shot, &shot, NULL, NULL);
+    RB_GC_GUARD(path);
+
+    return (shot.result ? Qfalse : Qtrue);
+}
+
+/*
+ * Captured pixels, kept in a frozen string
+ *
+ * `:bgra` and `:raw` images are 32-bit BGRA with premultiplied alpha,
+ * `stride` bytes per row; `:raw` rows may be padded. `:png` images hold
+ * an encoded PNG and have no stride.
+ */
+typedef struct {
+    size_t width;
+    size_t height;
+    size_t stride;
+    VALUE  format;
+    VALUE  bytes;
+    double time;   // when it was captured, 0 if it was not
+} ss_image_t;
+
+static
+void
+ss_image_mark(void* const data)
+{
+    ss_image_t* const image = data;
+    rb_gc_mark(image->format);
+    rb_gc_mark(image->bytes);
+}
+
+static
+VALUE
+ss_image_wrap(const size_t width, const size_t height, const size_t stride,
+	      const VALUE format, const VALUE bytes)
+{
+    ss_image_t* image;
+    const VALUE obj = Data_Make_Struct(rb_cImage, ss_image_t, ss_image_mark, RUBY_DEFAULT_FREE, image);
+    image->width  = width;
+    image->height = height;
+    image->stride = stride;
+    image->format = format;
+    image->bytes  = rb_obj_freeze(bytes);
+    return obj;
+}
+
+static
+ss_image_t*
+ss_image_data(const VALUE obj)
+{
+    ss_image_t* image;
+    Data_Get_Struct(obj, ss_image_t, image);
+    return image;
+}
+
+typedef struct {
+    CGRect          rect;
+    int             synthetic;
+    VALUE           format;
+    ss_encoding_t   encoding;
+    ss_frame_t      frame;
+    CFDataRef       raw;     // for :raw screen captures
+    ss_png_memory_t png;     // for :png
+    double          time;
+    int             result;
+} ss_capture_t;
+
+// Whether the window server handed over 8-bit BGRA (or BGRX) pixels
+static
+int
+ss_image_is_bgra(CGImageRef const image)
+{
+    const CGBitmapInfo     info = CGImageGetBitmapInfo(image);
+    const CGImageAlphaInfo alpha = CGImageGetAlphaInfo(image);
+
+    if (CGImageGetBitsPerPixel(image) != 32 || CGImageGetBitsPerComponent(image) != 8)
+	return 0;
+    if ((info & kCGBitmapByteOrderMask) != kCGBitmapByteOrder32Little)
+	return 0;
+    if (info & kCGBitmapFloatComponents)
+	return 0;
+    return (alpha == kCGImageAlphaPremultipliedFirst ||
+	    alpha == kCGImageAlphaNoneSkipFirst      ||
+	    alpha == kCGImageAlphaFirst);
+}
+
+/*
+ * Copy the pixels straight out of the window server's image
+ *
+ * Returns 1 without capturing anything when the image is not laid out
+ * as BGRA, so that the caller can draw it into a BGRA frame instead.
+ */
+static
+int
+ss_capture_raw(const CGRect rect, ss_capture_t* const capture)
+{
+    @autoreleasepool {
+	CGImageRef const image =
+	    CGWindowListCreateImage(rect,
+				    kCGWindowListOptionOnScreenOnly,
+				    kCGNullWindowID,
+				    kCGWindowImageDefault);
+	if (!image)
+	    return -1;
+	if (!ss_image_is_bgra(image)) {
+	    CFRelease(image);
+	    return 1;
+	}
+
+	const size_t width  = CGImageGetWidth(image);
+	const size_t height = CGImageGetHeight(image);
+	const size_t stride = CGImageGetBytesPerRow(image);
+	CFDataRef const raw = CGDataProviderCopyData(CGImageGetDataProvider(image));
+	CFRelease(image);
+	if (!raw)
+	    return -1;
+	if (stride < width * 4 || (size_t)CFDataGetLength(raw) < stride * height) {
+	    CFRelease(raw);
+	    return 1;
+	}
+
+	capture->frame.width  = width;
+	capture->frame.height = height;
+	capture->frame.stride = stride;
+	capture->raw          = raw;
+	return 0;
+    }
+}
+
+static
+void*
+ss_capture_into(void* const data)
+{
+    ss_capture_t* const capture = data;
+    capture->time = ss_now();
+
+    if (capture->format == sym_raw && !capture->synthetic) {
+	capture->result = ss_capture_raw(capture->rect, capture);
+	if (capture->result <= 0)
+	    return NULL;
+	// not BGRA, so draw it like any other capture
+    }
+
+    capture->result = ss_capture(capture->rect, capture->synthetic, &capture->frame);
+    if (capture->result || capture->format != sym_png)
+	return NULL;
+
+    capture->result = ss_encode(ss_png_write_memory, &capture->png,
+				capture->frame.buffer.bytes,
+				capture->frame.width,
+				capture->frame.height,
+				capture->frame.stride,
+				&capture->encoding);
+    return NULL;
+}
+
+static
+VALUE
+ss_format_from(const VALUE opts)
+{
+    const VALUE format = rb_hash_lookup(opts, key_format);
+    if (format == Qnil)
+	return sym_bgra;
+    if (format == sym_bgra || format == sym_png || format == sym_raw)
+	return format;
+
+    volatile VALUE inspected = rb_inspect(format);
+    rb_raise(rb_eArgError, "unknown image format %s", StringValueCStr(inspected));
+    return Qnil; // unreachable
+}
+
+/*
+ * Capture the given rect into memory
+ *
+ * Nothing is written to disk. The `:format` option picks what is in the
+ * {Image}:
+ *
+ *  - `:bgra` (default) - 32-bit BGRA pixels with premultiplied alpha,
+ *    packed so that `stride == width * 4`
+ *  - `:raw` - the pixels as the window server handed them over, which
+ *    are also BGRA but rows may be padded; if the window server uses
+ *    some other layout, the pixels are drawn as for `:bgra`
+ *  - `:png` - an encoded PNG; `:level`, `:filter`, `:alpha`, and
+ *    `:threads` work the same as for {screenshot}
+ *
+ * The `:source` option is the same as for {screenshot}. The GVL is
+ * released while capturing and encoding.
+ *
+ * @example
+ *
+ *   image = ScreenShooter.capture CGRect.new(CGPoint.new(0, 0), CGSize.new(100, 100))
+ *   image.bytes.bytesize # => 40000 (on a non-Retina display)
+ *
+ * @param rect [CGRect,#to_rect]
+ * @param opts [Hash]
+ * @return [ScreenShooter::Image]
+ */
+static
+VALUE
+rb_ss_capture(const int argc, VALUE* const argv, __unused const VALUE self)
+{
+    if (argc < 1)
+	rb_raise(rb_eArgError, "wrong number of arguments (0 for 1..2)");
+
+    const VALUE opts = ss_opts_at(argc, argv, 1);
+
+    ss_capture_t capture;
+    memset(&capture, 0, sizeof(ss_capture_t));
+    capture.rect      = unwrap_rect(argv[0]);
+    capture.format    = ss_format_from(opts);
+    capture.encoding  = ss_encoding_from(opts);
+    capture.synthetic = ss_synthetic_from(opts);
+    if (capture.rect.size.width < 0 || capture.rect.size.height < 0)
+	capture.rect = CGRectInfinite;
+
+    rb_thread_call_without_gvl(ss_capture_into, &capture, NULL, NULL);
+
+    const ss_frame_t* const frame = &capture.frame;
+    VALUE bytes  = Qnil;
+    size_t stride = frame->stride;
+    if (!capture.result) {
+	if (capture.raw)
+	    bytes = rb_str_new((const char*)CFDataGetBytePtr(capture.raw),
+			       CFDataGetLength(capture.raw));
+	else if (capture.format == sym_png)
+	    bytes = rb_str_new((const char*)capture.png.bytes, (long)capture.png.length);
+	else
+	    bytes = rb_str_new((const char*)frame->buffer.bytes,
+			       (long)(frame->stride * frame->height));
+    }
+    if (capture.format == sym_png)
+	stride = 0;
+
+    if (capture.raw)
+	CFRelease(capture.raw);
+    free(capture.png.bytes);
+    ss_buffer_checkin(frame->buffer);
+
+    if (bytes == Qnil)
+	rb_raise(rb_eRuntimeError, "failed to capture the screen");
+
+    const VALUE image = ss_image_wrap(frame->width, frame->height, stride, capture.format, bytes);
+    ss_image_data(image)->time = capture.time;
+    return image;
+}
+
+// Elements this close together (in points) are captured together,
+// since a strip of extra pixels costs less than another capture
+#define SS_CLUSTER_GAP 16
+
+typedef struct {
+    CGRect     bounds;
+    ss_frame_t frame;
+    double     time;
+} ss_region_t;
+
+typedef struct {
+    size_t          count;
+    AXUIElementRef* refs;    // NULL for stand-ins, which come with a rect
+    CGRect*         rects;   // CGRectNull when there is no frame
+    int             synthetic;
+    ss_rect_t*      scratch; // the rects, to be grouped
+    size_t*         groups;  // the region each rect is in, or SS_CLUSTER_NONE
+    ss_region_t*    regions; // one capture for each group of nearby rects
+    size_t          region_count;
+    int             result;
+} ss_elements_t;
+
+// Read AXPosition and AXSize directly instead of going through Ruby
+static
+CGRect
+ss_element_frame(AXUIElementRef const ref)
+{
+    CGPoint position = CGPointZero;
+    CGSize      size = CGSizeZero;
+    CFTypeRef  value = NULL;
+    int        found = 0;
+
+    if (AXUIElementCopyAttributeValue(ref, kAXPositionAttribute, &value) == kAXErrorSuccess) {
+	found += AXValueGetValue(value, kAXValueCGPointType, &position);
+	CFRelease(value);
+    }
+    if (AXUIElementCopyAttributeValue(ref, kAXSizeAttribute, &value) == kAXErrorSuccess) {
+	found += AXValueGetValue(value, kAXValueCGSizeType, &size);
+	CFRelease(value);
+    }
+    return (found == 2 ? CGRectMake(position.x, position.y, size.width, size.height) : CGRectNull);
+}
+
+static
+void*
+ss_capture_elements(void* const data)
+{
+    ss_elements_t* const elements = data;
+
+    for (size_t i = 0; i < elements->count; i++) {
+	if (elements->refs[i])
+	    elements->rects[i] = ss_element_frame(elements->refs[i]);
+	const CGRect rect = elements->rects[i];
+	elements->scratch[i].x      = rect.origin.x;
+	elements->scratch[i].y      = rect.origin.y;
+	elements->scratch[i].width  = rect.size.width;
+	elements->scratch[i].height = rect.size.height;
+    }
+
+    // a region per group, which may be none if nothing is on screen
+    ss_rect_t* const bounds = elements->scratch; // each group's bounds, in place
+    elements->region_count  = ss_cluster_rects(elements->scratch, elements->count, SS_CLUSTER_GAP,
+					       elements->groups, bounds);
+
+    for (size_t r = 0; r < elements->region_count; r++) {
+	ss_region_t* const region = &elements->regions[r];
+	region->bounds = CGRectIntegral(CGRectMake(bounds[r].x, bounds[r].y,
+						   bounds[r].width, bounds[r].height));
+	region->time   = ss_now();
+	if (ss_capture(region->bounds, elements->synthetic, &region->frame)) {
+	    elements->result = -1;
+	    break;
+	}
+    }
+    return NULL;
+}
+
+// Copy the part of the frame that covers rect (in points) into an image
+static
+VALUE
+ss_crop(const ss_frame_t* const frame, const CGRect bounds, const CGRect rect, const double time)
+{
+    if (CGRectIsEmpty(rect))
+	return Qnil;
+
+    // screens can have more than one pixel per point
+    const double scale_x = frame->width  / bounds.size.width;
+    const double scale_y = frame->height / bounds.size.height;
+    const double    left = floor((CGRectGetMinX(rect) - bounds.origin.x) * scale_x);
+    const double     top = floor((CGRectGetMinY(rect) - bounds.origin.y) * scale_y);
+    const double   right = ceil((CGRectGetMaxX(rect)  - bounds.origin.x) * scale_x);
+    const double  bottom = ceil((CGRectGetMaxY(rect)  - bounds.origin.y) * scale_y);
+
+    const size_t x0 = (size_t)fmax(left, 0);
+    const size_t y0 = (size_t)fmax(top, 0);
+    const size_t x1 = (size_t)fmin(right,  (double)frame->width);
+    const size_t y1 = (size_t)fmin(bottom, (double)frame->height);
+    if (x1 <= x0 || y1 <= y0)
+	return Qnil;
+
+    const size_t  width = x1 - x0;
+    const size_t height = y1 - y0;
+    const VALUE   bytes = rb_str_new(NULL, (long)(width * height * 4));
+    uint8_t* const  out = (uint8_t*)RSTRING_PTR(bytes);
+    for (size_t y = 0; y < height; y++)
+	memcpy(out + y * width * 4,
+	       frame->buffer.bytes + (y0 + y) * frame->stride + x0 * 4,
+	       width * 4);
+
+    const VALUE image = ss_image_wrap(width, height, width * 4, sym_bgra, bytes);
+    ss_image_data(image)->time = time;
+    return image;
+}
+
+/*
+ * Capture several UI elements with a single screen shot
+ *
+ * The frames of {Accessibility::Element}s are read straight from the
+ * accessibility API, and anything else is asked for its `#to_rect`.
+ * Elements that overlap or sit within a few points of each other are
+ * grouped, each group's area is captured once, and then each element is
+ * cropped out of its group's capture. Elements far apart, say in two
+ * corners of the screen, do not drag everything in between along.
+ *
+ * The `:source` option is the same as for {screenshot}. The GVL is
+ * released while looking up frames and capturing.
+ *
+ * @example
+ *
+ *   buttons = window.children.select { |child| child.role == KAXButtonRole }
+ *   ScreenShooter.capture_elements(buttons).map(&:to_png)
+ *
+ * @param elements [Array<Accessibility::Element,#to_rect>]
+ * @param opts [Hash]
+ * @return [Array<ScreenShooter::Image,nil>] in the same order as the
+ *   elements, `nil` for elements that are not on screen
+ */
+static
+VALUE
+rb_ss_capture_elements(const int argc, VALUE* const argv, __unused const VALUE self)
+{
+    if (argc < 1)
+	rb_raise(rb_eArgError, "wrong number of arguments (0 for 1..2)");
+
+    const VALUE list = rb_Array(argv[0]);
+    const VALUE opts = ss_opts_at(argc, argv, 1);
+
+    ss_elements_t elements;
+    memset(&elements, 0, sizeof(ss_elements_t));
+    elements.count     = (size_t)RARRAY_LEN(list);
+    elements.synthetic = ss_synthetic_from(opts);
+
+    VALUE refs_buffer, rects_buffer, scratch_buffer, groups_buffer, regions_buffer;
+    elements.refs    = ALLOCV_N(AXUIElementRef, refs_buffer,    elements.count);
+    elements.rects   = ALLOCV_N(CGRect,         rects_buffer,   elements.count);
+    elements.scratch = ALLOCV_N(ss_rect_t,      scratch_buffer, elements.count);
+    elements.groups  = ALLOCV_N(size_t,         groups_buffer,  elements.count);
+    elements.regions = ALLOCV_N(ss_region_t,    regions_buffer, elements.count);
+    memset(elements.regions, 0, sizeof(ss_region_t) * elements.count);
+    for (size_t i = 0; i < elements.count; i++) {
+	const VALUE element = rb_ary_entry(list, (long)i);
+	if (rb_obj_is_kind_of(element, rb_cElement)) {
+	    elements.refs[i]  = unwrap_ref(element);
+	    elements.rects[i] = CGRectNull;
+	}
+	else {
+	    elements.refs[i]  = NULL;
+	    elements.rects[i] = unwrap_rect(element);
+	}
+    }
+
+    rb_thread_call_without_gvl(ss_capture_elements, &elements, NULL, NULL);
+    RB_GC_GUARD(list);
+
+    VALUE images = Qnil;
+    if (!elements.result) {
+	images = rb_ary_new2((long)elements.count);
+	for (size_t i = 0; i < elements.count; i++) {
+	    const size_t group = elements.groups[i];
+	    if (group == SS_CLUSTER_NONE) {
+		rb_ary_push(images, Qnil);
+		continue;
+	    }
+	    const ss_region_t* const region = &elements.regions[group];
+	    rb_ary_push(images, ss_crop(&region->frame, region->bounds,
+					elements.rects[i], region->time));
+	}
+    }
+
+    for (size_t r = 0; r < elements.region_count; r++)
+	ss_buffer_checkin(elements.regions[r].frame.buffer);
+    ALLOCV_END(refs_buffer);
+    ALLOCV_END(rects_buffer);
+    ALLOCV_END(scratch_buffer);
+    ALLOCV_END(groups_buffer);
+    ALLOCV_END(regions_buffer);
+
+    if (images == Qnil)
+	rb_raise(rb_eRuntimeError, "failed to capture the screen");
+    return images;
+}
+
+/*
+ * Make an image out of pixels from somewhere else
+ *
+ * This is mostly useful for building synthetic images in tests. The
+ * bytes must be 32-bit BGRA pixels; `:stride` defaults to `width * 4`.
+ *
+ * @param width [Integer]
+ * @param height [Integer]
+ * @param bytes [String]
+ * @param opts [Hash] accepts `:stride`
+ * @return [ScreenShooter::Image]
+ */
+static
+VALUE
+rb_image_new(const int argc, VALUE* const argv, __unused const VALUE self)
+{
+    if (argc < 3)
+	rb_raise(rb_eArgError, "wrong number of arguments (%d for 3..4)", argc);
+
+    const long     width = NUM2LONG(argv[0]);
+    const long    height = NUM2LONG(argv[1]);
+    VALUE          bytes = argv[2];
+    const VALUE rb_stride = rb_hash_lookup(ss_opts_at(argc, argv, 3), key_stride);
+    StringValue(bytes);
+
+    if (width < 1 || height < 1)
+	rb_raise(rb_eArgError, "image must be at least 1x1 (got %ldx%ld)", width, height);
+    // the encoders and differs take 32-bit dimensions, which also keeps
+    // width * 4 well inside a long
+    if (width > UINT32_MAX || height > UINT32_MAX)
+	rb_raise(rb_eArgError, "image can be at most %lux%lu (got %ldx%ld)",
+		 (unsigned long)UINT32_MAX, (unsigned long)UINT32_MAX, width, height);
+
+    const long    stride = (rb_stride == Qnil ? width * 4 : NUM2LONG(rb_stride));
+    if (stride < width * 4)
+	rb_raise(rb_eArgError, "stride %ld is too small for %ld pixels", stride, width);
+    if (stride > LONG_MAX / height)
+	rb_raise(rb_eArgError, "a %ldx%ld image with stride %ld is too large",
+		 width, height, stride);
+    if (RSTRING_LEN(bytes) < stride * height)
+	rb_raise(rb_eArgError, "need %ld bytes for a %ldx%ld image (got %ld)",
+		 stride * height, width, height, RSTRING_LEN(bytes));
+
+    return ss_image_wrap((size_t)width, (size_t)height, (size_t)stride, sym_bgra,
+			 OBJ_FROZEN(bytes) ? bytes : rb_str_dup(bytes));
+}
+
+/* @return [Integer] */
+static VALUE rb_image_width(const VALUE self)  { return SIZET2NUM(ss_image_data(self)->width); }
+/* @return [Integer] */
+static VALUE rb_image_height(const VALUE self) { return SIZET2NUM(ss_image_data(self)->height); }
+/* @return [Symbol] `:bgra`, `:raw`, or `:png` */
+static VALUE rb_image_format(const VALUE self) { return ss_image_data(self)->format; }
+/* @return [String] frozen */
+static VALUE rb_image_bytes(const VALUE self)  { return ss_image_data(self)->bytes; }
+
+/*
+ * When the image was captured, in seconds since the epoch, or `nil`
+ * for images made with {new}
+ *
+ * @return [Float,nil]
+ */
+static
+VALUE
+rb_image_time(const VALUE self)
+{
+    const double time = ss_image_data(self)->time;
+    return (time ? DBL2NUM(time) : Qnil);
+}
+
+/*
+ * Bytes per row, or `nil` for PNG images
+ *
+ * @return [Integer,nil]
+ */
+static
+VALUE
+rb_image_stride(const VALUE self)
+{
+    const ss_image_t* const image = ss_image_data(self);
+    return (image->format == sym_png ? Qnil : SIZET2NUM(image->stride));
+}
+
+typedef struct {
+    const ss_image_t* image;
+    const uint8_t*    pixels;
+    ss_encoding_t     encoding;
+    ss_png_memory_t   png;
+    int               result;
+} ss_image_encode_t;
+
+static
+void*
+ss_image_encode(void* const data)
+{
+    ss_image_encode_t* const encode = data;
+    encode->result = ss_encode(ss_png_write_memory, &encode->png, encode->pixels,
+			       encode->image->width,
+			       encode->image->height,
+			       encode->image->stride,
+			       &encode->encoding);
+    return NULL;
+}
+
+/*
+ * Encode the image as a PNG
+ *
+ * Takes the same `:level`, `:filter`, `:alpha`, and `:threads` options
+ * as {ScreenShooter.screenshot}. A `:png` image is returned as is.
+ *
+ * @param opts [Hash]
+ * @return [String] frozen
+ */
+static
+VALUE
+rb_image_to_png(const int argc, VALUE* const argv, const VALUE self)
+{
+    const ss_image_t* const image = ss_image_data(self);
+    if (image->format == sym_png)
+	return image->bytes;
+
+    const VALUE opts = ss_opts_at(argc, argv, 0);
+    ss_image_encode_t encode;
+    memset(&encode, 0, sizeof(ss_image_encode_t));
+    encode.image    = image;
+    encode.pixels   = (const uint8_t*)RSTRING_PTR(image->bytes);
+    encode.encoding = ss_encoding_from(opts);
+
+    // the bytes are frozen and marked through self, so they stay put
+    rb_thread_call_without_gvl(ss_image_encode, &encode, NULL, NULL);
+    RB_GC_GUARD(self);
+
+    VALUE png = Qnil;
+    if (!encode.result)
+	png = rb_str_new((const char*)encode.png.bytes, (long)encode.png.length);
+    free(encode.png.bytes);
+    if (png == Qnil)
+	rb_raise(rb_eRuntimeError, "failed to encode PNG");
+    return rb_obj_freeze(png);
+}
+
+static
+VALUE
+rb_image_inspect(const VALUE self)
+{
+    const ss_image_t* const image = ss_image_data(self);
+    const VALUE format = rb_sym_to_s(image->format);
+    return rb_sprintf("#<%s %zux%zu %s>", rb_obj_classname(self),
+		      image->width, image->height, StringValueCStr(format));
+}
+
+static
+VALUE
+ss_kernel_name(const ss_diff_kernel_t kernel)
+{
+    switch (kernel) {
+    case SS_DIFF_SCALAR: return sym_scalar;
+    case SS_DIFF_SSE2:   return sym_sse2;
+    case SS_DIFF_AVX2:   return sym_avx2;
+    case SS_DIFF_NEON:   return sym_neon;
+    default:             return sym_auto;
+    }
+}
+
+static
+ss_diff_kernel_t
+ss_kernel_from(const VALUE opts)
+{
+    const VALUE kernel = rb_hash_lookup(opts, key_kernel);
+    if (kernel == Qnil || kernel == sym_auto)
+	return SS_DIFF_AUTO;
+
+    for (ss_diff_kernel_t k = SS_DIFF_SCALAR; k <= SS_DIFF_NEON; k++) {
+	if (kernel != ss_kernel_name(k))
+	    continue;
+	if (!ss_diff_kernel_available(k))
+	    rb_raise(rb_eArgError, "the %s kernel is not available on this CPU",
+		     rb_id2name(SYM2ID(kernel)));
+	return k;
+    }
+
+    volatile VALUE inspected = rb_inspect(kernel);
+    rb_raise(rb_eArgError, "unknown diff kernel %s", StringValueCStr(inspected));
+    return SS_DIFF_AUTO; // unreachable
+}
+
+static
+const ss_image_t*
+ss_image_pixels(const VALUE obj)
+{
+    if (!rb_obj_is_kind_of(obj, rb_cImage))
+	rb_raise(rb_eTypeError, "expected a ScreenShooter::Image, got %s", rb_obj_classname(obj));
+
+    const ss_image_t* const image = ss_image_data(obj);
+    if (image->format == sym_png)
+	rb_raise(rb_eArgError, "cannot diff a PNG image, capture it as :bgra or :raw");
+    return image;
+}
+
+typedef struct {
+    const ss_image_t* a;
+    const ss_image_t* b;
+    uint8_t           tolerance;
+    uint8_t*          mask;
+    ss_diff_kernel_t  kernel;
+    ss_diff_t         result;
+} ss_compare_t;
+
+static
+void*
+ss_compare(void* const data)
+{
+    ss_compare_t* const compare = data;
+    ss_diff((const uint8_t*)RSTRING_PTR(compare->a->bytes), compare->a->stride,
+	    (const uint8_t*)RSTRING_PTR(compare->b->bytes), compare->b->stride,
+	    (uint32_t)compare->a->width, (uint32_t)compare->a->height,
+	    compare->tolerance,
+	    compare->mask, compare->a->width,
+	    compare->kernel, &compare->result);
+    return NULL;
+}
+
+/*
+ * Compare two images pixel by pixel
+ *
+ * A pixel is counted as different when any of its channels (including
+ * alpha) differs by more than `:tolerance` (default `0`). The returned
+ * hash has:
+ *
+ *  - `:mismatches` - how many pixels are different
+ *  - `:bounds` - the smallest `CGRect`, in pixels, that covers all the
+ *    differences, or `nil` if the images are the same
+ *  - `:mask` - with the `:mask` option, a frozen string with one byte
+ *    per pixel (row by row, no padding); `255` where the images differ
+ *    and `0` elsewhere
+ *
+ * The comparison is done with SIMD instructions when the CPU has them;
+ * the `:kernel` option forces one of {diff_kernels} and is mostly
+ * useful for testing. The GVL is released while comparing.
+ *
+ * @example
+ *
+ *   before = ScreenShooter.capture rect
+ *   # ...
+ *   after  = ScreenShooter.capture rect
+ *   ScreenShooter.diff(before, after, tolerance: 2)[:mismatches] # => 0
+ *
+ * @param a [ScreenShooter::Image]
+ * @param b [ScreenShooter::Image]
+ * @param opts [Hash]
+ * @return [Hash{Symbol=>Object}]
+ */
+static
+VALUE
+rb_ss_diff(const int argc, VALUE* const argv, __unused const VALUE self)
+{
+    if (argc < 2)
+	rb_raise(rb_eArgError, "wrong number of arguments (%d for 2..3)", argc);
+
+    const VALUE opts = ss_opts_at(argc, argv, 2);
+    ss_compare_t compare;
+    memset(&compare, 0, sizeof(ss_compare_t));
+    compare.a      = ss_image_pixels(argv[0]);
+    compare.b      = ss_image_pixels(argv[1]);
+    compare.kernel = ss_kernel_from(opts);
+
+    if (compare.a->width != compare.b->width || compare.a->height != compare.b->height)
+	rb_raise(rb_eArgError, "cannot diff a %zux%zu image with a %zux%zu image",
+		 compare.a->width, compare.a->height, compare.b->width, compare.b->height);
+
+    const VALUE rb_tolerance = rb_hash_lookup(opts, key_tolerance);
+    const int      tolerance = (rb_tolerance == Qnil ? 0 : NUM2INT(rb_tolerance));
+    if (tolerance < 0 || tolerance > 255)
+	rb_raise(rb_eArgError, "tolerance must be 0-255 (got %d)", tolerance);
+    compare.tolerance = (uint8_t)tolerance;
+
+    VALUE mask = Qnil;
+    if (RTEST(rb_hash_lookup(opts, key_mask))) {
+	mask = rb_str_new(NULL, (long)(compare.a->width * compare.a->height));
+	compare.mask = (uint8_t*)RSTRING_PTR(mask);
+    }
+
+    rb_thread_call_without_gvl(ss_compare, &compare, NULL, NULL);
+    RB_GC_GUARD(argv[0]);
+    RB_GC_GUARD(argv[1]);
+    RB_GC_GUARD(mask);
+
+    const ss_diff_t* const result = &compare.result;
+    const VALUE diff = rb_hash_new();
+    rb_hash_aset(diff, key_mismatches, ULL2NUM(result->mismatches));
+    rb_hash_aset(diff, key_bounds,
+		 result->mismatches ?
+		 wrap_rect(CGRectMake(result->min_x,
+				      result->min_y,
+				      result->max_x - result->min_x + 1,
+				      result->max_y - result->min_y + 1)) :
+		 Qnil);
+    rb_hash_aset(diff, key_mask, (mask == Qnil ? Qnil : rb_obj_freeze(mask)));
+    return diff;
+}
+
+/*
+ * The comparison kernels {diff} can use on this CPU, fastest first
+ *
+ * `:scalar` is always there.
+ *
+ * @return [Array<Symbol>]
+ */
+static
+VALUE
+rb_ss_diff_kernels(__unused const VALUE self)
+{
+    const VALUE kernels = rb_ary_new();
+    for (ss_diff_kernel_t k = SS_DIFF_NEON; k >= SS_DIFF_SCALAR; k--)
+	if (ss_diff_kernel_available(k))
+	    rb_ary_push(kernels, ss_kernel_name(k));
+    return kernels;
+}
+
+
+/*
+ * A recorder keeps the last `capacity` frames of a rect, captured on a
+ * timer in the background into a ring (see frame_ring.h), so the lock
+ * is only held to swap a frame in. Nothing is encoded until someone
+ * asks for it.
+ */
+
+#define SS_RECORDER_DEFAULT_FPS      10
+#define SS_RECORDER_DEFAULT_CAPACITY 30
+
+typedef struct {
+    CGRect            rect;
+    int               synthetic;
+    double            fps;
+    ss_ring_t         ring;     // the spare is only touched on the queue
+    pthread_mutex_t   lock;
+    dispatch_queue_t  queue;
+    dispatch_source_t timer;
+} ss_recorder_t;
+
+static
+void
+ss_recorder_tick(ss_recorder_t* const recorder, const unsigned long ticks)
+{
+    const int    failed = ss_capture(recorder->rect, recorder->synthetic, &recorder->ring.spare);
+    const double   time = ss_now();
+
+    pthread_mutex_lock(&recorder->lock);
+    ss_ring_record(&recorder->ring, ticks, failed, time);
+    pthread_mutex_unlock(&recorder->lock);
+}
+
+static
+void
+ss_recorder_stop(ss_recorder_t* const recorder)
+{
+    if (!recorder->timer)
+	return;
+
+    dispatch_source_cancel(recorder->timer);
+    dispatch_release(recorder->timer);
+    recorder->timer = NULL;
+    dispatch_sync(recorder->queue, ^{}); // wait for an in flight capture
+}
+
+static
+void
+ss_recorder_free(void* const data)
+{
+    ss_recorder_t* const recorder = data;
+    if (recorder->queue) {
+	ss_recorder_stop(recorder);
+	dispatch_release(recorder->queue);
+    }
+    ss_ring_free(&recorder->ring, ss_buffer_checkin);
+    pthread_mutex_destroy(&recorder->lock);
+    xfree(recorder);
+}
+
+static
+ss_recorder_t*
+ss_recorder_data(const VALUE obj)
+{
+    ss_recorder_t* recorder;
+    Data_Get_Struct(obj, ss_recorder_t, recorder);
+    return recorder;
+}
+
+static
+VALUE
+rb_recorder_alloc(const VALUE klass)
+{
+    ss_recorder_t* recorder;
+    const VALUE obj = Data_Make_Struct(klass, ss_recorder_t, NULL, ss_recorder_free, recorder);
+    pthread_mutex_init(&recorder->lock, NULL);
+    return obj;
+}
+
+/*
+ * Set up a recorder for the given rect
+ *
+ * Options:
+ *
+ *  - `:fps` - how many frames to capture each second, more than `0`
+ *    and at most `1000`; defaults to `10`
+ *  - `:capacity` - how many frames to keep, defaults to `30`; once the
+ *    ring is full the oldest frame is overwritten
+ *  - `:source` - `:screen` (default) or `:synthetic`, the same as for
+ *    {ScreenShooter.screenshot}
+ *
+ * Nothing is captured until {#start} is called.
+ *
+ * @param rect [CGRect,#to_rect]
+ * @param opts [Hash]
+ */
+static
+VALUE
+rb_recorder_init(const int argc, VALUE* const argv, const VALUE self)
+{
+    if (argc < 1)
+	rb_raise(rb_eArgError, "wrong number of arguments (0 for 1..2)");
+
+    ss_recorder_t* const recorder = ss_recorder_data(self);
+    if (recorder->ring.slots)
+	rb_raise(rb_eRuntimeError, "recorder is already initialized");
+
+    const VALUE        opts = ss_opts_at(argc, argv, 1);
+    const VALUE      rb_fps = rb_hash_lookup(opts, key_fps);
+    const VALUE rb_capacity = rb_hash_lookup(opts, key_capacity);
+
+    const double fps = (rb_fps == Qnil ? SS_RECORDER_DEFAULT_FPS : NUM2DBL(rb_fps));
+    if (!(fps > 0 && fps <= SS_RING_MAX_FPS))
+	rb_raise(rb_eArgError, "fps must be more than 0 and at most %d (got %f)", SS_RING_MAX_FPS, fps);
+
+    const long capacity = (rb_capacity == Qnil ? SS_RECORDER_DEFAULT_CAPACITY : NUM2LONG(rb_capacity));
+    if (capacity < 1)
+	rb_raise(rb_eArgError, "capacity must be at least 1 (got %ld)", capacity);
+
+    recorder->rect      = unwrap_rect(argv[0]);
+    recorder->synthetic = ss_synthetic_from(opts);
+    recorder->fps       = fps;
+    if (recorder->rect.size.width < 0 || recorder->rect.size.height < 0)
+	recorder->rect = CGRectInfinite;
+
+    if (ss_ring_init(&recorder->ring, (size_t)capacity))
+	rb_memerror();
+    recorder->queue = dispatch_queue_create("org.axelements.accessibility.screen_shooter.recorder",
+					       DISPATCH_QUEUE_SERIAL);
+    return self;
+}
+
+static
+ss_recorder_t*
+ss_recorder_ready(const VALUE self)
+{
+    ss_recorder_t* const recorder = ss_recorder_data(self);
+    if (!recorder->ring.slots)
+	rb_raise(rb_eRuntimeError, "recorder was not initialized");
+    return recorder;
+}
+
+/*
+ * Start capturing frames in the background
+ *
+ * Frames and stats from a previous recording are thrown away.
+ *
+ * @return [Boolean] `false` if already recording
+ */
+static
+VALUE
+rb_recorder_start(const VALUE self)
+{
+    ss_recorder_t* const recorder = ss_recorder_ready(self);
+    if (recorder->timer)
+	return Qfalse;
+
+    pthread_mutex_lock(&recorder->lock);
+    ss_ring_clear(&recorder->ring, ss_buffer_checkin);
+    pthread_mutex_unlock(&recorder->lock);
+
+    const uint64_t interval = ss_ring_interval(recorder->fps);
+    dispatch_source_t const timer =
+	dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, recorder->queue);
+    dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, 0), interval, interval / 10);
+    dispatch_source_set_event_handler(timer, ^{
+	    // more than one tick means the last capture made us miss some
+	    ss_recorder_tick(recorder, dispatch_source_get_data(timer));
+	});
+    recorder->timer = timer;
+    dispatch_resume(timer);
+    return Qtrue;
+}
+
+/*
+ * Stop capturing frames; the frames that were captured are kept
+ *
+ * @return [Boolean] `false` if not recording
+ */
+static
+VALUE
+rb_recorder_stop(const VALUE self)
+{
+    ss_recorder_t* const recorder = ss_recorder_ready(self);
+    if (!recorder->timer)
+	return Qfalse;
+    ss_recorder_stop(recorder);
+    return Qtrue;
+}
+
+/*
+ * Whether frames are being captured
+ *
+ * @return [Boolean]
+ */
+static
+VALUE
+rb_recorder_is_recording(const VALUE self)
+{
+    return (ss_recorder_ready(self)->timer ? Qtrue : Qfalse);
+}
+
+/*
+ * Copies of the frames in the ring, oldest first
+ *
+ * Frames are `:bgra` images and have their capture {Image#time} set.
+ * This can be called while recording.
+ *
+ * @return [Array<ScreenShooter::Image>]
+ */
+static
+VALUE
+rb_recorder_frames(const VALUE self)
+{
+    ss_recorder_t* const recorder = ss_recorder_ready(self);
+
+    // Strings are made before taking the lock, so that the capture queue
+    // never waits on the GC while we hold it. Frames are all the same size
+    // unless the display changes under us, in which case we start over.
+    VALUE              slots_buffer;
+    ss_slot_t* const   seen = ALLOCV_N(ss_slot_t, slots_buffer, recorder->ring.capacity);
+    const VALUE     strings = rb_ary_new();
+    size_t            count = 0;
+    int             resized = 0;
+
+    do {
+	pthread_mutex_lock(&recorder->lock);
+	count = ss_ring_count(&recorder->ring);
+	for (size_t i = 0; i < count; i++)
+	    seen[i] = *ss_ring_newest(&recorder->ring, count, i);
+	pthread_mutex_unlock(&recorder->lock);
+
+	rb_ary_clear(strings);
+	for (size_t i = 0; i < count; i++)
+	    rb_ary_push(strings, rb_str_new(NULL, (long)(seen[i].frame.stride * seen[i].frame.height)));
+
+	// newer frames may have come in, so copy the newest ones that fit
+	resized = 0;
+	pthread_mutex_lock(&recorder->lock);
+	if (ss_ring_count(&recorder->ring) < count) // restarted, so keep what is there now
+	    count = ss_ring_count(&recorder->ring);
+	for (size_t i = 0; i < count; i++) {
+	    const ss_slot_t* const slot = ss_ring_newest(&recorder->ring, count, i);
+	    const VALUE   bytes = rb_ary_entry(strings, (long)i);
+	    const size_t length = slot->frame.stride * slot->frame.height;
+	    if ((size_t)RSTRING_LEN(bytes) != length) {
+		resized = 1;
+		break;
+	    }
+	    memcpy(RSTRING_PTR(bytes), slot->frame.buffer.bytes, length);
+	    seen[i] = *slot;
+	}
+	pthread_mutex_unlock(&recorder->lock);
+    } while (resized);
+
+    const VALUE frames = rb_ary_new2((long)count);
+    for (size_t i = 0; i < count; i++) {
+	const VALUE image = ss_image_wrap(seen[i].frame.width, seen[i].frame.height,
+					  seen[i].frame.stride, sym_bgra,
+					  rb_ary_entry(strings, (long)i));
+	ss_image_data(image)->time = seen[i].time;
+	rb_ary_push(frames, image);
+    }
+
+    ALLOCV_END(slots_buffer);
+    return frames;
+}
+
+/*
+ * Numbers about the current (or last) recording
+ *
+ *  - `:captured` - frames captured, including ones that were overwritten
+ *  - `:frames` - frames in the ring right now
+ *  - `:dropped` - frames that were not captured because capturing the
+ *    previous one took longer than a frame
+ *  - `:failed` - captures that did not work
+ *  - `:fps` - frames per second actually sustained
+ *  - `:bytes` - memory held for frames
+ *
+ * @return [Hash{Symbol=>Numeric}]
+ */
+static
+VALUE
+rb_recorder_stats(const VALUE self)
+{
+    ss_recorder_t* const recorder = ss_recorder_ready(self);
+
+    pthread_mutex_lock(&recorder->lock);
+    const uint64_t captured = recorder->ring.head;
+    const size_t     frames = ss_ring_count(&recorder->ring);
+    const uint64_t  dropped = recorder->ring.dropped;
+    const uint64_t   failed = recorder->ring.failed;
+    const double        fps = ss_ring_fps(&recorder->ring);
+    const size_t      bytes = ss_ring_bytes(&recorder->ring);
+    pthread_mutex_unlock(&recorder->lock);
+
+    const VALUE stats = rb_hash_new();
+    rb_hash_aset(stats, key_captured, ULL2NUM(captured));
+    rb_hash_aset(stats, key_frames,   SIZET2NUM(frames));
+    rb_hash_aset(stats, key_dropped,  ULL2NUM(dropped));
+    rb_hash_aset(stats, key_failed,   ULL2NUM(failed));
+    rb_hash_aset(stats, key_fps,      DBL2NUM(fps));
+    rb_hash_aset(stats, key_bytes,    SIZET2NUM(bytes));
+    return stats;
+}
+
+
+/*
+ * Sequences store frames as tile deltas (see frame_delta.h). The work
+ * is done without the GVL, so each sequence has a lock of its own.
+ */
+
+#define SS_SEQUENCE_DEFAULT_TILE     32
+#define SS_SEQUENCE_DEFAULT_KEYFRAME 30
+
+typedef struct {
+    ss_sequence_t   sequence;
+    pthread_mutex_t lock;
+} ss_seq_t;
+
+static
+void
+ss_seq_free(void* const data)
+{
+    ss_seq_t* const seq = data;
+    ss_sequence_free(&seq->sequence);
+    pthread_mutex_destroy(&seq->lock);
+    xfree(seq);
+}
+
+static
+VALUE
+rb_sequence_alloc(const VALUE klass)
+{
+    ss_seq_t* seq;
+    const VALUE obj = Data_Make_Struct(klass, ss_seq_t, NULL, ss_seq_free, seq);
+    pthread_mutex_init(&seq->lock, NULL);
+    return obj;
+}
+
+static
+ss_seq_t*
+ss_seq_data(const VALUE obj)
+{
+    ss_seq_t* seq;
+    Data_Get_Struct(obj, ss_seq_t, seq);
+    if (!seq->sequence.width)
+	rb_raise(rb_eRuntimeError, "sequence was not initialized");
+    return seq;
+}
+
+static
+int
+ss_level_or(const VALUE opts, const int fallback)
+{
+    return (rb_hash_lookup(opts, key_level) == Qnil ? fallback : ss_level_from(opts));
+}
+
+/*
+ * Set up an empty sequence of `width` by `height` frames, each at
+ * most 65535 pixels
+ *
+ * Options:
+ *
+ *  - `:tile` - the side of a tile in pixels, defaults to `32`
+ *  - `:keyframe_every` - store a whole frame this often, defaults to
+ *    `30`; more keyframes make {#frame} faster and the sequence bigger
+ *  - `:level` - zlib compression level, `0` to `9`, defaults to `6`
+ *
+ * @param width [Integer]
+ * @param height [Integer]
+ * @param opts [Hash]
+ */
+static
+VALUE
+rb_sequence_init(const int argc, VALUE* const argv, const VALUE self)
+{
+    if (argc < 2)
+	rb_raise(rb_eArgError, "wrong number of arguments (%d for 2..3)", argc);
+
+    ss_seq_t* seq;
+    Data_Get_Struct(self, ss_seq_t, seq);
+    if (seq->sequence.width)
+	rb_raise(rb_eRuntimeError, "sequence is already initialized");
+
+    const VALUE      opts = ss_opts_at(argc, argv, 2);
+    const VALUE   rb_tile = rb_hash_lookup(opts, key_tile);
+    const VALUE    rb_key = rb_hash_lookup(opts, key_keyframe_every);
+    const long      width = NUM2LONG(argv[0]);
+    const long     height = NUM2LONG(argv[1]);
+    const long       tile = (rb_tile == Qnil ? SS_SEQUENCE_DEFAULT_TILE : NUM2LONG(rb_tile));
+    const long   keyframe = (rb_key == Qnil ? SS_SEQUENCE_DEFAULT_KEYFRAME : NUM2LONG(rb_key));
+
+    if (width < 1 || height < 1)
+	rb_raise(rb_eArgError, "frames must be at least 1x1 (got %ldx%ld)", width, height);
+    if (width > UINT16_MAX || height > UINT16_MAX)
+	rb_raise(rb_eArgError, "frames can be at most %dx%d (got %ldx%ld)",
+		 UINT16_MAX, UINT16_MAX, width, height);
+    if (tile < 1 || tile > UINT16_MAX)
+	rb_raise(rb_eArgError, "tile must be 1-%d (got %ld)", UINT16_MAX, tile);
+    if (keyframe < 1 || keyframe > INT32_MAX)
+	rb_raise(rb_eArgError, "keyframe_every must be positive (got %ld)", keyframe);
+
+    if (ss_sequence_init(&seq->sequence, (uint32_t)width, (uint32_t)height,
+			 (uint32_t)tile, (uint32_t)keyframe,
+			 ss_level_or(opts, SS_DEFAULT_LEVEL)))
+	rb_raise(rb_eNoMemError, "failed to set up a %ldx%ld sequence", width, height);
+
+    return self;
+}
+
+typedef struct {
+    ss_seq_t*         seq;
+    const ss_image_t* image;
+    size_t            index;
+    uint8_t*          out;
+    ss_png_memory_t   dump;
+    int               result;
+} ss_seq_op_t;
+
+static
+void*
+ss_seq_append(void* const data)
+{
+    ss_seq_op_t* const op = data;
+    pthread_mutex_lock(&op->seq->lock);
+    op->result = ss_sequence_append(&op->seq->sequence,
+				    (const uint8_t*)RSTRING_PTR(op->image->bytes),
+				    op->image->stride);
+    pthread_mutex_unlock(&op->seq->lock);
+    return NULL;
+}
+
+/*
+ * Add a frame to the end of the sequence
+ *
+ * Only the tiles that changed since the last frame are kept, unless
+ * this frame is due to be a keyframe.
+ *
+ * @param image [ScreenShooter::Image] a `:bgra` or `:raw` image the
+ *   same size as the sequence
+ * @return [self]
+ */
+static
+VALUE
+rb_sequence_append(const VALUE self, const VALUE image)
+{
+    ss_seq_op_t op;
+    memset(&op, 0, sizeof(ss_seq_op_t));
+    op.seq   = ss_seq_data(self);
+    op.image = ss_image_pixels(image);
+
+    if (op.image->width != op.seq->sequence.width || op.image->height != op.seq->sequence.height)
+	rb_raise(rb_eArgError, "cannot add a %zux%zu image to a %ux%u sequence",
+		 op.image->width, op.image->height,
+		 op.seq->sequence.width, op.seq->sequence.height);
+
+    rb_thread_call_without_gvl(ss_seq_append, &op, NULL, NULL);
+    RB_GC_GUARD(image);
+
+    if (op.result)
+	rb_raise(rb_eNoMemError, "failed to add a frame to the sequence");
+    return self;
+}
+
+static
+size_t
+ss_seq_count(ss_seq_t* const seq)
+{
+    pthread_mutex_lock(&seq->lock);
+    const size_t count = seq->sequence.count;
+    pthread_mutex_unlock(&seq->lock);
+    return count;
+}
+
+/*
+ * How many frames are in the sequence
+ *
+ * @return [Integer]
+ */
+static
+VALUE
+rb_sequence_size(const VALUE self)
+{
+    return SIZET2NUM(ss_seq_count(ss_seq_data(self)));
+}
+
+static
+void*
+ss_seq_frame(void* const data)
+{
+    ss_seq_op_t* const op = data;
+    pthread_mutex_lock(&op->seq->lock);
+    op->result = ss_sequence_frame(&op->seq->sequence, op->index, op->out);
+    pthread_mutex_unlock(&op->seq->lock);
+    return NULL;
+}
+
+/*
+ * Rebuild a frame from the keyframe before it and the deltas since
+ *
+ * Negative indexes count back from the end, like for arrays.
+ *
+ * @param index [Integer]
+ * @return [ScreenShooter::Image] a `:bgra` image
+ */
+static
+VALUE
+rb_sequence_frame(const VALUE self, const VALUE rb_index)
+{
+    ss_seq_op_t op;
+    memset(&op, 0, sizeof(ss_seq_op_t));
+    op.seq = ss_seq_data(self);
+
+    const long  count = (long)ss_seq_count(op.seq);
+    long        index = NUM2LONG(rb_index);
+    if (index < 0)
+	index += count;
+    if (index < 0 || index >= count)
+	rb_raise(rb_eIndexError, "frame %ld is outside of 0...%ld", NUM2LONG(rb_index), count);
+
+    const size_t  width = op.seq->sequence.width;
+    const size_t height = op.seq->sequence.height;
+    const VALUE   bytes = rb_str_new(NULL, (long)(width * height * 4));
+    op.index = (size_t)index;
+    op.out   = (uint8_t*)RSTRING_PTR(bytes);
+
+    rb_thread_call_without_gvl(ss_seq_frame, &op, NULL, NULL);
+    RB_GC_GUARD(bytes);
+
+    if (op.result)
+	rb_raise(rb_eRuntimeError, "failed to rebuild frame %ld", index);
+    return ss_image_wrap(width, height, width * 4, sym_bgra, bytes);
+}
+
+static
+void*
+ss_seq_dump(void* const data)
+{
+    ss_seq_op_t* const op = data;
+    pthread_mutex_lock(&op->seq->lock);
+    op->result = ss_sequence_dump(&op->seq->sequence, ss_png_write_memory, &op->dump);
+    pthread_mutex_unlock(&op->seq->lock);
+    return NULL;
+}
+
+/*
+ * The sequence in a compact binary format that {load} can read
+ *
+ * @return [String] frozen
+ */
+static
+VALUE
+rb_sequence_dump(const VALUE self)
+{
+    ss_seq_op_t op;
+    memset(&op, 0, sizeof(ss_seq_op_t));
+    op.seq = ss_seq_data(self);
+
+    rb_thread_call_without_gvl(ss_seq_dump, &op, NULL, NULL);
+
+    VALUE dump = Qnil;
+    if (!op.result)
+	dump = rb_str_new((const char*)op.dump.bytes, (long)op.dump.length);
+    free(op.dump.bytes);
+    if (dump == Qnil)
+	rb_raise(rb_eNoMemError, "failed to dump the sequence");
+    return rb_obj_freeze(dump);
+}
+
+/*
+ * Read a sequence from the output of {#dump}
+ *
+ * More frames can be added to it. The `:level` option is used for
+ * frames added after loading.
+ *
+ * @param bytes [String]
+ * @param opts [Hash]
+ * @return [ScreenShooter::Sequence]
+ */
+static
+VALUE
+rb_sequence_load(const int argc, VALUE* const argv, const VALUE klass)
+{
+    if (argc < 1)
+	rb_raise(rb_eArgError, "wrong number of arguments (0 for 1..2)");
+
+    VALUE       bytes = argv[0];
+    const VALUE  opts = ss_opts_at(argc, argv, 1);
+    StringValue(bytes);
+
+    const VALUE  obj = rb_sequence_alloc(klass);
+    ss_seq_t*    seq;
+    Data_Get_Struct(obj, ss_seq_t, seq);
+    if (ss_sequence_load(&seq->sequence,
+			 (const uint8_t*)RSTRING_PTR(bytes), (size_t)RSTRING_LEN(bytes),
+			 ss_level_or(opts, SS_DEFAULT_LEVEL)))
+	rb_raise(rb_eArgError, "not a valid ScreenShooter::Sequence dump");
+    return obj;
+}
+
+/*
+ * Numbers about how well the sequence is compressing
+ *
+ *  - `:frames` - frames in the sequence
+ *  - `:keyframes` - how many of them are keyframes
+ *  - `:tiles` - tiles stored, including the ones in keyframes
+ *  - `:bytes` - compressed size of all the frames
+ *  - `:raw_bytes` - what the frames would take up uncompressed
+ *
+ * @return [Hash{Symbol=>Integer}]
+ */
+static
+VALUE
+rb_sequence_stats(const VALUE self)
+{
+    ss_seq_t* const seq = ss_seq_data(self);
+
+    pthread_mutex_lock(&seq->lock);
+    const ss_sequence_t* const sequence = &seq->sequence;
+    size_t keyframes = 0;
+    size_t     tiles = 0;
+    for (size_t i = 0; i < sequence->count; i++) {
+	keyframes += sequence->frames[i].keyframe;
+	tiles     += sequence->frames[i].tiles;
+    }
+    const size_t count = sequence->count;
+    const size_t bytes = ss_sequence_bytes(sequence);
+    const size_t   raw = count * sequence->width * sequence->height * 4;
+    pthread_mutex_unlock(&seq->lock);
+
+    const VALUE stats = rb_hash_new();
+    rb_hash_aset(stats, key_frames,    SIZET2NUM(count));
+    rb_hash_aset(stats, key_keyframes, SIZET2NUM(keyframes));
+    rb_hash_aset(stats, key_tiles,     SIZET2NUM(tiles));
+    rb_hash_aset(stats, key_bytes,     SIZET2NUM(bytes));
+    rb_hash_aset(stats, key_raw_bytes, SIZET2NUM(raw));
+    return stats;
+}
+
+/* @return [Integer] */
+static VALUE rb_sequence_width(const VALUE self)  { return UINT2NUM(ss_seq_data(self)->sequence.width); }
+/* @return [Integer] */
+static VALUE rb_sequence_height(const VALUE self) { return UINT2NUM(ss_seq_data(self)->sequence.height); }
+
+/*
+ * Statistics about the pixel buffer pool
+ *
+ * Returns how many times a new buffer had to be allocated, how many
+ * times the pooled buffer was reused, and how large the pooled buffer
+ * currently is.
+ *
+ * @return [Hash{Symbol=>Integer}]
+ */
+static
+VALUE
+rb_ss_pool_stats(__unused const VALUE self)
+{
+    pthread_mutex_lock(&ss_pool_lock);
+    const size_t allocations = ss_pool_allocations;
+    const size_t      reuses = ss_pool_reuses;
+    const size_t       bytes = ss_pool.capacity;
+    pthread_mutex_unlock(&ss_pool_lock);
+
+    const VALUE stats = rb_hash_new();
+    rb_hash_aset(stats, key_allocations, SIZET2NUM(allocations));
+    rb_hash_aset(stats, key_reuses,      SIZET2NUM(reuses));
+    rb_hash_aset(stats, key_bytes,       SIZET2NUM(bytes));
+    return stats;
+}
+
 void Init_screen_shooter(void);
 
 void
@@ -53,11 +1894,124 @@ Init_screen_shooter()
     /*
      * Document-module: ScreenShooter
      *
-     * A module that adds a simple API for taking screen shots. It only
-     * uses default options at the moment, so screen shots may not come
-     * out as fancy as they could...this could be fixed in the future...
+     * A module that adds a simple API for taking screen shots. Shots
+     * are saved as PNG files; the compression level and row filter
+     * can be tuned with options to {screenshot}.
      */
     rb_mSS = rb_define_module("ScreenShooter");
     rb_extend_object(rb_mSS, rb_mSS);
-    rb_define_method(rb_mSS, "screenshot", rb_ss_take_shot, 2);
+    rb_define_method(rb_mSS, "screenshot",       rb_ss_screenshot,       -1);
+    rb_define_method(rb_mSS, "pool_stats",       rb_ss_pool_stats,        0);
+    rb_define_method(rb_mSS, "capture",          rb_ss_capture,          -1);
+    rb_define_method(rb_mSS, "capture_elements", rb_ss_capture_elements, -1);
+    rb_define_method(rb_mSS, "diff",             rb_ss_diff,             -1);
+    rb_define_method(rb_mSS, "diff_kernels",     rb_ss_diff_kernels,      0);
+
+    /*
+     * Document-class: ScreenShooter::Image
+     *
+     * Pixels captured by {ScreenShooter.capture}, held in memory.
+     */
+    rb_cImage = rb_define_class_under(rb_mSS, "Image", rb_cObject);
+    rb_undef_alloc_func(rb_cImage);
+    rb_define_singleton_method(rb_cImage, "new", rb_image_new, -1);
+    rb_define_method(rb_cImage, "width",   rb_image_width,   0);
+    rb_define_method(rb_cImage, "height",  rb_image_height,  0);
+    rb_define_method(rb_cImage, "stride",  rb_image_stride,  0);
+    rb_define_method(rb_cImage, "format",  rb_image_format,  0);
+    rb_define_method(rb_cImage, "bytes",   rb_image_bytes,   0);
+    rb_define_method(rb_cImage, "time",    rb_image_time,    0);
+    rb_define_method(rb_cImage, "to_png",  rb_image_to_png, -1);
+    rb_define_method(rb_cImage, "inspect", rb_image_inspect, 0);
+
+    /*
+     * Document-class: ScreenShooter::Recorder
+     *
+     * Keeps a short history of a rect by capturing it in the background
+     * at a steady frame rate, which helps when looking at flaky
+     * animations after the fact.
+     *
+     * @example
+     *
+     *   recorder = ScreenShooter::Recorder.new rect, fps: 20, capacity: 40
+     *   recorder.start
+     *   # ... something flaky ...
+     *   recorder.stop
+     *   recorder.save '~/Desktop/flaky' unless passed?
+     */
+    rb_cRecorder = rb_define_class_under(rb_mSS, "Recorder", rb_cObject);
+    rb_define_alloc_func(rb_cRecorder, rb_recorder_alloc);
+    rb_define_method(rb_cRecorder, "initialize", rb_recorder_init,        -1);
+    rb_define_method(rb_cRecorder, "start",      rb_recorder_start,        0);
+    rb_define_method(rb_cRecorder, "stop",       rb_recorder_stop,         0);
+    rb_define_method(rb_cRecorder, "recording?", rb_recorder_is_recording, 0);
+    rb_define_method(rb_cRecorder, "frames",     rb_recorder_frames,       0);
+    rb_define_method(rb_cRecorder, "stats",      rb_recorder_stats,        0);
+
+    /*
+     * Document-class: ScreenShooter::Sequence
+     *
+     * A series of same sized frames where only the tiles that change
+     * from one frame to the next are stored, plus a whole keyframe
+     * every so often. This keeps dozens of nearly identical screen
+     * shots down to not much more than one.
+     *
+     * @example
+     *
+     *   sequence = ScreenShooter::Sequence.new 1280, 800, keyframe_every: 10
+     *   sequence << ScreenShooter.capture(rect)
+     *   # ...
+     *   File.binwrite 'failure.axsq', sequence.dump
+     *   ScreenShooter::Sequence.load(File.binread 'failure.axsq').frame(-1)
+     */
+    rb_cSequence = rb_define_class_under(rb_mSS, "Sequence", rb_cObject);
+    rb_define_alloc_func(rb_cSequence, rb_sequence_alloc);
+    rb_define_singleton_method(rb_cSequence, "load", rb_sequence_load, -1);
+    rb_define_method(rb_cSequence, "initialize", rb_sequence_init,  -1);
+    rb_define_method(rb_cSequence, "<<",         rb_sequence_append, 1);
+    rb_define_method(rb_cSequence, "size",       rb_sequence_size,   0);
+    rb_define_method(rb_cSequence, "frame",      rb_sequence_frame,  1);
+    rb_define_method(rb_cSequence, "dump",       rb_sequence_dump,   0);
+    rb_define_method(rb_cSequence, "stats",      rb_sequence_stats,  0);
+    rb_define_method(rb_cSequence, "width",      rb_sequence_width,  0);
+    rb_define_method(rb_cSequence, "height",     rb_sequence_height, 0);
+
+    key_level       = ID2SYM(rb_intern("level"));
+    key_filter      = ID2SYM(rb_intern("filter"));
+    key_alpha       = ID2SYM(rb_intern("alpha"));
+    key_source      = ID2SYM(rb_intern("source"));
+    sym_sub         = ID2SYM(rb_intern("sub"));
+    sym_none        = ID2SYM(rb_intern("none"));
+    sym_screen      = ID2SYM(rb_intern("screen"));
+    sym_synthetic   = ID2SYM(rb_intern("synthetic"));
+    key_allocations = ID2SYM(rb_intern("allocations"));
+    key_reuses      = ID2SYM(rb_intern("reuses"));
+    key_bytes       = ID2SYM(rb_intern("bytes"));
+    key_format      = ID2SYM(rb_intern("format"));
+    key_stride      = ID2SYM(rb_intern("stride"));
+    sym_bgra        = ID2SYM(rb_intern("bgra"));
+    sym_png         = ID2SYM(rb_intern("png"));
+    sym_raw         = ID2SYM(rb_intern("raw"));
+    key_tolerance   = ID2SYM(rb_intern("tolerance"));
+    key_mask        = ID2SYM(rb_intern("mask"));
+    key_kernel      = ID2SYM(rb_intern("kernel"));
+    key_mismatches  = ID2SYM(rb_intern("mismatches"));
+    key_bounds      = ID2SYM(rb_intern("bounds"));
+    sym_auto        = ID2SYM(rb_intern("auto"));
+    sym_scalar      = ID2SYM(rb_intern("scalar"));
+    sym_sse2        = ID2SYM(rb_intern("sse2"));
+    sym_avx2        = ID2SYM(rb_intern("avx2"));
+    sym_neon        = ID2SYM(rb_intern("neon"));
+    key_fps         = ID2SYM(rb_intern("fps"));
+    key_capacity    = ID2SYM(rb_intern("capacity"));
+    key_captured    = ID2SYM(rb_intern("captured"));
+    key_frames      = ID2SYM(rb_intern("frames"));
+    key_dropped     = ID2SYM(rb_intern("dropped"));
+    key_failed      = ID2SYM(rb_intern("failed"));
+    key_tile        = ID2SYM(rb_intern("tile"));
+    key_threads     = ID2SYM(rb_intern("threads"));
+    key_keyframe_every = ID2SYM(rb_intern("keyframe_every"));
+    key_keyframes   = ID2SYM(rb_intern("keyframes"));
+    key_tiles       = ID2SYM(rb_intern("tiles"));
+    key_raw_bytes   = ID2SYM(rb_intern("raw_bytes"));
 }
@@ -141,6 +141,32 @@ class URI::Generic
   end
 end
 
+##
+# A URL that is bridged from a `CFURL` and only parsed into a `URI`
+# object when needed
+class Accessibility::URL
+  ##
+  # Forward anything not answered natively to the parsed URI
+  #
+  # Setters and bang methods are called on a copy of the URI, which
+  # then replaces the value of the receiver.
+  def method_missing name, *args, &block
+    uri = cached_uri
+    return super unless uri.respond_to? name
+    return uri.public_send name, *args, &block unless name.to_s.end_with?('=', '!')
+
+    uri    = to_uri
+    result = uri.public_send name, *args, &block
+    replace_uri uri
+    result
+  end
+
+  # @private
+  def respond_to_missing? name, include_private = false
+    cached_uri.respond_to?(name) || super
+  end
+end
+
 ##
 # `accessibility-core` extensions to the `String` class
 class String
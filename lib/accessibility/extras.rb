@@ -1,3 +1,4 @@
 require 'accessibility/bridge'
 require 'accessibility/extras/common'
+require 'accessibility/extras/battery_sampler'
 require 'accessibility/extras/extras.bundle'
@@ -0,0 +1,130 @@
+module Battery
+
+  ##
+  # Caches {Battery.snapshot} readings for a minimum interval and
+  # notifies listeners when the battery information changes
+  #
+  # Anything that responds to `#snapshot` and returns a hash can be used
+  # as the power source provider, which makes it possible to drive the
+  # sampler with canned readings.
+  #
+  # @example
+  #
+  #   sampler = Battery::Sampler.new interval: 5
+  #   sampler.on_change(:state) { |now, was| puts "#{was} -> #{now}" }
+  #   sampler[:level] # => 0.87 (at most one real reading every 5 seconds)
+  #
+  class Sampler
+
+    # @return [Float]
+    attr_reader :interval
+
+    # @return [#snapshot]
+    attr_reader :provider
+
+    # @param opts [Hash]
+    # @option opts [Number] :interval (1.0) minimum seconds between readings
+    # @option opts [#snapshot] :provider (Battery)
+    # @option opts [#call] :clock a monotonic clock returning seconds
+    def initialize opts = {}
+      @interval  = opts.fetch(:interval, 1.0).to_f
+      @provider  = opts.fetch(:provider) { Battery }
+      @clock     = opts.fetch(:clock) { method(:monotonic_time) }
+      @listeners = []
+      @lock      = Mutex.new
+      @last      = nil
+      @taken_at  = nil
+    end
+
+    ##
+    # The most recent reading, taking a new one if the cached reading is
+    # older than the minimum interval
+    #
+    # @return [Hash{Symbol=>Object}]
+    def snapshot
+      reading = @lock.synchronize { @last if fresh? }
+      reading || refresh
+    end
+
+    ##
+    # Look up a single field of the current {#snapshot}
+    #
+    # @param field [Symbol]
+    def [] field
+      snapshot[field]
+    end
+
+    ##
+    # Take a new reading right away, regardless of the interval
+    #
+    # Listeners are notified before this method returns if anything
+    # they care about changed.
+    #
+    # @return [Hash{Symbol=>Object}]
+    def refresh
+      reading = @provider.snapshot.dup.freeze
+      previous, listeners = @lock.synchronize {
+        was       = @last
+        @last     = reading
+        @taken_at = @clock.call
+        [was, @listeners.dup]
+      }
+      notify listeners, reading, previous if previous && previous != reading
+      reading
+    end
+
+    ##
+    # Register a block to be called when a reading differs from the
+    # previous one
+    #
+    # If fields are given, the block is only called when one of those
+    # fields changes. The block receives the new and old values of the
+    # field when exactly one field is watched, otherwise the new and old
+    # snapshots.
+    #
+    # @param fields [Array<Symbol>]
+    # @yieldparam now [Object]
+    # @yieldparam was [Object]
+    # @return [Proc] the block, which can be given to {#remove_listener}
+    def on_change *fields, &block
+      raise ArgumentError, 'a block is required' unless block
+      listener = [fields, block]
+      @lock.synchronize { @listeners << listener }
+      block
+    end
+
+    ##
+    # Stop calling a block that was registered with {#on_change}
+    #
+    # @param block [Proc]
+    def remove_listener block
+      @lock.synchronize { @listeners.reject! { |_, listener| listener.equal? block } }
+      self
+    end
+
+
+    private
+
+    def fresh?
+      @taken_at && (@clock.call - @taken_at) < @interval
+    end
+
+    def notify listeners, reading, previous
+      listeners.each do |fields, block|
+        if fields.empty?
+          block.call reading, previous
+        elsif fields.size == 1
+          field = fields.first
+          block.call reading[field], previous[field] if reading[field] != previous[field]
+        elsif fields.any? { |field| reading[field] != previous[field] }
+          block.call reading, previous
+        end
+      end
+    end
+
+    def monotonic_time
+      Process.clock_gettime Process::CLOCK_MONOTONIC
+    end
+
+  end
+end
@@ -3,15 +3,56 @@ require 'accessibility/screen_shooter/screen_shooter.bundle'
 
 module ScreenShooter
 
+  ##
+  # Take a screen shot and save it to a time stamped file in `path`
+  #
+  # Options are passed on to {screenshot}.
+  #
+  # @return [String] the path to the new file
   def shoot rect = CGRect.new(CGPoint.new(0, 0), CGSize.new(-1, -1)),
-            path = '~/Downloads'
+            path = '~/Downloads', opts = {}
 
     path = File.expand_path path.to_s
     path = "#{path}/AXElements-ScreenShot-#{Time.now.strftime '%Y%m%d%H%M%S'}.png"
 
-    raise 'Failed to save screenshot' unless screenshot rect, path
+    raise 'Failed to save screenshot' unless screenshot rect, path, opts
 
     path
   end
 
+  class Recorder
+
+    ##
+    # Encode the recorded frames as PNG files in `dir`, oldest first
+    #
+    # Options are passed on to {Image#to_png}.
+    #
+    # @return [Array<String>] paths to the new files
+    def save dir = '~/Downloads', opts = {}
+      dir = File.expand_path dir.to_s
+      Dir.mkdir dir unless Dir.exist? dir
+      frames.each_with_index.map do |frame, index|
+        path = format('%s/AXElements-Frame-%04d.png', dir, index)
+        File.binwrite path, frame.to_png(opts)
+        path
+      end
+    end
+
+  end
+
+  class Sequence
+
+    ##
+    # Capture `rect` and add it to the end of the sequence
+    #
+    # Options are passed on to {ScreenShooter.capture}, except for
+    # `:format`, which has to be `:bgra`.
+    #
+    # @return [self]
+    def capture rect, opts = {}
+      self << ScreenShooter.capture(rect, opts.merge(format: :bgra))
+    end
+
+  end
+
 end
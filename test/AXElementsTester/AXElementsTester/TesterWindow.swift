@@ -14,6 +14,12 @@ let AXIsNyan : NSString               = "AXIsNyan"
 let AXURLAttribute : NSString         = "AXURL"
 let AXDescriptionAttribute : NSString = "AXDescription"
 let AXData : NSString                 = "AXData"
+let AXSimulatedTextLength : NSString  = "AXSimulatedTextLength"
+let AXSimulatedTextBroken : NSString  = "AXSimulatedTextBroken"
+let AXNumberOfCharacters : NSString   = "AXNumberOfCharacters"
+let AXStringForRange : NSString       = "AXStringForRange"
+let AXSimulatedTreeSize : NSString    = "AXSimulatedTreeSize"
+let AXSimulatedTreeChurn : NSString   = "AXSimulatedTreeChurn"
 
 class TesterWindow : NSWindow {
 
@@ -23,9 +29,107 @@ class TesterWindow : NSWindow {
         AXIsNyan,
         AXURLAttribute,
         AXDescriptionAttribute,
-        AXData
+        AXData,
+        AXSimulatedTextLength,
+        AXSimulatedTextBroken,
+        AXNumberOfCharacters,
+        AXSimulatedTreeSize,
+        AXSimulatedTreeChurn
     ]
 
+    // The window also stands in for a text view of any size: its text is
+    // generated from the index of each character, so reading millions of
+    // characters does not need them to be held anywhere, and it can be
+    // told to answer AXStringForRange with a number instead of a string
+    var simulated_length : Int  = 0
+    var simulated_broken : Bool = false
+
+    func simulated_text(_ range : NSRange) -> String {
+        let digits = Array("0123456789".utf16)
+        let start  = min(range.location, simulated_length)
+        let end    = min(range.location + range.length, simulated_length)
+        let units  = (start ..< end).map { digits[$0 % 10] }
+        return String(utf16CodeUnits: units, count: units.count)
+    }
+
+    // Likewise, setting AXSimulatedTreeSize hangs a tree of that many
+    // generated elements (ten children to a node) off the window, and
+    // setting AXSimulatedTreeChurn to a percentage replaces that share of
+    // its leaves with new elements, one for one, so the shape of the tree
+    // never changes even though its elements do
+    var simulated_tree   : NSAccessibilityElement?
+    var simulated_nodes  : Int = 0
+    var simulated_serial : Int = 0
+    var simulated_churn  : Int = 0
+
+    func simulated_node(_ parent : Any) -> NSAccessibilityElement {
+        let node = NSAccessibilityElement()
+        simulated_serial += 1
+        node.setAccessibilityRole(NSAccessibilityGroupRole)
+        node.setAccessibilityIdentifier("Simulated \(simulated_serial)")
+        node.setAccessibilityParent(parent)
+        node.setAccessibilityFrame(self.frame)
+        return node
+    }
+
+    func build_simulated_tree(_ size : Int) {
+        simulated_nodes = max(size, 0)
+        simulated_tree  = nil
+        if (simulated_nodes == 0) {
+            return
+        }
+
+        let root = simulated_node(self)
+        root.setAccessibilityIdentifier("Simulated Tree")
+        var queue = [root]
+        var made  = 1
+        var next  = 0
+        while (made < simulated_nodes) {
+            let parent = queue[next]
+            next += 1
+            var kids : [NSAccessibilityElement] = []
+            for _ in 0 ..< min(10, simulated_nodes - made) {
+                kids.append(simulated_node(parent))
+            }
+            made += kids.count
+            queue.append(contentsOf: kids)
+            parent.setAccessibilityChildren(kids)
+        }
+        simulated_tree = root
+    }
+
+    func churn_simulated_tree(_ percent : Int) {
+        simulated_churn = percent
+        guard let root = simulated_tree, percent > 0 else {
+            return
+        }
+
+        var parents : [NSAccessibilityElement] = []
+        var queue   = [root]
+        while let node = queue.popLast() {
+            let kids = (node.accessibilityChildren() ?? []) as! [NSAccessibilityElement]
+            if (kids.isEmpty) {
+                continue
+            }
+            parents.append(node)
+            queue.append(contentsOf: kids)
+        }
+
+        // every (100 / percent)th leaf, starting somewhere new each time
+        let step  = max(100 / min(percent, 100), 1)
+        var index = simulated_serial % step
+        for parent in parents {
+            var kids = parent.accessibilityChildren() as! [NSAccessibilityElement]
+            for i in 0 ..< kids.count where (kids[i].accessibilityChildren() ?? []).isEmpty {
+                if (index % step == 0) {
+                    kids[i] = simulated_node(parent)
+                }
+                index += 1
+            }
+            parent.setAccessibilityChildren(kids)
+        }
+    }
+
     override func accessibilityAttributeNames() -> [Any] {
         return (super.accessibilityAttributeNames() as NSArray)
                 .addingObjects(from: extra_attrs)
@@ -50,7 +154,69 @@ class TesterWindow : NSWindow {
         if (name == AXData as String) {
             return (try? Data(contentsOf: URL(fileURLWithPath: "/bin/cat")))
         }
+        if (name == AXSimulatedTextLength as String ||
+            name == AXNumberOfCharacters as String) {
+            return simulated_length
+        }
+        if (name == AXSimulatedTextBroken as String) {
+            return simulated_broken
+        }
+        if (name == AXSimulatedTreeSize as String) {
+            return simulated_nodes
+        }
+        if (name == AXSimulatedTreeChurn as String) {
+            return simulated_churn
+        }
+        if (name == NSAccessibilityChildrenAttribute), let tree = simulated_tree {
+            let children = super.accessibilityAttributeValue(name) as? [Any] ?? []
+            return children + [tree]
+        }
         return super.accessibilityAttributeValue(name)
     }
 
+    override func accessibilityIsAttributeSettable(_ name : String) -> Bool {
+        if (name == AXSimulatedTextLength as String ||
+            name == AXSimulatedTextBroken as String ||
+            name == AXSimulatedTreeSize as String ||
+            name == AXSimulatedTreeChurn as String) {
+            return true
+        }
+        return super.accessibilityIsAttributeSettable(name)
+    }
+
+    override func accessibilitySetValue(_ value : Any?, forAttribute name : String) {
+        if (name == AXSimulatedTextLength as String) {
+            simulated_length = (value as? NSNumber)?.intValue ?? 0
+        }
+        else if (name == AXSimulatedTextBroken as String) {
+            simulated_broken = (value as? NSNumber)?.boolValue ?? false
+        }
+        else if (name == AXSimulatedTreeSize as String) {
+            build_simulated_tree((value as? NSNumber)?.intValue ?? 0)
+        }
+        else if (name == AXSimulatedTreeChurn as String) {
+            churn_simulated_tree((value as? NSNumber)?.intValue ?? 0)
+        }
+        else {
+            super.accessibilitySetValue(value, forAttribute: name)
+        }
+    }
+
+    override func accessibilityParameterizedAttributeNames() -> [Any] {
+        return (super.accessibilityParameterizedAttributeNames() as NSArray)
+                .adding(AXStringForRange)
+    }
+
+    override func accessibilityAttributeValue(_ name : String,
+                                              forParameter param : Any?) -> Any? {
+        if (name == AXStringForRange as String) {
+            if (simulated_broken) {
+                return 42
+            }
+            let range = (param as? NSValue)?.rangeValue ?? NSRange(location: 0, length: 0)
+            return simulated_text(range)
+        }
+        return super.accessibilityAttributeValue(name, forParameter: param)
+    }
+
 }
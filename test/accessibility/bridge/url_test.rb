@@ -0,0 +1,88 @@
+require 'test/helper'
+require 'accessibility/bridge'
+
+class TestAccessibilityURL < Minitest::Test
+
+  def url string
+    Accessibility::URL.new string
+  end
+
+  def pkg
+    url 'https://macruby.macosforge.org/files/nightlies/macruby_nightly-latest.pkg'
+  end
+
+  def test_new_rejects_garbage
+    assert_raises(ArgumentError) { url 'not a url at all' }
+  end
+
+  def test_native_accessors
+    assert_equal 'https', pkg.scheme
+    assert_equal '/files/nightlies/macruby_nightly-latest.pkg', pkg.path
+    assert_equal 'macruby_nightly-latest.pkg', pkg.lastPathComponent
+    assert_equal 'pkg', pkg.pathExtension
+
+    desktop = url 'file:///localhost/Users/mrada/Desktop/'
+    assert_equal 'file', desktop.scheme
+    assert_equal 'Desktop', desktop.lastPathComponent
+    assert_equal '', desktop.pathExtension
+  end
+
+  def test_to_s_and_inspect
+    string = 'file:///Applications/Calculator.app/'
+    assert_equal string, url(string).to_s
+    assert_match(/Accessibility::URL file:\/\/\/Applications/, url(string).inspect)
+  end
+
+  def test_to_uri_returns_a_copy
+    link = pkg
+    uri  = link.to_uri
+    assert_kind_of URI::Generic, uri
+    assert_equal URI.parse(pkg.to_s), uri
+    refute_same uri, link.to_uri
+    refute uri.frozen?
+
+    uri.path = '/elsewhere'
+    assert_equal pkg, link
+  end
+
+  def test_forwarded_setters_change_the_url
+    link = pkg
+    assert_equal '/files/other.dmg', (link.path = '/files/other.dmg')
+    assert_equal '/files/other.dmg', link.path
+    assert_equal 'dmg', link.pathExtension
+    assert_equal 'https://macruby.macosforge.org/files/other.dmg', link.to_s
+    assert_equal 'macruby.macosforge.org', link.host
+  end
+
+  def test_to_url_returns_self
+    link = pkg
+    assert_same link, link.to_url
+  end
+
+  def test_forwards_to_uri
+    assert_equal 'macruby.macosforge.org', pkg.host
+    assert pkg.respond_to? :host
+    assert_raises(NoMethodError) { pkg.herp_derp }
+  end
+
+  def test_equality
+    assert_equal pkg, pkg
+    assert pkg.eql? pkg
+    assert_equal pkg.hash, pkg.hash
+    assert_equal pkg, URI.parse(pkg.to_s)
+    refute_equal pkg, url('http://macruby.org')
+    refute_equal pkg, pkg.to_s
+  end
+
+  def test_hash_works_as_a_hash_key
+    assert_kind_of Integer, pkg.hash
+    assert_equal 1, { pkg => 1 }[pkg]
+  end
+
+  def test_round_trip_through_nsdata
+    path = __FILE__
+    data = NSData.dataWithContentsOfURL url("file://#{path}")
+    assert_equal File.read(path), data.to_str
+  end
+
+end
@@ -0,0 +1,82 @@
+require 'test/accessibility/core/fixture'
+
+class ApplicationTest < Minitest::Test
+
+  def handle
+    Accessibility::Application.for PID
+  end
+
+  def test_for_is_cached_per_pid
+    assert_kind_of Accessibility::Application, handle
+    assert_same handle, Accessibility::Application.for(PID)
+    assert_raises(ArgumentError) { Accessibility::Application.for 0 }
+  end
+
+  def test_element
+    assert_equal APP, handle.element
+    assert_same  handle.element, Accessibility::Element.application_for(PID)
+  end
+
+  def test_element_application_is_shared
+    window = APP.attribute('AXWindows').first
+    assert_same handle.element, window.application
+    assert_same window.application, window.application
+  end
+
+  def test_element_remembers_its_handle
+    window = APP.attribute('AXWindows').first
+    window.application
+    assert_same handle, window.instance_variable_get(:@application)
+  end
+
+  def test_pid
+    assert_equal PID, handle.pid
+  end
+
+  def test_bundle_identifier
+    assert_equal APP_BUNDLE_IDENTIFIER, handle.bundle_identifier
+    assert handle.bundle_identifier.frozen?
+  end
+
+  def test_localized_name
+    assert_equal 'AXElementsTester', handle.localized_name
+  end
+
+  def test_terminated?
+    refute handle.terminated?
+  end
+
+  def test_application_raises_once_the_app_quits
+    running = lambda {
+      NSWorkspace.sharedWorkspace.runningApplications.select { |app|
+        app.bundleIdentifier == APP_BUNDLE_IDENTIFIER
+      }.map(&:processIdentifier)
+    }
+    before = running.call
+    `open -n #{APP_BUNDLE_PATH}`
+    deadline = Time.now + 10
+    sleep 0.1 until (pid = (running.call - before).first) || Time.now > deadline
+    assert pid, 'second copy of the fixture never started'
+    sleep 2
+
+    element = Accessibility::Element.application_for pid
+    assert_same element, element.application
+
+    Process.kill :KILL, pid
+    deadline = Time.now + 10
+    sleep 0.1 while (Process.kill(0, pid) rescue nil) && Time.now < deadline
+
+    assert_raises(ArgumentError) { element.application }
+    assert_raises(ArgumentError) { Accessibility::Application.for pid }
+  ensure
+    Process.kill :KILL, pid rescue nil if pid
+  end
+
+  def test_timeout
+    assert_equal 10, handle.timeout = 10
+    assert_equal 10, handle.timeout
+  ensure
+    handle.timeout = 0
+  end
+
+end
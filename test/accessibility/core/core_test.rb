@@ -235,6 +235,39 @@ class CoreTest < Minitest::Test
   end
 
 
+  def test_structured_errors
+    error = assert_raises(ArgumentError) { app.perform '' }
+    assert_kind_of Accessibility::Error, error
+    assert_kind_of Integer,              error.code
+    assert_equal   app,                  error.element
+    assert_equal   error.class::CODE,    error.code
+    refute_empty   error.message
+    assert_same    error.message,        error.message
+
+    error = assert_raises(Accessibility::Error) { invalid_element.set 'AXTitle', 'hi' }
+    assert_kind_of Accessibility::InvalidElementError, error
+    assert_equal   invalid_element,                    error.element
+    assert_match(/probably dead/, error.message)
+  end
+
+  def test_error_classes_do_not_shadow_ruby
+    assert_same ::NotImplementedError, Accessibility.const_get(:NotImplementedError)
+    assert_operator Accessibility::NotImplementedAXError, :<, ::NotImplementedError
+    assert_operator Accessibility::NotImplementedAXError, :<, Accessibility::Error
+  end
+
+  def test_try_attribute
+    assert_equal ['AXWindow', 0], window.try_attribute('AXRole')
+
+    value, code = app.try_attribute('MADE_UP_ATTR')
+    assert_nil value
+    refute_equal 0, code
+
+    assert_equal [nil, Accessibility::InvalidElementError::CODE],
+      invalid_element.try_attribute('AXRole')
+  end
+
+
   # @!group Tests for instance methods
 
   def test_role
@@ -307,6 +340,64 @@ class CoreTest < Minitest::Test
     }
   end
 
+  def test_each_text_chunk
+    text = ('The quick brown fox jumps over the lazy dog. ' * 50) + "\u{1F984}" * 60
+    text_area.set 'AXValue', text
+
+    chunks = []
+    assert_same text_area, text_area.each_text_chunk(chunk_size: 64) { |c| chunks << c }
+    assert chunks.size > 1
+    chunks.each { |chunk| assert chunk.encode('UTF-16LE').bytesize <= 128 }
+    assert_equal text, chunks.join
+
+    assert_equal text, text_area.each_text_chunk.to_a.join
+    assert_raises(ArgumentError) { text_area.each_text_chunk(chunk_size: 0) { } }
+    assert_empty invalid_element.each_text_chunk.to_a
+  ensure
+    text_area.set 'AXValue', ''
+  end
+
+  def test_each_text_chunk_keeps_surrogate_pairs
+    text = "a\u{1F984}b\u{1F984}\u{1F984}"
+    text_area.set 'AXValue', text
+
+    chunks = text_area.each_text_chunk(chunk_size: 2).to_a
+    chunks.each { |chunk| assert chunk.valid_encoding?, chunk.inspect }
+    assert_equal text, chunks.join
+  ensure
+    text_area.set 'AXValue', ''
+  end
+
+  # the fixture window generates '0123456789...' of whatever length it is told
+  def test_each_text_chunk_streams_a_simulated_text_element
+    window.set 'AXSimulatedTextLength', 1_000_003
+
+    total = 0
+    window.each_text_chunk(chunk_size: 4096) { |chunk|
+      assert chunk.size <= 4096
+      assert_equal ('0123456789' * 411)[total % 10, chunk.size], chunk
+      total += chunk.size
+    }
+    assert_equal 1_000_003, total
+  ensure
+    window.set 'AXSimulatedTextLength', 0
+  end
+
+  def test_each_text_chunk_raises_when_the_text_is_not_a_string
+    window.set 'AXSimulatedTextLength', 100
+    window.set 'AXSimulatedTextBroken', true
+    assert_raises(TypeError) { window.each_text_chunk { } }
+  ensure
+    window.set 'AXSimulatedTextBroken', false
+    window.set 'AXSimulatedTextLength', 0
+  end
+
+  def test_each_text_chunk_checks_arguments
+    assert_raises(ArgumentError) { text_area.each_text_chunk(chunk_size: 1) { } }
+    assert_raises(TypeError)     { text_area.each_text_chunk(1024) { } }
+    assert_raises(ArgumentError) { text_area.each_text_chunk({}, {}) { } }
+  end
+
   def test_actions
     assert_empty                   app.actions
     assert_equal ['AXPress'], yes_button.actions
@@ -359,6 +450,17 @@ class CoreTest < Minitest::Test
     assert_equal false, window.invalid?
   end
 
+  def test_partition_valid
+    valid, invalid = Accessibility::Element.partition_valid [app, invalid_element, window]
+    assert_equal [app, window],    valid
+    assert_equal [invalid_element], invalid
+
+    # known dead elements are remembered, so this should be a cache hit
+    assert_equal [[], [invalid_element]],
+      Accessibility::Element.partition_valid([invalid_element])
+    assert_equal [[], []], Accessibility::Element.partition_valid([])
+  end
+
   def test_set_timeout_to
     assert_equal 10, app.set_timeout_to(10)
     assert_equal 0,  app.set_timeout_to(0)
@@ -388,6 +490,56 @@ class CoreTest < Minitest::Test
     # test manually for now :(
   end
 
+  def test_snapshot
+    snapshot = Accessibility::Snapshot.new window
+    assert_equal window, snapshot.root
+    assert snapshot.size > window.children.size
+    assert_includes snapshot, search_box
+    refute_includes snapshot, invalid_element
+    assert_empty snapshot.diff(snapshot)
+  end
+
+  def test_snapshot_diff
+    old_value = search_box.value
+    before    = Accessibility::Snapshot.new window, ['AXValue']
+    search_box.set 'AXValue', 'snapshot'
+    after     = Accessibility::Snapshot.new window, ['AXValue']
+
+    assert_includes before.diff(after),
+      [:changed, search_box, 'AXValue', old_value, 'snapshot']
+    assert_includes after.diff(before),
+      [:changed, search_box, 'AXValue', 'snapshot', old_value]
+
+    assert_raises(ArgumentError) { before.diff Accessibility::Snapshot.new(window) }
+  ensure
+    search_box.set 'AXValue', ''
+  end
+
+  def test_snapshot_refresh
+    snapshot  = Accessibility::Snapshot.new window, ['AXValue']
+    refreshed = snapshot.refresh
+    assert_equal snapshot.size, refreshed.size
+    assert_empty snapshot.diff(refreshed)
+  end
+
+  # 111 generated nodes: the root, ten groups and a hundred leaves
+  def test_snapshot_refresh_notices_replaced_children
+    window.set 'AXSimulatedTreeSize', 111
+    tree = window.children.find { |x| x.attribute('AXIdentifier') == 'Simulated Tree' }
+    snapshot = Accessibility::Snapshot.new tree
+    assert_equal 111, snapshot.size
+
+    window.set 'AXSimulatedTreeChurn', 10 # same shape, ten new leaves
+    refreshed = snapshot.refresh
+    assert_equal 111, refreshed.size
+
+    records = snapshot.diff refreshed
+    assert_equal 10, records.count { |record| record.first == :added }
+    assert_equal 10, records.count { |record| record.first == :removed }
+  ensure
+    window.set 'AXSimulatedTreeSize', 0
+  end
+
   def test_equality
     assert_equal window, window
     assert_equal slider, slider
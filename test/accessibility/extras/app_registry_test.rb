@@ -0,0 +1,92 @@
+require 'test/helper'
+require 'accessibility/extras'
+
+class AppRegistryTest < Minitest::Test
+
+  FakeApp  = Struct.new(:processIdentifier, :bundleIdentifier, :localizedName)
+  DatedApp = Struct.new(:processIdentifier, :bundleIdentifier, :localizedName, :launchDate)
+
+  def fake_registry
+    @procs = [
+              FakeApp.new(10, 'com.example.one', 'One'),
+              FakeApp.new(11, 'com.example.two', 'Two')
+             ]
+    Accessibility::AppRegistry.new(-> { @procs })
+  end
+
+  def test_first_poll_adds_everything
+    registry = fake_registry
+    assert_equal [@procs.dup, []], registry.poll
+    assert_equal 2, registry.size
+    assert_same @procs.first, registry[10]
+  end
+
+  def test_poll_only_returns_deltas
+    registry = fake_registry
+    registry.poll
+    assert_equal [[], []], registry.poll
+
+    gone     = @procs.shift
+    launched = FakeApp.new(12, 'com.example.three', 'Three')
+    @procs << launched
+    assert_equal [[launched], [gone]], registry.poll
+    assert_nil registry[10]
+    assert_equal [11, 12], registry.apps.map(&:processIdentifier).sort
+  end
+
+  def test_bundle_identifier_index
+    registry = fake_registry
+    @procs << FakeApp.new(12, 'com.example.one', 'One')
+    registry.poll
+
+    assert_equal [10, 12], registry.with_bundle_identifier('com.example.one').map(&:processIdentifier)
+    assert_equal [11],     registry.named('Two').map(&:processIdentifier)
+    assert_empty registry.with_bundle_identifier('com.example.nope')
+
+    @procs.shift
+    registry.poll
+    assert_equal [12], registry.with_bundle_identifier('com.example.one').map(&:processIdentifier)
+  end
+
+  def test_wildcard_queries
+    registry = fake_registry
+    registry.poll
+
+    assert_equal [10, 11], registry.matching('com.example.*').map(&:processIdentifier).sort
+    assert_equal [11],     registry.matching('*.two').map(&:processIdentifier)
+    assert_equal [10],     registry.matching_name('O?e').map(&:processIdentifier)
+    assert_empty registry.matching('org.*')
+  end
+
+  def test_reused_pids_are_reported_as_new_apps
+    old      = DatedApp.new(10, 'com.example.one', 'One', Time.at(1))
+    procs    = [old]
+    registry = Accessibility::AppRegistry.new(-> { procs })
+    registry.poll
+
+    procs = [DatedApp.new(10, 'com.example.one', 'One', Time.at(1))]
+    assert_equal [[], []], registry.poll
+    assert_same old, registry[10]
+
+    reborn = DatedApp.new(10, 'com.example.two', 'Two', Time.at(2))
+    procs  = [reborn]
+    assert_equal [[reborn], [old]], registry.poll
+    assert_same  reborn, registry[10]
+    assert_empty registry.with_bundle_identifier('com.example.one')
+    assert_equal [reborn], registry.with_bundle_identifier('com.example.two')
+  end
+
+  def test_running_applications
+    registry     = Accessibility::AppRegistry.new
+    added, gone  = registry.poll
+    refute_empty added
+    assert_empty gone
+    assert_kind_of NSRunningApplication, added.first
+
+    # wrappers are stable between polls
+    pid = added.first.processIdentifier
+    registry.poll
+    assert_same added.first, registry[pid]
+  end
+
+end
@@ -0,0 +1,98 @@
+require 'test/helper'
+require 'accessibility/extras/battery_sampler'
+
+class BatterySamplerTest < Minitest::Test
+
+  ##
+  # Stands in for the system power source, handing out canned readings
+  class FakePowerSource
+    attr_reader :reads
+    attr_accessor :reading
+
+    def initialize reading
+      @reading = reading
+      @reads   = 0
+    end
+
+    def snapshot
+      @reads += 1
+      @reading.dup
+    end
+  end
+
+  def setup
+    @now    = 0.0
+    @source = FakePowerSource.new state: :discharging, level: 0.5,
+                                  time_to_empty: 120, time_to_full_charge: -1
+  end
+
+  def sampler interval = 5
+    Battery::Sampler.new interval: interval, provider: @source, clock: -> { @now }
+  end
+
+  def test_readings_are_cached_for_the_interval
+    s = sampler
+    assert_equal :discharging, s[:state]
+    assert_equal 0.5, s[:level]
+    assert_equal 1, @source.reads
+
+    @now += 4.9
+    s.snapshot
+    assert_equal 1, @source.reads
+
+    @now += 0.1
+    s.snapshot
+    assert_equal 2, @source.reads
+  end
+
+  def test_snapshots_are_frozen
+    assert sampler.snapshot.frozen?
+  end
+
+  def test_refresh_ignores_the_interval
+    s = sampler
+    s.snapshot
+    s.refresh
+    assert_equal 2, @source.reads
+  end
+
+  def test_change_callbacks
+    s       = sampler
+    changes = []
+    states  = []
+    s.on_change { |now, was| changes << [now[:level], was[:level]] }
+    s.on_change(:state) { |now, was| states << [now, was] }
+
+    s.snapshot
+    assert_empty changes # nothing to compare the first reading with
+
+    @source.reading = @source.reading.merge level: 0.4
+    s.refresh
+    assert_equal [[0.4, 0.5]], changes
+    assert_empty states
+
+    @source.reading = @source.reading.merge state: :charging
+    s.refresh
+    assert_equal [[:charging, :discharging]], states
+    assert_equal 2, changes.size
+
+    s.refresh
+    assert_equal 2, changes.size
+  end
+
+  def test_remove_listener
+    s     = sampler
+    calls = 0
+    block = s.on_change { calls += 1 }
+    s.snapshot
+    s.remove_listener block
+    @source.reading = @source.reading.merge level: 0.1
+    s.refresh
+    assert_equal 0, calls
+  end
+
+  def test_on_change_needs_a_block
+    assert_raises(ArgumentError) { sampler.on_change }
+  end
+
+end
@@ -30,4 +30,13 @@ class BatteryTest < Minitest::Test
     #assert Battery.time_to_empty > 0 || Battery.time_to_full_charge > 0
   end
 
+  def test_snapshot
+    snapshot = Battery.snapshot
+    assert_equal [:state, :level, :time_to_empty, :time_to_full_charge], snapshot.keys
+    assert_includes states, snapshot[:state]
+    assert_kind_of Float, snapshot[:level]
+    assert_kind_of Integer, snapshot[:time_to_empty]
+    assert_kind_of Integer, snapshot[:time_to_full_charge]
+  end
+
 end
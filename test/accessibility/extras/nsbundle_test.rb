@@ -30,4 +30,75 @@ class NSBundleTest < Minitest::Test
     end
   end
 
+  def test_info_is_cached_and_frozen
+    b = bundle
+    assert_same b.infoDictionary, b.infoDictionary
+    assert b.infoDictionary.frozen?
+
+    version = b.objectForInfoDictionaryKey 'CFBundleShortVersionString'
+    assert version.frozen?
+    assert_same version, b.objectForInfoDictionaryKey('CFBundleShortVersionString')
+    assert_nil b.objectForInfoDictionaryKey('NotARealKeyAtAll')
+  end
+
+  def make_bundles dir, count
+    Array.new(count) do |n|
+      path = File.join dir, "Fixture#{n}.app", 'Contents'
+      FileUtils.mkdir_p path
+      File.write File.join(path, 'Info.plist'), <<-PLIST
+<?xml version="1.0" encoding="UTF-8"?>
+<!DOCTYPE plist PUBLIC "-//Apple//DTD PLIST 1.0//EN" "http://www.apple.com/DTDs/PropertyList-1.0.dtd">
+<plist version="1.0">
+<dict>
+  <key>CFBundleIdentifier</key><string>com.example.fixture#{n}</string>
+  <key>CFBundleName</key><string>Fixture #{n}</string>
+  <key>CFBundleVersion</key><string>1.#{n}</string>
+  <key>CFBundlePackageType</key><string>APPL</string>
+</dict>
+</plist>
+      PLIST
+      Accessibility::URL.new "file://#{File.dirname path}/"
+    end
+  end
+
+  def test_info_for_many_bundles
+    require 'tmpdir'
+    require 'fileutils'
+    Dir.mktmpdir do |dir|
+      urls    = make_bundles dir, 50
+      missing = Accessibility::URL.new "file://#{dir}/Missing.app/"
+      keys    = ['CFBundleName', 'CFBundleVersion', 'NotARealKeyAtAll']
+
+      [false, true].each do |parallel|
+        infos = NSBundle.info_for urls + [missing], keys, parallel: parallel
+        assert_equal 51, infos.size
+        assert_nil infos.last
+        infos.first(50).each_with_index do |info, n|
+          expected = { 'CFBundleName' => "Fixture #{n}",
+                       'CFBundleVersion' => "1.#{n}",
+                       'NotARealKeyAtAll' => nil }
+          assert_equal expected, info
+          assert info.frozen?
+          assert info['CFBundleName'].frozen?
+        end
+      end
+
+      single = NSBundle.bundleWithURL urls[7]
+      assert_equal single.objectForInfoDictionaryKey('CFBundleName'),
+                   NSBundle.info_for([urls[7]], ['CFBundleName']).first['CFBundleName']
+    end
+  end
+
+  def test_info_for_raises_cleanly_on_bad_urls
+    require 'tmpdir'
+    Dir.mktmpdir do |dir|
+      urls = make_bundles dir, 3
+      bad  = Object.new
+      def bad.to_s; raise IOError, 'not a url'; end
+
+      assert_raises(IOError) { NSBundle.info_for urls + [bad], ['CFBundleName'] }
+      assert_equal 3, NSBundle.info_for(urls, ['CFBundleName']).compact.size
+    end
+  end
+
 end
@@ -1,5 +1,6 @@
 require 'test/helper'
 require 'accessibility/extras'
+require 'thread'
 
 class NSHostTest < Minitest::Test
 #  try_to_parallelize!
@@ -37,4 +38,109 @@ class NSHostTest < Minitest::Test
     assert_equal `swift #{script 'local_name'}`.chomp, host.localizedName
   end
 
+  def test_results_are_frozen_and_cached
+    assert host.names.frozen?
+    assert host.names.first.frozen?
+    assert host.addresses.frozen?
+    assert host.localizedName.frozen?
+    assert_same host.names, host.names
+  end
+
+  ##
+  # Answers host lookups like NSHost, but each lookup of names waits
+  # until the test lets it through, so the test decides when a lookup
+  # finishes instead of racing a clock
+  class GatedResolver
+    attr_reader :calls
+
+    def initialize name
+      @name    = name
+      @calls   = 0
+      @entered = Queue.new
+      @gate    = Queue.new
+    end
+
+    def names
+      @calls += 1
+      @entered << @calls
+      @gate.pop
+      ["#{@name}#{@calls}.local"]
+    end
+
+    def addresses
+      ['10.0.0.1']
+    end
+
+    def localizedName
+      "#{@name}#{@calls}"
+    end
+
+    # block until a lookup has started, and return which one it is
+    def wait_for_lookup
+      @entered.pop
+    end
+
+    def finish_lookup
+      @gate << true
+    end
+  end
+
+  def test_refresh_does_not_block_callers
+    resolver = GatedResolver.new 'host'
+    resolver.finish_lookup # let the first lookup through right away
+    NSHost.resolver = resolver
+    assert_equal ['host1.local'], host.names # nothing cached yet, so this waits
+    assert NSHost.resolved?
+    assert_equal 1, resolver.wait_for_lookup
+
+    NSHost.refresh
+    assert_equal 2, resolver.wait_for_lookup
+
+    # the second lookup is stuck until we finish it, yet callers get
+    # the cached values without waiting for it
+    10.times { assert_equal 'host1', host.localizedName }
+    assert_equal ['host1.local'], host.names
+
+    resolver.finish_lookup
+    100_000.times do
+      break if host.names != ['host1.local']
+      Thread.pass
+    end
+    assert_equal ['host2.local'], host.names
+    assert_equal 'host2', host.localizedName
+    assert_equal 2, resolver.calls
+  ensure
+    resolver.finish_lookup if resolver # never leave a lookup stuck
+    NSHost.resolver = nil
+  end
+
+  ##
+  # Answers host lookups like NSHost, right away
+  class StandInResolver
+    def initialize name
+      @name = name
+    end
+
+    def names
+      ["#{@name}.local"]
+    end
+
+    def addresses
+      ['10.0.0.1']
+    end
+
+    def localizedName
+      @name
+    end
+  end
+
+  def test_stand_in_values_are_frozen
+    NSHost.resolver = StandInResolver.new('frozen')
+    assert host.names.frozen?
+    assert host.names.first.frozen?
+    assert_equal ['10.0.0.1'], host.addresses
+  ensure
+    NSHost.resolver = nil
+  end
+
 end
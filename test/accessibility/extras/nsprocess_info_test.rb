@@ -31,4 +31,85 @@ class NSProcessInfoTest < Minitest::Test
     assert_equal `sysctl -n hw.memsize`.chomp.to_i, pinfo.physicalMemory
   end
 
+  def fake_sample time
+    { time: time, uptime: 100.0 + time, cpus: 8, active_cpus: 4,
+      load: [1.5, 1.0, 0.5], memory: 16 << 30, free_memory: 1 << 30 }
+  end
+
+  def with_ring capacity
+    NSProcessInfo.stop_sampling
+    NSProcessInfo.start_sampling capacity: capacity, interval: 3_600
+    NSProcessInfo.stop_sampling
+    NSProcessInfo.clear_samples
+    yield
+  ensure
+    NSProcessInfo.clear_samples
+  end
+
+  def test_recorded_samples_come_back_in_order
+    with_ring 16 do
+      [10.0, 20.0, 30.0].each { |t| NSProcessInfo.record_sample fake_sample(t) }
+      samples = NSProcessInfo.samples
+      assert_equal [10.0, 20.0, 30.0], samples.map { |s| s[:time] }
+      assert_equal fake_sample(20.0), samples[1]
+    end
+  end
+
+  def test_samples_since
+    with_ring 16 do
+      [10.0, 20.0, 30.0].each { |t| NSProcessInfo.record_sample fake_sample(t) }
+      assert_equal [30.0], NSProcessInfo.samples(since: 20.0).map { |s| s[:time] }
+      assert_equal [20.0, 30.0], NSProcessInfo.samples(since: Time.at(15)).map { |s| s[:time] }
+    end
+  end
+
+  def test_ring_keeps_the_latest_samples
+    with_ring 3 do
+      (1..5).each { |t| NSProcessInfo.record_sample fake_sample(t.to_f) }
+      assert_equal [3.0, 4.0, 5.0], NSProcessInfo.samples.map { |s| s[:time] }
+    end
+  end
+
+  def test_sample_now
+    with_ring 4 do
+      sample = NSProcessInfo.sample_now
+      assert_equal pinfo.processorCount, sample[:cpus]
+      assert_equal pinfo.physicalMemory, sample[:memory]
+      assert_equal 3, sample[:load].size
+      assert_equal [sample], NSProcessInfo.samples
+    end
+  end
+
+  def test_background_sampling
+    with_ring 64 do
+      assert NSProcessInfo.start_sampling(interval: 0.05)
+      refute NSProcessInfo.start_sampling
+      assert NSProcessInfo.sampling?
+      deadline = Time.now + 5
+      sleep 0.01 until NSProcessInfo.samples.size >= 3 || Time.now > deadline
+      assert NSProcessInfo.stop_sampling
+      refute NSProcessInfo.sampling?
+
+      times = NSProcessInfo.samples.map { |s| s[:time] }
+      assert_operator times.size, :>=, 3
+      assert_equal times.sort, times
+    end
+  end
+
+  def test_sampling_arguments
+    assert_raises(ArgumentError) { NSProcessInfo.start_sampling interval: 0 }
+    assert_raises(ArgumentError) { NSProcessInfo.start_sampling capacity: 0 }
+    refute NSProcessInfo.sampling?
+  end
+
+  def test_sampling_arguments_are_checked_while_running
+    with_ring 4 do
+      assert NSProcessInfo.start_sampling(interval: 0.05)
+      assert_raises(ArgumentError) { NSProcessInfo.start_sampling interval: -1 }
+      assert_raises(ArgumentError) { NSProcessInfo.start_sampling capacity: 0 }
+    end
+  ensure
+    NSProcessInfo.stop_sampling
+  end
+
 end
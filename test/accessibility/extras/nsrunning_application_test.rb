@@ -24,6 +24,11 @@ class NSRunningApplicationTest < Minitest::Test
     assert_kind_of NSRunningApplication, terminals.first
   end
 
+  def test_running_apps_with_bundle_id_are_cached
+    assert_same terminals.first, terminals.first
+    assert_empty NSRunningApplication.runningApplicationsWithBundleIdentifier('com.example.nope')
+  end
+
   # what does this even mean for a regular ruby script?
   def test_running_app_current_app
     assert_equal app, NSRunningApplication.currentApplication
@@ -75,6 +80,17 @@ class NSRunningApplicationTest < Minitest::Test
     assert_match %r{/Applications/Utilities/Terminal.app}, terminals.first.bundleURL.path
   end
 
+  def test_immutable_properties_are_memoized
+    terminal = terminals.first
+    [:localizedName, :bundleIdentifier, :bundleURL, :executableURL, :launchDate].each do |property|
+      value = terminal.send property
+      assert value.frozen?, "#{property} should be frozen"
+      assert_same value, terminal.send(property)
+    end
+    assert_nil app.bundleIdentifier
+    assert_nil app.bundleIdentifier
+  end
+
   def test_executable_arch
     assert_kind_of Integer, app.executableArchitecture
   end
@@ -21,6 +21,176 @@ class NSWorkspaceTest < Minitest::Test
     assert_equal 'com.apple.Terminal', shared.menuBarOwningApplication.bundleIdentifier
   end
 
+  ##
+  # Pretends to launch an app, taking `delay` polls to get through
+  # each phase of the launch
+  class FakeLauncher
+    attr_reader :launched
+
+    def initialize delay, accept = true
+      @delay  = delay
+      @accept = accept
+      @polls  = Hash.new(0)
+    end
+
+    def launch bundle_id
+      @launched = bundle_id
+      @accept
+    end
+
+    def pid_for bundle_id
+      ready?(:pid) ? 4242 : nil
+    end
+
+    def reached? pid, phase
+      ready? phase
+    end
+
+    private
+
+    def ready? phase
+      (@polls[phase] += 1) > @delay
+    end
+  end
+
+  def test_launch_and_wait_with_stand_in
+    launcher = FakeLauncher.new 2
+    result   = shared.launch_and_wait('com.example.app', until: :window, launcher: launcher)
+
+    assert_equal 'com.example.app', launcher.launched
+    assert_equal 4242, result[:pid]
+    assert_equal [:requested, :pid, :launched, :responsive, :window], result[:phases].keys
+    assert_equal result[:phases].values.sort, result[:phases].values
+  end
+
+  def test_launch_and_wait_stops_at_the_requested_phase
+    result = shared.launch_and_wait('com.example.app', until: :pid, launcher: FakeLauncher.new(0))
+    assert_equal [:requested, :pid], result[:phases].keys
+  end
+
+  def test_launch_and_wait_failures
+    assert_raises(ArgumentError) {
+      shared.launch_and_wait('com.example.app', launcher: FakeLauncher.new(0, false))
+    }
+    assert_raises(RuntimeError) {
+      shared.launch_and_wait('com.example.app', timeout: 0.05, launcher: FakeLauncher.new(1_000))
+    }
+    assert_raises(ArgumentError) {
+      shared.launch_and_wait('com.example.app', until: :lunch, launcher: FakeLauncher.new(0))
+    }
+  end
+
+  ##
+  # Pretends to launch many apps, each taking its own number of polls to
+  # finish launching, and logs when each one starts and finishes so that
+  # tests can look at the overlap without timing anything
+  class LatencyLauncher
+    attr_reader :log, :max_in_flight
+
+    def initialize latencies, refuse = []
+      @latencies     = latencies
+      @refuse        = refuse
+      @pids          = {}
+      @polls         = Hash.new 0
+      @done          = {}
+      @log           = []
+      @max_in_flight = 0
+    end
+
+    def launch bundle_id
+      return false if @refuse.include? bundle_id
+      @pids[bundle_id] = 1000 + @pids.size
+      @log << [:launch, bundle_id]
+      @max_in_flight = [@max_in_flight, @pids.size - @done.size].max
+      true
+    end
+
+    def pid_for bundle_id
+      @pids[bundle_id]
+    end
+
+    # an app gets one poll of :launched per pass; once enough passes
+    # have gone by, every phase is ready at once
+    def reached? pid, phase
+      id = @pids.key pid
+      @polls[id] += 1 if phase == :launched
+      ready = @polls[id] >= @latencies[id]
+      if ready && phase == :window && !@done[id]
+        @done[id] = true
+        @log << [:done, id]
+      end
+      ready
+    end
+  end
+
+  def test_launch_all_with_stand_in
+    rng       = Random.new 1337
+    ids       = (1..8).map { |n| "com.example.app#{n}" }
+    latencies = Hash[ids.map { |id| [id, 5 + rng.rand(10)] }]
+    launcher  = LatencyLauncher.new latencies
+
+    results = shared.launch_all ids, concurrency: 4, launcher: launcher
+
+    assert_equal ids, results.map { |r| r[:bundle_id] }
+    results.each do |result|
+      assert_nil result[:error]
+      assert_kind_of Integer, result[:pid]
+      assert_equal [:requested, :pid, :launched, :responsive, :window], result[:phases].keys
+    end
+
+    # apps are started in order, four at a time, and each finished app
+    # makes room for the next one
+    launches = launcher.log.select { |event, _| event == :launch }.map(&:last)
+    assert_equal ids, launches
+    assert_equal ids.first(4).map { |id| [:launch, id] }, launcher.log.first(4)
+    assert_equal 4, launcher.max_in_flight
+    assert_equal 16, launcher.log.size
+  end
+
+  def test_launch_all_reports_failures_per_app
+    ids      = ['com.example.fast', 'com.example.refused', 'com.example.slow']
+    launcher = LatencyLauncher.new({ 'com.example.fast' => 0, 'com.example.slow' => 1_000_000 },
+                                   ['com.example.refused'])
+    results  = shared.launch_all ids, timeout: 0.1, concurrency: 1, launcher: launcher
+
+    assert_nil results[0][:error]
+    assert_match(/could not launch/, results[1][:error])
+    assert_nil results[1][:pid]
+    assert_match(/did not reach :window/, results[2][:error])
+    assert_equal [:requested, :pid], results[2][:phases].keys
+  end
+
+  def test_launch_all_raises_what_the_stand_in_raises
+    launcher = Object.new
+    def launcher.launch bundle_id
+      raise IOError, 'stand-in failed'
+    end
+    assert_raises(IOError) { shared.launch_all ['com.example.app'], launcher: launcher }
+  end
+
+  def test_launch_all_validates_concurrency
+    assert_raises(ArgumentError) {
+      shared.launch_all ['com.example.app'], concurrency: 0, launcher: LatencyLauncher.new({})
+    }
+    assert_equal [], shared.launch_all([], launcher: LatencyLauncher.new({}))
+  end
+
+  def test_launch_and_wait
+    id     = 'com.apple.Grab'
+    result = shared.launch_and_wait id, until: :window, timeout: 10
+    app    = NSRunningApplication.runningApplicationWithProcessIdentifier result[:pid]
+    assert_equal id, app.bundleIdentifier
+    assert app.finishedLaunching?
+
+    # every phase has to be seen through NSRunningApplication, which
+    # only updates while the main run loop is spun
+    phases = result[:phases]
+    assert_equal [:requested, :pid, :launched, :responsive, :window], phases.keys
+    assert_equal phases.values.sort, phases.values
+  ensure
+    app.terminate if app
+  end
+
   def test_launch_app_and_terminate_it
     id = 'com.apple.Grab'
     assert shared.launchAppWithBundleIdentifier( id,
@@ -0,0 +1,100 @@
+require 'test/helper'
+require 'accessibility/highlighter'
+require 'accessibility/extras'
+
+class HighlighterBatchTest < Minitest::Test
+
+  def rect x, y, w, h
+    [x, y, w, h].to_rect
+  end
+
+  def batch rects, opts = {}
+    @batch = Accessibility::Highlighter.batch rects, { headless: true }.merge(opts)
+  end
+
+  def teardown
+    @batch.stop if @batch
+  end
+
+  # where a rect should land in the overlay
+  def layout r
+    flipped = r.flip!
+    origin  = @batch.frame.origin
+    CGRect.new(CGPoint.new(flipped.origin.x - origin.x, flipped.origin.y - origin.y), flipped.size)
+  end
+
+  def test_one_redraw_for_all_rects
+    rects = Array.new(200) { |i| rect (i % 20) * 30, (i / 20) * 30, 25, 25 }
+    batch rects, color: NSColor.greenColor
+    assert_equal 1, @batch.redraws
+    assert_equal rects, @batch.rects
+
+    calls = @batch.draw_calls
+    assert_equal 200, calls.size
+    calls.zip(rects).each do |(op, drawn, color), r|
+      assert_equal :fill, op
+      assert_equal layout(r.dup), drawn
+      assert_equal NSColor.greenColor, color
+    end
+  end
+
+  def test_add_and_remove
+    batch [rect(10, 10, 50, 50)]
+    ids = @batch.add [rect(100, 100, 20, 20), rect(200, 50, 10, 10)], color: NSColor.redColor
+    assert_equal 2, ids.size
+    assert_equal 2, @batch.redraws
+    assert_equal [NSColor.magentaColor, NSColor.redColor, NSColor.redColor],
+                 @batch.draw_calls.map(&:last)
+
+    single = @batch.add [5, 5, 5, 5]
+    assert_equal 1, single.size
+    assert_equal 4, @batch.rects.size
+
+    assert_equal 2, @batch.remove(ids)
+    assert_equal 4, @batch.redraws
+    assert_equal [rect(10, 10, 50, 50), rect(5, 5, 5, 5)], @batch.rects
+
+    assert_equal 0, @batch.remove(ids)
+    assert_equal 4, @batch.redraws # nothing changed, so no redraw
+
+    @batch.remove single.first
+    assert_equal [layout(rect(10, 10, 50, 50))], @batch.draw_calls.map { |call| call[1] }
+  end
+
+  def test_bad_rect_adds_nothing
+    batch []
+    assert_raises(NoMethodError) { @batch.add [rect(1, 1, 1, 1), Object.new] }
+    assert_empty @batch.rects
+    assert_equal 1, @batch.redraws
+  end
+
+  def test_headless_has_no_window
+    batch [rect(1, 2, 3, 4)]
+    refute @batch.visible?
+  end
+
+  def test_window
+    @batch = Accessibility::Highlighter.batch [rect(100, 100, 100, 100)], colour: NSColor.cyanColor
+    assert @batch.visible?
+    assert_empty @batch.draw_calls
+    @batch.add rect(300, 300, 50, 50)
+    assert_equal 2, @batch.rects.size
+    @batch.stop
+    refute @batch.visible?
+
+    # a stopped batch is not headless, so it still records nothing
+    @batch.add rect(10, 10, 10, 10)
+    assert_equal 3, @batch.rects.size
+    assert_empty @batch.draw_calls
+  end
+
+  def test_remove_many
+    rects = Array.new(5_000) { |i| rect i % 100, i / 100, 1, 1 }
+    batch rects
+    ids = @batch.add rects
+    assert_equal 5_000, @batch.remove(ids)
+    assert_equal rects, @batch.rects
+    assert_equal 5_000, @batch.draw_calls.size
+  end
+
+end
@@ -0,0 +1,107 @@
+require 'test/helper'
+require 'accessibility/highlighter'
+require 'accessibility/extras'
+
+class HighlighterPoolTest < Minitest::Test
+
+  def setup
+    @limit = Accessibility::Highlighter.pool_limit
+    Accessibility::Highlighter.drain
+  end
+
+  def teardown
+    Accessibility::Highlighter.pool_limit = @limit
+  end
+
+  def bounds
+    [100, 100, 100, 100].to_rect
+  end
+
+  def stats
+    Accessibility::Highlighter.pool_stats
+  end
+
+  def highlight opts = {}
+    Accessibility::Highlighter.new bounds, opts
+  end
+
+  def test_headless_cycles_reuse_one_surface
+    before = stats
+    10_000.times { highlight(headless: true).stop }
+    after  = stats
+    assert_operator after[:created] - before[:created], :<=, 1
+    assert_operator after[:reused]  - before[:reused],  :>=, 9_999
+    assert_equal before[:in_use], after[:in_use]
+  end
+
+  def test_stopped_highlighters_let_go_of_their_window
+    a = highlight headless: true
+    a.stop
+    b = highlight headless: true
+    refute a.visible?
+    assert b.visible?
+
+    a.stop # must not hide b
+    assert b.visible?
+    b.stop
+    refute b.visible?
+  end
+
+  def test_reused_windows_are_reconfigured
+    highlight(color: NSColor.redColor).stop
+    before = stats
+
+    rect = [300, 200, 50, 80].to_rect
+    w    = Accessibility::Highlighter.new rect, color: NSColor.blueColor
+    assert_equal before[:reused] + 1, stats[:reused]
+    assert_equal rect.flip!, w.frame
+    assert_equal NSColor.blueColor, w.color
+    assert w.visible?
+    w.stop
+  end
+
+  def test_pool_is_bounded
+    Accessibility::Highlighter.pool_limit = 2
+    before = stats
+    Array.new(5) { highlight }.each(&:stop)
+    after  = stats
+    assert_equal 2, after[:idle]
+    assert_equal before[:released] + 3, after[:released]
+
+    Accessibility::Highlighter.pool_limit = 1
+    assert_equal 1, stats[:idle]
+  end
+
+  def test_drain
+    Array.new(3) { highlight }.each(&:stop)
+    assert_equal 3, stats[:idle]
+    assert_equal 3, Accessibility::Highlighter.drain
+    assert_equal 0, stats[:idle]
+    assert_equal 0, Accessibility::Highlighter.drain
+  end
+
+  def test_drain_leaves_showing_highlighters_alone
+    w = highlight
+    Accessibility::Highlighter.drain
+    assert w.visible?
+    w.stop
+  end
+
+  def make_garbage count
+    count.times { highlight headless: true }
+    nil
+  end
+
+  def test_collected_highlighters_are_handed_back_on_the_main_thread
+    before = stats[:in_use]
+    make_garbage 100
+    GC.start
+    # the conservative GC may keep a few alive from the stack
+    assert_operator stats[:in_use], :<, before + 100
+  end
+
+  def test_bad_limit
+    assert_raises(ArgumentError) { Accessibility::Highlighter.pool_limit = -1 }
+  end
+
+end
@@ -0,0 +1,119 @@
+require 'test/helper'
+require 'accessibility/highlighter'
+require 'accessibility/extras'
+
+class HighlighterTimeoutTest < Minitest::Test
+
+  def setup
+    Accessibility::Highlighter.fake_clock = true
+  end
+
+  def teardown
+    @highlighters.each(&:stop) if @highlighters
+    Accessibility::Highlighter.fake_clock = false
+  end
+
+  def highlight timeout
+    @highlighters ||= []
+    w = Accessibility::Highlighter.new [100, 100, 100, 100].to_rect, timeout: timeout
+    @highlighters << w
+    w
+  end
+
+  def advance seconds
+    Accessibility::Highlighter.advance seconds
+  end
+
+  def pending
+    Accessibility::Highlighter.pending
+  end
+
+  def test_millisecond_precision
+    early = highlight 0.005
+    late  = highlight 0.006
+    assert_equal 2, pending
+
+    assert_equal 0, advance(0.004)
+    assert early.visible?
+
+    assert_equal 1, advance(0.001)
+    refute early.visible?
+    assert late.visible?
+    assert_equal 1, pending
+
+    assert_equal 1, advance(0.001)
+    refute late.visible?
+    assert_equal 0, pending
+  end
+
+  def test_timeouts_longer_than_the_wheel
+    w = highlight 2.5
+    assert_equal 0, advance(2.499)
+    assert w.visible?
+    assert_equal 1, advance(0.001)
+    refute w.visible?
+  end
+
+  def test_expiring_together
+    ws = Array.new(50) { highlight 0.1 }
+    highlight 0.2
+    assert_equal 51, pending
+    assert_equal 50, advance(0.15)
+    ws.each { |w| refute w.visible? }
+    assert_equal 1, pending
+  end
+
+  def test_zero_timeout_expires_on_the_next_tick
+    w = highlight 0
+    assert w.visible?
+    assert_equal 1, advance(0.001)
+    refute w.visible?
+  end
+
+  def test_stop_cancels_the_timeout
+    w = highlight 1
+    highlight 1
+    w.stop
+    assert_equal 1, pending
+    assert_equal 1, advance(1)
+  end
+
+  def fake_clock= fake
+    Accessibility::Highlighter.fake_clock = fake
+  end
+
+  def test_advancing_carries_over_to_the_next_fake_session
+    advance 2.5
+    self.fake_clock = false
+    self.fake_clock = true
+
+    early = highlight 0.005
+    highlight 0.006
+    assert_equal 0, advance(0.004)
+    assert_equal 1, advance(0.001)
+    refute early.visible?
+    assert_equal 1, advance(0.001)
+  end
+
+  def test_real_timeouts_after_advancing_the_fake_clock
+    advance 2.5
+    self.fake_clock = false
+
+    highlight 0.1
+    start    = Time.now
+    deadline = start + 2
+    sleep 0.01 until pending.zero? || Time.now > deadline
+    assert_equal 0, pending
+    assert_operator Time.now - start, :<, 1
+  end
+
+  def test_bad_arguments
+    assert_raises(ArgumentError) { highlight(-1) }
+    assert_equal 0, pending
+    assert_raises(ArgumentError) { advance(-1) }
+
+    Accessibility::Highlighter.fake_clock = false
+    assert_raises(RuntimeError) { advance 1 }
+  end
+
+end
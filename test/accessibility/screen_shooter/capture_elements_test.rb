@@ -0,0 +1,75 @@
+require 'test/helper'
+require 'accessibility/screen_shooter'
+
+class ScreenShooterCaptureElementsTest < Minitest::Test
+
+  # stands in for a UI element, the way anything with #to_rect can
+  class Control
+    attr_reader :frame
+    def initialize x, y, w, h
+      @frame = CGRect.new(CGPoint.new(x, y), CGSize.new(w, h))
+    end
+    def to_rect
+      @frame
+    end
+  end
+
+  def controls
+    # a grid of 50 controls, some of them overlapping
+    Array.new(50) { |i| Control.new 20 + (i % 10) * 35, 40 + (i / 10) * 25, 40, 22 }
+  end
+
+  def test_crops_match_separate_captures
+    images = ScreenShooter.capture_elements controls, source: :synthetic
+    assert_equal 50, images.size
+    controls.zip(images).each do |control, image|
+      expected = ScreenShooter.capture control.frame, source: :synthetic
+      assert_equal [40, 22, :bgra], [image.width, image.height, image.format]
+      assert_equal expected.bytes, image.bytes
+      refute_nil image.time
+    end
+  end
+
+  def test_captures_once
+    before = ScreenShooter.pool_stats
+    ScreenShooter.capture_elements controls, source: :synthetic
+    after  = ScreenShooter.pool_stats
+    assert_equal 1, (after[:allocations] + after[:reuses]) - (before[:allocations] + before[:reuses])
+  end
+
+  def test_far_apart_groups_are_captured_separately
+    corners = [Control.new(0, 0, 20, 20), Control.new(25, 0, 20, 20),
+               Control.new(1500, 900, 20, 20)]
+    before = ScreenShooter.pool_stats
+    images = ScreenShooter.capture_elements corners, source: :synthetic
+    after  = ScreenShooter.pool_stats
+    assert_equal 2, (after[:allocations] + after[:reuses]) - (before[:allocations] + before[:reuses])
+
+    corners.zip(images).each do |control, image|
+      assert_equal ScreenShooter.capture(control.frame, source: :synthetic).bytes, image.bytes
+    end
+  end
+
+  def test_elements_without_a_frame
+    empty  = Control.new 5, 5, 0, 0
+    images = ScreenShooter.capture_elements [empty, Control.new(1, 2, 3, 4), empty], source: :synthetic
+    assert_nil images.first
+    assert_nil images.last
+    assert_equal [1 ^ 2, 2, 1, 255], images[1].bytes[0, 4].unpack('C4')
+
+    assert_equal [nil], ScreenShooter.capture_elements([empty], source: :synthetic)
+    assert_equal [], ScreenShooter.capture_elements([], source: :synthetic)
+  end
+
+  def test_takes_rects
+    rect   = CGRect.new(CGPoint.new(7, 9), CGSize.new(3, 3))
+    images = ScreenShooter.capture_elements [rect], source: :synthetic
+    assert_equal [7 ^ 9, 9, 7, 255], images.first.bytes[0, 4].unpack('C4')
+  end
+
+  def test_screen
+    images = ScreenShooter.capture_elements [Control.new(0, 0, 10, 10), Control.new(50, 50, 10, 10)]
+    images.each { |image| assert_operator image.width, :>=, 10 }
+  end
+
+end
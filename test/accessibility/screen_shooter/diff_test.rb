@@ -0,0 +1,104 @@
+require 'test/helper'
+require 'accessibility/screen_shooter'
+
+class ScreenShooterDiffTest < Minitest::Test
+
+  def image w, h, bytes, opts = {}
+    ScreenShooter::Image.new w, h, bytes, opts
+  end
+
+  def random_bytes size, rng
+    Array.new(size) { rng.rand(256) }.pack('C*')
+  end
+
+  # what every kernel should agree with
+  def reference a, b, w, h, stride_a, stride_b, tolerance
+    count = 0
+    box   = nil
+    mask  = ''.b
+    h.times do |y|
+      w.times do |x|
+        pa = a.byteslice(y * stride_a + x * 4, 4).bytes
+        pb = b.byteslice(y * stride_b + x * 4, 4).bytes
+        differs = pa.zip(pb).any? { |ca, cb| (ca - cb).abs > tolerance }
+        mask << (differs ? 255 : 0).chr
+        next unless differs
+        count += 1
+        box = box ? [[box[0], x].min, [box[1], y].min, [box[2], x].max, [box[3], y].max] : [x, y, x, y]
+      end
+    end
+    [count, box, mask]
+  end
+
+  def bounds_of diff
+    r = diff[:bounds]
+    r && [r.origin.x, r.origin.y, r.origin.x + r.size.width - 1, r.origin.y + r.size.height - 1].map(&:to_i)
+  end
+
+  def test_kernels_match_reference
+    rng = Random.new 42
+    kernels = ScreenShooter.diff_kernels
+    assert_includes kernels, :scalar
+
+    [[1, 1], [15, 3], [16, 2], [33, 5], [67, 4], [200, 3]].each do |w, h|
+      stride_a = w * 4 + 8
+      stride_b = w * 4
+      a = random_bytes stride_a * h, rng
+      b = ''.b
+      h.times { |y| b << a.byteslice(y * stride_a, stride_b) }
+      (w * h / 4 + 1).times do
+        at = rng.rand(b.bytesize)
+        b.setbyte at, (b.getbyte(at) + rng.rand(-20..20)) % 256
+      end
+
+      [0, 9].each do |tolerance|
+        count, box, mask = reference a, b, w, h, stride_a, stride_b, tolerance
+        kernels.each do |kernel|
+          diff = ScreenShooter.diff image(w, h, a, stride: stride_a), image(w, h, b),
+                                    tolerance: tolerance, mask: true, kernel: kernel
+          msg = "#{kernel} on #{w}x#{h} with tolerance #{tolerance}"
+          assert_equal count, diff[:mismatches], msg
+          assert_equal box, bounds_of(diff), msg
+          assert_equal mask, diff[:mask], msg
+        end
+      end
+    end
+  end
+
+  def test_identical_images
+    bytes = "\1\2\3\4" * 64
+    diff  = ScreenShooter.diff image(8, 8, bytes), image(8, 8, bytes)
+    assert_equal({ mismatches: 0, bounds: nil, mask: nil }, diff)
+  end
+
+  def test_bounding_box
+    a = "\0" * (100 * 50 * 4)
+    b = a.dup
+    [[10, 5], [70, 40], [33, 20]].each { |x, y| b.setbyte((y * 100 + x) * 4 + 3, 1) }
+    diff = ScreenShooter.diff image(100, 50, a), image(100, 50, b), mask: true
+    assert_equal 3, diff[:mismatches]
+    assert_equal [10, 5, 70, 40], bounds_of(diff)
+    assert diff[:mask].frozen?
+    assert_equal 255, diff[:mask].getbyte(20 * 100 + 33)
+  end
+
+  def test_synthetic_captures
+    rect = CGRect.new(CGPoint.new(0, 0), CGSize.new(64, 64))
+    a = ScreenShooter.capture rect, source: :synthetic
+    b = ScreenShooter.capture rect, source: :synthetic, format: :raw
+    assert_equal 0, ScreenShooter.diff(a, b)[:mismatches]
+  end
+
+  def test_bad_arguments
+    a = image 2, 2, "\0" * 16
+    assert_raises(ArgumentError) { ScreenShooter.diff a, image(2, 1, "\0" * 8) }
+    assert_raises(ArgumentError) { ScreenShooter.diff a, a, tolerance: 256 }
+    assert_raises(ArgumentError) { ScreenShooter.diff a, a, kernel: :mmx }
+    assert_raises(TypeError)     { ScreenShooter.diff a, 'pixels' }
+
+    rect = CGRect.new(CGPoint.new(0, 0), CGSize.new(2, 2))
+    png  = ScreenShooter.capture rect, source: :synthetic, format: :png
+    assert_raises(ArgumentError) { ScreenShooter.diff png, png }
+  end
+
+end
@@ -0,0 +1,89 @@
+require 'test/helper'
+require 'accessibility/screen_shooter'
+require 'test/accessibility/screen_shooter/png_reader'
+
+class ScreenShooterImageTest < Minitest::Test
+
+  def rect x, y, w, h
+    CGRect.new(CGPoint.new(x, y), CGSize.new(w, h))
+  end
+
+  def capture w, h, opts = {}
+    ScreenShooter.capture rect(0, 0, w, h), { source: :synthetic }.merge(opts)
+  end
+
+  def test_bgra_capture
+    image = capture 64, 32
+    assert_kind_of ScreenShooter::Image, image
+    assert_equal [64, 32, 256, :bgra], [image.width, image.height, image.stride, image.format]
+    assert_equal 64 * 32 * 4, image.bytes.bytesize
+    assert image.bytes.frozen?
+
+    x, y = 40, 17
+    assert_equal [x ^ y, y, x, 255], image.bytes[y * image.stride + x * 4, 4].unpack('C4')
+  end
+
+  def test_png_capture
+    image = capture 50, 40, format: :png, alpha: true
+    assert_equal [:png, nil], [image.format, image.stride]
+    png = PNGReader.new image.bytes
+    assert_equal [50, 40, 4], [png.width, png.height, png.channels]
+    assert_equal [49, 39, 49 ^ 39, 255], png.pixel(49, 39)
+    assert_same image.bytes, image.to_png
+  end
+
+  def test_raw_synthetic_capture_is_packed
+    image = capture 10, 10, format: :raw
+    assert_equal :raw, image.format
+    assert_equal capture(10, 10).bytes, image.bytes
+  end
+
+  def test_to_png
+    png = PNGReader.new capture(30, 20).to_png(level: 1, filter: :none)
+    assert_equal [30, 20, 3], [png.width, png.height, png.channels]
+    assert_equal [29, 19, 29 ^ 19], png.pixel(29, 19)
+  end
+
+  def test_threaded_png
+    image  = capture 120, 90
+    serial = PNGReader.new image.to_png(filter: :none)
+    banded = PNGReader.new image.to_png(filter: :none, threads: 4)
+    assert_equal serial.pixels, banded.pixels
+    assert_equal PNGReader.new(capture(120, 90, format: :png, threads: :auto).bytes).pixels,
+                 PNGReader.new(image.to_png).pixels
+  end
+
+  def test_new_with_padded_stride
+    rows  = 3.times.map { |y| ([y, 0, 0, 255] * 2).pack('C*') + "\0" * 8 }
+    image = ScreenShooter::Image.new 2, 3, rows.join, stride: 16
+    assert_equal 16, image.stride
+    assert image.bytes.frozen?
+
+    png = PNGReader.new image.to_png
+    assert_equal [0, 0, 2], png.pixel(1, 2)
+  end
+
+  def test_new_validates_size
+    assert_raises(ArgumentError) { ScreenShooter::Image.new 2, 2, "\0" * 15 }
+    assert_raises(ArgumentError) { ScreenShooter::Image.new 0, 2, '' }
+    assert_raises(ArgumentError) { ScreenShooter::Image.new 2, 2, "\0" * 64, stride: 4 }
+  end
+
+  def test_new_rejects_sizes_that_overflow
+    assert_raises(ArgumentError) { ScreenShooter::Image.new 2**32, 1, '' }
+    assert_raises(ArgumentError) { ScreenShooter::Image.new 1, 2**62, '' }
+    assert_raises(ArgumentError) { ScreenShooter::Image.new 1, 2**31, '', stride: 2**62 }
+  end
+
+  def test_bad_format
+    assert_raises(ArgumentError) { capture 1, 1, format: :jpeg }
+  end
+
+  def test_screen_capture
+    image = ScreenShooter.capture rect(0, 0, 100, 100), format: :raw
+    assert_operator image.width, :>=, 100
+    assert_operator image.stride, :>=, image.width * 4
+    assert_equal image.stride * image.height, image.bytes.bytesize
+  end
+
+end
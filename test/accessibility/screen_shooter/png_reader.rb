@@ -0,0 +1,85 @@
+require 'zlib'
+
+##
+# Just enough of a PNG decoder to check what ScreenShooter writes
+#
+# Handles 8-bit RGB and RGBA images with any of the standard row
+# filters, and verifies chunk checksums along the way.
+class PNGReader
+  SIGNATURE = "\x89PNG\r\n\x1a\n".b
+
+  attr_reader :width, :height, :channels, :chunks, :pixels
+
+  def initialize bytes
+    bytes = bytes.b
+    raise ArgumentError, 'not a PNG' unless bytes[0, 8] == SIGNATURE
+
+    @chunks = []
+    idat    = ''.b
+    offset  = 8
+    while offset < bytes.bytesize
+      length = bytes[offset, 4].unpack1('N')
+      type   = bytes[offset + 4, 4]
+      data   = bytes[offset + 8, length]
+      crc    = bytes[offset + 8 + length, 4].unpack1('N')
+      raise ArgumentError, "bad CRC in #{type}" unless Zlib.crc32(type + data) == crc
+      @chunks << type
+      idat << data if type == 'IDAT'
+      read_header data if type == 'IHDR'
+      offset += 12 + length
+    end
+
+    @pixels = unfilter Zlib::Inflate.inflate(idat)
+  end
+
+  def self.read path
+    new File.binread path
+  end
+
+  # @return [Array<Integer>] the channel values of one pixel
+  def pixel x, y
+    @pixels[y][x * channels, channels]
+  end
+
+
+  private
+
+  def read_header data
+    @width, @height, depth, colour = data.unpack('NNCC')
+    raise ArgumentError, "unsupported bit depth #{depth}" unless depth == 8
+    @channels = { 2 => 3, 6 => 4 }.fetch(colour)
+  end
+
+  def unfilter raw
+    stride = width * channels
+    prev   = Array.new(stride, 0)
+    Array.new(height) do |y|
+      line   = raw.byteslice(y * (stride + 1), stride + 1).bytes
+      filter = line.shift
+      row    = Array.new(stride)
+      stride.times do |i|
+        a = i >= channels ? row[i - channels] : 0
+        b = prev[i]
+        c = i >= channels ? prev[i - channels] : 0
+        row[i] = (line[i] + predict(filter, a, b, c)) & 0xff
+      end
+      prev = row
+    end
+  end
+
+  def predict filter, a, b, c
+    case filter
+    when 0 then 0
+    when 1 then a
+    when 2 then b
+    when 3 then (a + b) / 2
+    when 4
+      p  = a + b - c
+      pa = (p - a).abs
+      pb = (p - b).abs
+      pc = (p - c).abs
+      pa <= pb && pa <= pc ? a : (pb <= pc ? b : c)
+    else raise ArgumentError, "unknown filter #{filter}"
+    end
+  end
+end
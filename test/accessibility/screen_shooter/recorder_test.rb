@@ -0,0 +1,118 @@
+require 'test/helper'
+require 'tmpdir'
+require 'accessibility/screen_shooter'
+require 'test/accessibility/screen_shooter/png_reader'
+
+class ScreenShooterRecorderTest < Minitest::Test
+
+  def rect w, h
+    CGRect.new(CGPoint.new(0, 0), CGSize.new(w, h))
+  end
+
+  def recorder opts = {}
+    @recorder = ScreenShooter::Recorder.new rect(64, 48), { source: :synthetic }.merge(opts)
+  end
+
+  def wait_for_frames count
+    deadline = Time.now + 5
+    sleep 0.01 until @recorder.stats[:captured] >= count || Time.now > deadline
+  end
+
+  def teardown
+    @recorder.stop if @recorder
+  end
+
+  def test_ring_keeps_newest_frames
+    recorder fps: 200, capacity: 4
+    assert recorder.start
+    refute @recorder.start
+    assert @recorder.recording?
+    wait_for_frames 10
+    assert @recorder.stop
+    refute @recorder.recording?
+
+    stats  = @recorder.stats
+    frames = @recorder.frames
+    assert_operator stats[:captured], :>=, 10
+    assert_equal 4, stats[:frames]
+    assert_equal 4, frames.size
+    assert_equal frames.map(&:time).sort, frames.map(&:time)
+    frames.each do |frame|
+      assert_equal [64, 48, :bgra], [frame.width, frame.height, frame.format]
+      assert_equal [40 ^ 7, 7, 40, 255], frame.bytes[7 * frame.stride + 40 * 4, 4].unpack('C4')
+    end
+
+    # five buffers at most, the ring plus the spare
+    assert_operator stats[:bytes], :>=, 4 * 64 * 48 * 4
+    assert_operator stats[:bytes], :<=, 5 * 64 * 48 * 4
+    assert_equal stats[:captured], @recorder.stats[:captured]
+  end
+
+  def test_fps_is_reported
+    recorder fps: 50, capacity: 2
+    @recorder.start
+    wait_for_frames 10
+    @recorder.stop
+
+    stats = @recorder.stats
+    assert_equal 0, stats[:failed]
+    # the timer never runs early, however busy the machine is
+    assert_operator stats[:fps], :>, 0
+    assert_operator stats[:fps], :<=, 50 * 1.5
+  end
+
+  def test_slow_captures_are_counted_as_dropped
+    # a 3000x3000 synthetic frame takes well over the 1ms a frame allows
+    @recorder = ScreenShooter::Recorder.new rect(3000, 3000),
+                                            source: :synthetic, fps: 1000, capacity: 1
+    @recorder.start
+    wait_for_frames 5
+    @recorder.stop
+
+    stats = @recorder.stats
+    assert_operator stats[:captured], :>=, 5
+    assert_operator stats[:dropped], :>, 0
+  end
+
+  def test_restart_starts_over
+    recorder fps: 100, capacity: 8
+    @recorder.start
+    wait_for_frames 3
+    @recorder.stop
+    first = @recorder.frames.last.time
+
+    @recorder.start
+    wait_for_frames 1
+    @recorder.stop
+    assert_operator @recorder.frames.first.time, :>, first
+  end
+
+  def test_frames_before_start
+    assert_empty recorder.frames
+    assert_equal 0, @recorder.stats[:captured]
+  end
+
+  def test_save_encodes_on_demand
+    recorder fps: 100, capacity: 3
+    @recorder.start
+    wait_for_frames 3
+    @recorder.stop
+
+    Dir.mktmpdir do |dir|
+      paths = @recorder.save dir, alpha: true
+      assert_equal 3, paths.size
+      png = PNGReader.read paths.last
+      assert_equal [64, 48, 4], [png.width, png.height, png.channels]
+      assert_equal [1, 2, 3, 255], png.pixel(1, 2)
+    end
+  end
+
+  def test_bad_options
+    assert_raises(ArgumentError) { recorder fps: 0 }
+    assert_raises(ArgumentError) { recorder fps: 1001 }
+    assert_raises(ArgumentError) { recorder fps: Float::NAN }
+    assert_raises(ArgumentError) { recorder capacity: 0 }
+    assert_raises(ArgumentError) { recorder source: :camera }
+  end
+
+end
@@ -0,0 +1,110 @@
+require 'test/helper'
+require 'tmpdir'
+require 'accessibility/screen_shooter'
+require 'test/accessibility/screen_shooter/png_reader'
+
+class ScreenShooterTest < Minitest::Test
+
+  def rect x, y, w, h
+    CGRect.new(CGPoint.new(x, y), CGSize.new(w, h))
+  end
+
+  def shot name, r, opts = {}
+    path = File.join(@dir, "#{name}.png")
+    assert ScreenShooter.screenshot(r, path, opts)
+    PNGReader.read path
+  end
+
+  def setup
+    @dir = Dir.mktmpdir
+  end
+
+  def teardown
+    FileUtils.rm_rf @dir
+  end
+
+  def test_synthetic_shot_round_trips
+    png = shot 'synthetic', rect(0, 0, 300, 200), source: :synthetic
+    assert_equal [300, 200, 3], [png.width, png.height, png.channels]
+    assert_equal 'IHDR', png.chunks.first
+    assert_equal 'IEND', png.chunks.last
+
+    [[0, 0], [299, 0], [17, 123], [299, 199]].each do |x, y|
+      assert_equal [x & 0xff, y & 0xff, (x ^ y) & 0xff], png.pixel(x, y)
+    end
+  end
+
+  def test_compression_levels_and_filters
+    sizes = [0, 1, 9].map do |level|
+      [:none, :sub].map do |filter|
+        name = "level#{level}#{filter}"
+        png  = shot name, rect(0, 0, 256, 256), source: :synthetic, level: level, filter: filter
+        assert_equal [255, 7, 255 ^ 7], png.pixel(255, 7)
+        File.size File.join(@dir, "#{name}.png")
+      end
+    end
+    assert_operator sizes[2][1], :<, sizes[0][1]
+
+    assert_raises(ArgumentError) { shot 'bad', rect(0, 0, 1, 1), source: :synthetic, level: 10 }
+    assert_raises(ArgumentError) { shot 'bad', rect(0, 0, 1, 1), source: :synthetic, filter: :paeth }
+    assert_raises(ArgumentError) { shot 'bad', rect(0, 0, 1, 1), source: :moon }
+  end
+
+  def test_alpha
+    png = shot 'alpha', rect(0, 0, 10, 10), source: :synthetic, alpha: true
+    assert_equal 4, png.channels
+    assert_equal [3, 4, 7, 255], png.pixel(3, 4)
+  end
+
+  def test_threaded_encoding_decodes_the_same
+    [[300, 200], [64, 33], [40, 20]].each do |w, h|
+      serial = shot "serial#{h}", rect(0, 0, w, h), source: :synthetic, alpha: true
+      [2, 3, 8, :auto].each do |threads|
+        png = shot "threads#{threads}x#{h}", rect(0, 0, w, h),
+                   source: :synthetic, alpha: true, threads: threads, level: 9
+        assert_equal [w, h, 4], [png.width, png.height, png.channels]
+        assert_equal serial.pixels, png.pixels, "#{threads} threads on #{w}x#{h}"
+      end
+    end
+
+    assert_raises(ArgumentError) { shot 'bad', rect(0, 0, 1, 1), source: :synthetic, threads: 0 }
+    assert_raises(ArgumentError) { shot 'bad', rect(0, 0, 1, 1), source: :synthetic, threads: 65 }
+  end
+
+  def test_pixel_buffer_is_reused
+    shot 'first', rect(0, 0, 640, 480), source: :synthetic
+    before = ScreenShooter.pool_stats
+    3.times { |n| shot "again#{n}", rect(0, 0, 320, 240), source: :synthetic }
+    after = ScreenShooter.pool_stats
+
+    assert_equal before[:allocations], after[:allocations]
+    assert_equal before[:reuses] + 3, after[:reuses]
+    assert_operator after[:bytes], :>=, 640 * 480 * 4
+  end
+
+  def test_screen_shot
+    png = shot 'screen', rect(0, 0, 100, 100)
+    assert_operator png.width, :>=, 100
+    assert_operator png.height, :>=, 100
+  end
+
+  def test_unwritable_path
+    refute ScreenShooter.screenshot(rect(0, 0, 1, 1), '/no/such/dir/shot.png', source: :synthetic)
+  end
+
+  def test_options_must_be_a_hash
+    path = File.join(@dir, 'nil.png')
+    r    = rect(0, 0, 1, 1)
+    assert ScreenShooter.screenshot(r, path, nil)
+    assert_raises(TypeError) { ScreenShooter.screenshot r, path, 'fast' }
+    assert_raises(TypeError) { ScreenShooter.capture r, [:png] }
+    assert_raises(TypeError) { ScreenShooter::Recorder.new r, 30 }
+  end
+
+  def test_shoot
+    path = ScreenShooter.shoot rect(0, 0, 20, 20), @dir, source: :synthetic
+    assert File.exist? path
+    assert_match(/AXElements-ScreenShot-\d+\.png\z/, path)
+  end
+
+end
@@ -0,0 +1,116 @@
+require 'test/helper'
+require 'accessibility/screen_shooter'
+
+class ScreenShooterSequenceTest < Minitest::Test
+
+  W = 100
+  H = 70
+
+  # frames where `rate` of the pixels change each time
+  def frames count, rate, rng = Random.new(9)
+    bytes = Array.new(W * H) { |i| [i % 251, i % 13, i % 7, 255] }.flatten.pack('C*')
+    Array.new(count) do
+      (W * H * rate).round.times do
+        bytes.setbyte rng.rand(W * H) * 4, rng.rand(256)
+      end
+      ScreenShooter::Image.new W, H, bytes.dup
+    end
+  end
+
+  def sequence images, opts = {}
+    seq = ScreenShooter::Sequence.new W, H, opts
+    images.each { |image| seq << image }
+    seq
+  end
+
+  def assert_frames images, seq
+    assert_equal images.size, seq.size
+    images.each_with_index do |image, index|
+      frame = seq.frame index
+      assert_equal [W, H, W * 4, :bgra], [frame.width, frame.height, frame.stride, frame.format]
+      assert_equal image.bytes, frame.bytes, "frame #{index}"
+    end
+  end
+
+  def test_round_trip
+    images = frames 12, 0.001
+    seq    = sequence images, tile: 16, keyframe_every: 5
+    assert_frames images, seq
+    assert_equal images.last.bytes, seq.frame(-1).bytes
+    assert_raises(IndexError) { seq.frame 12 }
+    assert_raises(IndexError) { seq.frame(-13) }
+  end
+
+  def test_dump_and_load
+    images = frames 8, 0.01
+    seq    = sequence images, tile: 10, keyframe_every: 3
+    dump   = seq.dump
+    assert dump.frozen?
+    assert_equal 'AXSQ', dump[0, 4]
+
+    loaded = ScreenShooter::Sequence.load dump
+    assert_equal [W, H], [loaded.width, loaded.height]
+    assert_frames images, loaded
+    assert_equal seq.stats, loaded.stats
+
+    # carry on recording after loading
+    more = frames 1, 0.05, Random.new(1)
+    loaded << more.first
+    assert_equal more.first.bytes, loaded.frame(8).bytes
+  end
+
+  def test_only_changed_tiles_are_stored
+    images = frames 10, 0.0005
+    stats  = sequence(images, tile: 10, keyframe_every: 10).stats
+    assert_equal 10, stats[:frames]
+    assert_equal 1, stats[:keyframes]
+    # a keyframe is 70 tiles; each delta changes at most 4 pixels
+    assert_operator stats[:tiles], :<=, 70 + 9 * 4
+    assert_equal 10 * W * H * 4, stats[:raw_bytes]
+  end
+
+  def test_size_tracks_change_rate
+    sizes = [0.0, 0.01, 0.2].map do |rate|
+      sequence(frames(20, rate), keyframe_every: 30).stats[:bytes]
+    end
+    assert_operator sizes[0], :<, sizes[1]
+    assert_operator sizes[1], :<, sizes[2]
+  end
+
+  def test_unchanged_frames
+    image = frames(1, 0).first
+    seq   = sequence [image] * 5
+    assert_equal 4 * 3, seq.stats[:tiles] # only the keyframe's 32x32 tiles
+    assert_frames [image] * 5, seq
+  end
+
+  def test_padded_images
+    rows  = frames(1, 0).first.bytes.scan(/.{#{W * 4}}/m)
+    image = ScreenShooter::Image.new W, H, rows.map { |row| row + "\0" * 12 }.join, stride: W * 4 + 12
+    seq   = sequence [image]
+    assert_equal rows.join, seq.frame(0).bytes
+  end
+
+  def test_synthetic_capture
+    seq  = ScreenShooter::Sequence.new 20, 10
+    rect = CGRect.new(CGPoint.new(0, 0), CGSize.new(20, 10))
+    2.times { seq.capture rect, source: :synthetic }
+    assert_equal 2, seq.size
+    assert_equal 1, seq.stats[:tiles] # the second frame is the same
+  end
+
+  def test_bad_input
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new 0, 10 }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new 65_536, 10 }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new 10, 65_536 }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new 10, 10, tile: 0 }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new 10, 10, keyframe_every: 0 }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new 10, 10, level: 11 }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.new(10, 10) << frames(1, 0).first }
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.load 'AXSQ' }
+
+    dump = sequence(frames(2, 0.01)).dump
+    assert_raises(ArgumentError) { ScreenShooter::Sequence.load dump[0...-1] }
+  end
+
+end
@@ -0,0 +1,113 @@
+/*
+ * Where a batch's highlights land in its overlay, without a window
+ */
+
+#include "check.h"
+#include "batch_layout.h"
+
+#include <string.h>
+
+static
+int
+same_rect(const hl_rect_t a, const double x, const double y, const double w, const double h)
+{
+    return (a.x == x && a.y == y && a.width == w && a.height == h);
+}
+
+// One 1440x900 screen, which the overlay covers exactly
+static
+void
+layout_init(hl_layout_t* const layout)
+{
+    memset(layout, 0, sizeof(hl_layout_t));
+    const hl_rect_t frame = { 0, 0, 1440, 900 };
+    layout->frame         = frame;
+    layout->screen_height = 900;
+}
+
+static
+void
+test_ids_count_up_and_room_grows(void)
+{
+    hl_layout_t layout;
+    layout_init(&layout);
+
+    for (long i = 0; i < 100; i++) {
+        CHECK(!hl_layout_reserve(&layout, 1));
+        const hl_rect_t rect = { (double)i, 0, 1, 1 };
+        CHECK(hl_layout_push(&layout, rect, NULL) == i);
+    }
+    CHECK(layout.count == 100);
+    CHECK(layout.capacity >= 100);
+    CHECK(layout.items[42].rect.x == 42);
+
+    // reserving what is already there does not move anything
+    hl_item_t* const items = layout.items;
+    CHECK(!hl_layout_reserve(&layout, layout.capacity - layout.count));
+    CHECK(layout.items == items);
+
+    hl_layout_free(&layout);
+    CHECK(!layout.items && !layout.count && !layout.capacity);
+}
+
+static
+void
+test_rects_are_flipped_into_the_overlay(void)
+{
+    hl_layout_t layout;
+    layout_init(&layout);
+
+    const hl_rect_t top_left = { 10, 20, 100, 50 };
+    CHECK(!hl_layout_reserve(&layout, 1));
+    hl_layout_push(&layout, top_left, NULL);
+    CHECK(same_rect(hl_layout_place(&layout, &layout.items[0]), 10, 900 - 70, 100, 50));
+
+    // a second screen to the left and below moves the overlay's origin
+    const hl_rect_t frame = { -1280, -124, 2720, 1024 };
+    layout.frame = frame;
+    CHECK(same_rect(hl_layout_place(&layout, &layout.items[0]), 1290, 954, 100, 50));
+
+    hl_layout_free(&layout);
+}
+
+static
+void
+test_record_keeps_order_and_colours(void)
+{
+    hl_layout_t layout;
+    layout_init(&layout);
+    int colours[3];
+
+    CHECK(!hl_layout_reserve(&layout, 3));
+    for (int i = 0; i < 3; i++) {
+        const hl_rect_t rect = { i * 10.0, i * 10.0, 5, 5 };
+        hl_layout_push(&layout, rect, &colours[i]);
+    }
+    CHECK(!hl_layout_record(&layout));
+    CHECK(layout.fill_count == 3);
+    for (size_t i = 0; i < 3; i++) {
+        CHECK(layout.fills[i].color == &colours[i]);
+        CHECK(same_rect(layout.fills[i].rect, i * 10.0, 900 - (i * 10.0 + 5), 5, 5));
+    }
+
+    // fewer items, fewer fills
+    layout.count = 1;
+    CHECK(!hl_layout_record(&layout));
+    CHECK(layout.fill_count == 1);
+
+    layout.count = 0;
+    CHECK(!hl_layout_record(&layout));
+    CHECK(layout.fill_count == 0);
+
+    hl_layout_free(&layout);
+    CHECK(!layout.fills && !layout.fill_count);
+}
+
+int
+main(void)
+{
+    test_ids_count_up_and_room_grows();
+    test_rects_are_flipped_into_the_overlay();
+    test_record_keeps_order_and_colours();
+    return check_report("batch_layout");
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdio.h>
+
+/*
+ * Just enough of a test harness for the plain C files, so that they can
+ * be tested anywhere they build:
+ *
+ *   rake test:native
+ *
+ * Each test program checks what it needs to with CHECK and returns
+ * check_report() from main.
+ */
+
+static int check_failures;
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__,    \
+                    #condition);                                          \
+            check_failures++;                                             \
+        }                                                                 \
+    } while (0)
+
+static
+int
+check_report(const char* const name)
+{
+    if (check_failures)
+        fprintf(stderr, "%s: %d check(s) failed\n", name, check_failures);
+    else
+        printf("%s: ok\n", name);
+    return (check_failures ? 1 : 0);
+}
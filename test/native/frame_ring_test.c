@@ -0,0 +1,141 @@
+/*
+ * The recorder's ring, counts and timing, without a recorder
+ */
+
+#include "check.h"
+#include "frame_ring.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static int allocated;
+static int released;
+
+static
+ss_buffer_t
+buffer_new(void)
+{
+    ss_buffer_t buffer = { malloc(64), 64 };
+    allocated++;
+    return buffer;
+}
+
+static
+void
+buffer_release(const ss_buffer_t buffer)
+{
+    if (buffer.bytes)
+        released++;
+    free(buffer.bytes);
+}
+
+// What a capture does: make sure the spare has a buffer, then fill it
+static
+void
+capture_into(ss_ring_t* const ring, const uint8_t mark)
+{
+    if (!ring->spare.buffer.bytes)
+        ring->spare.buffer = buffer_new();
+    ring->spare.buffer.bytes[0] = mark;
+    ring->spare.width  = 4;
+    ring->spare.height = 4;
+    ring->spare.stride = 16;
+}
+
+static
+void
+test_ring_keeps_the_newest_frames(void)
+{
+    ss_ring_t ring;
+    CHECK(!ss_ring_init(&ring, 3));
+    CHECK(ss_ring_count(&ring) == 0);
+
+    for (int i = 0; i < 5; i++) {
+        capture_into(&ring, (uint8_t)i);
+        ss_ring_record(&ring, 1, 0, 1.0 + i * 0.1);
+    }
+    CHECK(ring.head == 5);
+    CHECK(ss_ring_count(&ring) == 3);
+    for (size_t i = 0; i < 3; i++)
+        CHECK(ss_ring_newest(&ring, 3, i)->frame.buffer.bytes[0] == 2 + i);
+    CHECK(ss_ring_newest(&ring, 1, 0)->frame.buffer.bytes[0] == 4);
+    CHECK(ss_ring_newest(&ring, 3, 0)->time > 1.19 && ss_ring_newest(&ring, 3, 0)->time < 1.21);
+
+    // three slots and a spare, and no more once the ring is full
+    CHECK(allocated == 4);
+    CHECK(ss_ring_bytes(&ring) == 4 * 64);
+
+    ss_ring_free(&ring, buffer_release);
+    CHECK(released == allocated);
+    CHECK(!ring.slots);
+}
+
+static
+void
+test_drops_and_failures_are_counted(void)
+{
+    ss_ring_t ring;
+    CHECK(!ss_ring_init(&ring, 2));
+
+    capture_into(&ring, 1);
+    ss_ring_record(&ring, 1, 0, 1.0);
+    capture_into(&ring, 2);
+    ss_ring_record(&ring, 4, 0, 1.4); // three ticks went by during the capture
+    ss_ring_record(&ring, 1, 1, 1.5); // and this one failed
+
+    CHECK(ring.head == 2);
+    CHECK(ring.dropped == 3);
+    CHECK(ring.failed == 1);
+    CHECK(ring.last == 1.4);
+    CHECK(ss_ring_newest(&ring, 2, 1)->frame.buffer.bytes[0] == 2);
+
+    // the spare and its buffer survive a clear, for the next recording
+    const uint8_t* const spare = ring.spare.buffer.bytes;
+    ss_ring_clear(&ring, buffer_release);
+    CHECK(ring.head == 0 && ring.dropped == 0 && ring.failed == 0);
+    CHECK(ss_ring_count(&ring) == 0);
+    CHECK(ring.spare.buffer.bytes == spare);
+    CHECK(ss_ring_fps(&ring) == 0);
+
+    ss_ring_free(&ring, buffer_release);
+    CHECK(released == allocated);
+}
+
+static
+void
+test_fps_is_measured_between_frames(void)
+{
+    ss_ring_t ring;
+    CHECK(!ss_ring_init(&ring, 4));
+
+    capture_into(&ring, 0);
+    ss_ring_record(&ring, 1, 0, 10.0);
+    CHECK(ss_ring_fps(&ring) == 0); // one frame is no rate at all
+
+    for (int i = 1; i <= 20; i++) {
+        capture_into(&ring, 0);
+        ss_ring_record(&ring, 1, 0, 10.0 + i * 0.05);
+    }
+    CHECK(ss_ring_fps(&ring) > 19.99 && ss_ring_fps(&ring) < 20.01);
+
+    ss_ring_free(&ring, buffer_release);
+}
+
+static
+void
+test_interval(void)
+{
+    CHECK(ss_ring_interval(10) == 100000000);
+    CHECK(ss_ring_interval(SS_RING_MAX_FPS) == 1000000);
+    CHECK(ss_ring_interval(1e-300) == INT64_MAX);
+}
+
+int
+main(void)
+{
+    test_ring_keeps_the_newest_frames();
+    test_drops_and_failures_are_counted();
+    test_fps_is_measured_between_frames();
+    test_interval();
+    return check_report("frame_ring");
+}
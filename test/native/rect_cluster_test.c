@@ -0,0 +1,117 @@
+/*
+ * Grouping element frames for ScreenShooter.capture_elements
+ */
+
+#include "check.h"
+#include "rect_cluster.h"
+
+#include <math.h>
+
+#define GAP 16
+
+static
+int
+same_rect(const ss_rect_t a, const double x, const double y, const double w, const double h)
+{
+    return (a.x == x && a.y == y && a.width == w && a.height == h);
+}
+
+static
+void
+test_far_apart_rects_stay_apart(void)
+{
+    const ss_rect_t rects[] = {
+        { 0, 0, 10, 10 }, { 1000, 800, 10, 10 }, { 0, 800, 10, 10 }
+    };
+    size_t    group[3];
+    ss_rect_t bounds[3];
+
+    CHECK(ss_cluster_rects(rects, 3, GAP, group, bounds) == 3);
+    CHECK(group[0] != group[1] && group[1] != group[2] && group[0] != group[2]);
+    for (size_t i = 0; i < 3; i++)
+        CHECK(same_rect(bounds[group[i]], rects[i].x, rects[i].y, rects[i].width, rects[i].height));
+}
+
+static
+void
+test_near_and_overlapping_rects_are_grouped(void)
+{
+    const ss_rect_t rects[] = {
+        { 0, 0, 10, 10 },       // overlaps the next one
+        { 5, 5, 10, 10 },
+        { 31, 0, 10, 10 },      // 16 points to the right of the last one
+        { 500, 500, 20, 20 },   // on its own
+        { 500, 537, 20, 20 }    // 17 points below the last one, too far
+    };
+    size_t    group[5];
+    ss_rect_t bounds[5];
+
+    CHECK(ss_cluster_rects(rects, 5, GAP, group, bounds) == 3);
+    CHECK(group[0] == group[1] && group[1] == group[2]);
+    CHECK(group[3] != group[4] && group[3] != group[0]);
+    CHECK(same_rect(bounds[group[0]], 0, 0, 41, 15));
+}
+
+static
+void
+test_merged_groups_can_reach_further(void)
+{
+    // the third is not near either of the first two, but it is near
+    // the area that covers both of them
+    const ss_rect_t rects[] = {
+        { 0, 0, 50, 10 }, { 60, 0, 10, 100 }, { 0, 110, 10, 10 }
+    };
+    size_t    group[3];
+    ss_rect_t bounds[3];
+
+    CHECK(ss_cluster_rects(rects, 3, GAP, group, bounds) == 1);
+    CHECK(same_rect(bounds[0], 0, 0, 70, 120));
+}
+
+static
+void
+test_empty_rects_are_left_out(void)
+{
+    const ss_rect_t rects[] = {
+        { 5, 5, 0, 0 }, { INFINITY, INFINITY, 0, 0 }, { 1, 2, 3, 4 }, { NAN, 0, 5, 5 }
+    };
+    size_t    group[4];
+    ss_rect_t bounds[4];
+
+    CHECK(ss_cluster_rects(rects, 4, GAP, group, bounds) == 1);
+    CHECK(group[0] == SS_CLUSTER_NONE);
+    CHECK(group[1] == SS_CLUSTER_NONE);
+    CHECK(group[2] == 0);
+    CHECK(group[3] == SS_CLUSTER_NONE);
+    CHECK(ss_cluster_rects(rects, 0, GAP, group, bounds) == 0);
+}
+
+static
+void
+test_bounds_can_replace_the_rects(void)
+{
+    // 50 controls in a grid, in rows too far apart to share a capture
+    ss_rect_t rects[50];
+    size_t    group[50];
+    for (size_t i = 0; i < 50; i++) {
+        const ss_rect_t rect = { 20 + (double)(i % 10) * 35, 40 + (double)(i / 10) * 60, 30, 20 };
+        rects[i] = rect;
+    }
+
+    CHECK(ss_cluster_rects(rects, 50, GAP, group, rects) == 5);
+    for (size_t i = 0; i < 50; i++)
+        CHECK(group[i] == group[i - i % 10]);
+    for (size_t row = 0; row < 5; row++)
+        CHECK(same_rect(rects[group[row * 10]], 20, 40 + (double)row * 60, 345, 20));
+}
+
+int
+main(void)
+{
+    test_far_apart_rects_stay_apart();
+    test_near_and_overlapping_rects_are_grouped();
+    test_merged_groups_can_reach_further();
+    test_empty_rects_are_left_out();
+    test_bounds_can_replace_the_rects();
+    return check_report("rect_cluster");
+}